@@ -0,0 +1,153 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Shared helpers for the benchmark executables: timing, summaries and a
+// minimal JSON writer so results can be diffed across commits.
+namespace bench
+{
+using Clock = std::chrono::steady_clock;
+
+inline double ElapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Summary
+{
+    double mean = 0.0, min = 0.0, max = 0.0, p50 = 0.0, p95 = 0.0;
+};
+
+inline Summary Summarize(std::vector<double> samples)
+{
+    Summary s;
+    if (samples.empty())
+        return s;
+
+    std::sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (double v : samples)
+        total += v;
+
+    auto percentile = [&](double p) {
+        size_t index = (size_t)(p * (samples.size() - 1) + 0.5);
+        return samples[std::min(index, samples.size() - 1)];
+    };
+
+    s.mean = total / samples.size();
+    s.min = samples.front();
+    s.max = samples.back();
+    s.p50 = percentile(0.50);
+    s.p95 = percentile(0.95);
+    return s;
+}
+
+// "1,1k,100k,1M" -> {1, 1000, 100000, 1000000}
+inline std::vector<long long> ParseSizeList(const std::string& text)
+{
+    std::vector<long long> sizes;
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos)
+            end = text.size();
+
+        std::string item = text.substr(start, end - start);
+        if (!item.empty())
+        {
+            long long multiplier = 1;
+            char suffix = item.back();
+            if (suffix == 'k' || suffix == 'K') multiplier = 1000;
+            if (suffix == 'm' || suffix == 'M') multiplier = 1000000;
+            if (multiplier != 1)
+                item.pop_back();
+            sizes.push_back(std::atoll(item.c_str()) * multiplier);
+        }
+        start = end + 1;
+    }
+    return sizes;
+}
+
+class JsonWriter
+{
+public:
+    explicit JsonWriter(FILE* out) : m_out(out), m_needComma(false), m_depth(0) {}
+
+    void BeginObject(const char* key = nullptr) { Open(key, '{'); }
+    void EndObject() { Close('}'); }
+    void BeginArray(const char* key = nullptr) { Open(key, '['); }
+    void EndArray() { Close(']'); }
+
+    void Value(const char* key, double value) { Key(key); std::fprintf(m_out, "%.6g", value); }
+    void Value(const char* key, long long value) { Key(key); std::fprintf(m_out, "%lld", value); }
+    void Value(const char* key, int value) { Value(key, (long long)value); }
+    void Value(const char* key, size_t value) { Value(key, (long long)value); }
+    void Value(const char* key, bool value) { Key(key); std::fputs(value ? "true" : "false", m_out); }
+    void Value(const char* key, const std::string& value) { Value(key, value.c_str()); }
+    void Value(const char* key, const char* value)
+    {
+        Key(key);
+        std::fputc('"', m_out);
+        for (const char* c = value; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\') std::fputc('\\', m_out);
+            if ((unsigned char)*c >= 0x20) std::fputc(*c, m_out);
+        }
+        std::fputc('"', m_out);
+    }
+
+    void Summary(const char* key, const bench::Summary& s)
+    {
+        BeginObject(key);
+        Value("mean", s.mean);
+        Value("min", s.min);
+        Value("p50", s.p50);
+        Value("p95", s.p95);
+        Value("max", s.max);
+        EndObject();
+    }
+
+private:
+    void Key(const char* key)
+    {
+        if (m_needComma)
+            std::fputc(',', m_out);
+        if (m_depth > 0)
+            std::fputc('\n', m_out);
+        for (int i = 0; i < m_depth; ++i)
+            std::fputs("  ", m_out);
+        if (key)
+            std::fprintf(m_out, "\"%s\": ", key);
+        m_needComma = true;
+    }
+
+    void Open(const char* key, char bracket)
+    {
+        Key(key);
+        std::fputc(bracket, m_out);
+        m_needComma = false;
+        ++m_depth;
+    }
+
+    void Close(char bracket)
+    {
+        --m_depth;
+        std::fputc('\n', m_out);
+        for (int i = 0; i < m_depth; ++i)
+            std::fputs("  ", m_out);
+        std::fputc(bracket, m_out);
+        m_needComma = true;
+        if (m_depth == 0)
+            std::fputc('\n', m_out);
+    }
+
+    FILE* m_out;
+    bool m_needComma;
+    int m_depth;
+};
+}
@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchCommon.h"
+#include "JobSystem.h"
+#include "Renderer.h"
+#include "SoftwareRenderer.h"
+#include "SpatialIndex.h"
+
+// JobSystem scaling (CPU only, no GL), JSON on stdout (or --output FILE).
+// Usage: job_bench [--threads 1,2,4] [--triangles N] [--raster-triangles N]
+//                  [--iterations N] [--warmup N] [--label TEXT]
+// Every workload runs once per thread count; speedup is the p50 of the first
+// count (1 by default) over this one. Results that must not depend on the
+// thread count (corners, BVH, rasterized pixels, graph sums) are checked
+// against a serial reference.
+
+namespace
+{
+struct Options
+{
+    std::vector<long long> threads;
+    long long triangles = 1000000;
+    long long rasterTriangles = 100000;
+    int iterations = 10;
+    int warmup = 2;
+    std::string label;
+    std::string output;
+};
+
+const size_t kTransformGrain = 4096;
+const int kGraphChains = 64;
+const int kGraphChainLength = 64;
+const int kGraphWorkPerJob = 2000; // Loop iterations, a few microseconds
+const int kEmptyJobs = 100000;
+
+// Default sweep: powers of two up to the hardware, then the hardware itself
+std::vector<long long> DefaultThreadCounts()
+{
+    long long hardware = (long long)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<long long> counts;
+    for (long long count = 1; count < hardware; count *= 2)
+        counts.push_back(count);
+    counts.push_back(hardware);
+    return counts;
+}
+
+std::vector<TriangleInstance> MakeScene(long long count)
+{
+    // Same scene as renderer_bench
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    float scale = count > 1 ? std::max(0.005f, 0.5f / std::sqrt((float)count)) : 1.0f;
+
+    std::vector<TriangleInstance> instances((size_t)count);
+    for (TriangleInstance& instance : instances)
+    {
+        instance.offset[0] = count > 1 ? unit(rng) * 2.0f - 1.0f : 0.0f;
+        instance.offset[1] = count > 1 ? unit(rng) * 2.0f - 1.0f : 0.0f;
+        instance.rotation = unit(rng) * 360.0f;
+        instance.scale = scale;
+        for (float& channel : instance.colors)
+            channel = unit(rng);
+    }
+    return instances;
+}
+
+// The per-instance corner transform of Renderer::ComputeTriangleCorners at 1280x720
+void TransformCorners(const std::vector<TriangleInstance>& instances, std::vector<float>& corners, size_t begin, size_t end)
+{
+    const float positions[6] = { 0.0f, 0.577f, -0.5f, -0.289f, 0.5f, -0.289f };
+    const float width = 1280.0f, height = 720.0f;
+    const float aspectRatio = width / height;
+    const float sizeScale = 800.0f / height;
+    const float degreesToRadians = 3.14159265f / 180.0f;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const TriangleInstance& instance = instances[i];
+        float cosR = std::cos(instance.rotation * degreesToRadians);
+        float sinR = std::sin(instance.rotation * degreesToRadians);
+        float scale = instance.scale * sizeScale;
+        for (int v = 0; v < 3; ++v)
+        {
+            float x = (cosR * positions[v * 2] + sinR * positions[v * 2 + 1]) * scale / aspectRatio;
+            float y = (-sinR * positions[v * 2] + cosR * positions[v * 2 + 1]) * scale;
+            corners[i * 6 + v * 2] = (x + instance.offset[0] + 1.0f) * 0.5f * width;
+            corners[i * 6 + v * 2 + 1] = (1.0f - (y + instance.offset[1])) * 0.5f * height;
+        }
+    }
+}
+
+// Keeps the compiler from dropping the graph jobs' loops
+double Spin(double seed)
+{
+    double value = seed;
+    for (int i = 0; i < kGraphWorkPerJob; ++i)
+        value = value * 0.999999 + 1.0e-6;
+    return value;
+}
+
+struct Workload
+{
+    const char* name;
+    const char* unit; // What "items" counts
+    size_t items;
+    bool ownScheduler; // Runs on a JobSystem of its own with the same thread count, whose counters are not reported
+    std::function<void(JobSystem&)> run;
+    std::function<bool(JobSystem&)> check; // After the timed runs, against the serial reference
+};
+
+bool ParseArgs(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--threads") == 0 && hasValue) options.threads = bench::ParseSizeList(argv[++i]);
+        else if (std::strcmp(argv[i], "--triangles") == 0 && hasValue) options.triangles = std::max(1LL, bench::ParseSizeList(argv[++i]).front());
+        else if (std::strcmp(argv[i], "--raster-triangles") == 0 && hasValue) options.rasterTriangles = std::max(1LL, bench::ParseSizeList(argv[++i]).front());
+        else if (std::strcmp(argv[i], "--iterations") == 0 && hasValue) options.iterations = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) options.warmup = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--label") == 0 && hasValue) options.label = argv[++i];
+        else if (std::strcmp(argv[i], "--output") == 0 && hasValue) options.output = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return false;
+        }
+    }
+    if (options.threads.empty())
+        options.threads = DefaultThreadCounts();
+    return true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseArgs(argc, argv, options))
+        return 2;
+
+    FILE* out = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "w");
+    if (!out)
+    {
+        std::fprintf(stderr, "Cannot open %s\n", options.output.c_str());
+        return 1;
+    }
+
+    // Inputs, and the serial answers every thread count is held to
+    const std::vector<TriangleInstance> instances = MakeScene(options.triangles);
+    std::vector<float> corners((size_t)options.triangles * 6);
+    TransformCorners(instances, corners, 0, instances.size());
+    const std::vector<float> referenceCorners = corners;
+
+    SpatialIndex referenceIndex;
+    referenceIndex.BuildTriangles(referenceCorners);
+    SpatialIndex index;
+
+    std::unique_ptr<SoftwareRenderer> rasterizer;
+    std::vector<unsigned char> referencePixels;
+    const std::vector<TriangleInstance> rasterScene = MakeScene(options.rasterTriangles);
+
+    std::vector<double> chainSums(kGraphChains);
+    double referenceChainSum = 0.0;
+    for (int chain = 0; chain < kGraphChains; ++chain)
+    {
+        double value = chain;
+        for (int link = 0; link < kGraphChainLength; ++link)
+            value = Spin(value);
+        referenceChainSum += value;
+    }
+    std::atomic<int> emptyJobsRun(0);
+
+    std::vector<Workload> workloads;
+    workloads.push_back({ "transform", "triangles", instances.size(), false,
+        [&](JobSystem& jobs) {
+            jobs.ParallelFor(instances.size(), kTransformGrain, [&](size_t begin, size_t end) {
+                TransformCorners(instances, corners, begin, end);
+            });
+        },
+        [&](JobSystem&) { return corners == referenceCorners; } });
+    workloads.push_back({ "bvh_build", "triangles", instances.size(), false,
+        [&](JobSystem& jobs) { index.BuildTriangles(referenceCorners, &jobs); },
+        [&](JobSystem&) {
+            if (index.GetNodeCount() != referenceIndex.GetNodeCount())
+                return false;
+            std::mt19937 rng(99);
+            std::uniform_real_distribution<float> px(0.0f, 1280.0f), py(0.0f, 720.0f);
+            for (int i = 0; i < 1000; ++i)
+            {
+                float x = px(rng), y = py(rng);
+                size_t a = 0, b = 0;
+                bool hitA = index.Pick(x, y, a), hitB = referenceIndex.Pick(x, y, b);
+                if (hitA != hitB || a != b)
+                    return false;
+            }
+            return true;
+        } });
+    workloads.push_back({ "software_raster", "triangles", rasterScene.size(), true,
+        [&](JobSystem& jobs) {
+            // The renderer owns its threads; rebuilt only when the count changes
+            if (!rasterizer || rasterizer->GetThreadCount() != jobs.GetThreadCount())
+            {
+                rasterizer.reset(new SoftwareRenderer(jobs.GetThreadCount()));
+                rasterizer->SetViewport(1280, 720);
+                rasterizer->SetTriangleVisible(true);
+                rasterizer->SetTriangleInstances(rasterScene);
+            }
+            rasterizer->Render();
+        },
+        [&](JobSystem&) {
+            if (referencePixels.empty())
+                referencePixels = rasterizer->GetPixels();
+            return rasterizer->GetPixels() == referencePixels;
+        } });
+    workloads.push_back({ "task_graph", "jobs", (size_t)kGraphChains * kGraphChainLength, false,
+        [&](JobSystem& jobs) {
+            // Independent chains; each link waits on the previous one
+            std::vector<JobSystem::JobHandle> tails;
+            for (int chain = 0; chain < kGraphChains; ++chain)
+            {
+                chainSums[chain] = chain;
+                JobSystem::JobHandle previous;
+                for (int link = 0; link < kGraphChainLength; ++link)
+                    previous = jobs.Schedule([&chainSums, chain]() { chainSums[chain] = Spin(chainSums[chain]); }, { previous });
+                tails.push_back(previous);
+            }
+            for (const JobSystem::JobHandle& tail : tails)
+                jobs.Wait(tail);
+        },
+        [&](JobSystem&) {
+            double sum = 0.0;
+            for (double value : chainSums)
+                sum += value;
+            return sum == referenceChainSum;
+        } });
+    workloads.push_back({ "empty_jobs", "jobs", (size_t)kEmptyJobs, false,
+        [&](JobSystem& jobs) {
+            emptyJobsRun = 0;
+            std::vector<JobSystem::JobHandle> handles;
+            handles.reserve(kEmptyJobs);
+            for (int i = 0; i < kEmptyJobs; ++i)
+                handles.push_back(jobs.Schedule([&emptyJobsRun]() { emptyJobsRun.fetch_add(1, std::memory_order_relaxed); }));
+            for (const JobSystem::JobHandle& handle : handles)
+                jobs.Wait(handle);
+        },
+        [&](JobSystem&) { return emptyJobsRun.load() == kEmptyJobs; } });
+
+    bench::JsonWriter json(out);
+    json.BeginObject();
+    json.Value("benchmark", "job_bench");
+    json.Value("label", options.label);
+    json.Value("hardware_threads", (long long)std::thread::hardware_concurrency());
+
+    bool allMatch = true;
+    json.BeginArray("results");
+    for (const Workload& workload : workloads)
+    {
+        double singleP50 = 0.0;
+        rasterizer.reset();
+        json.BeginObject();
+        json.Value("workload", workload.name);
+        json.Value(workload.unit, workload.items);
+        json.BeginArray("runs");
+        for (long long threads : options.threads)
+        {
+            JobSystem jobs((int)std::max(1LL, threads));
+            for (int i = 0; i < options.warmup; ++i)
+                workload.run(jobs);
+
+            const JobStats before = jobs.GetStats();
+            std::vector<double> ms;
+            for (int i = 0; i < options.iterations; ++i)
+            {
+                bench::Clock::time_point start = bench::Clock::now();
+                workload.run(jobs);
+                ms.push_back(bench::ElapsedMs(start));
+            }
+            const JobStats after = jobs.GetStats();
+            bench::Summary summary = bench::Summarize(ms);
+            if (singleP50 == 0.0)
+                singleP50 = summary.p50;
+
+            bool match = workload.check(jobs);
+            if (!match)
+            {
+                std::fprintf(stderr, "%s with %lld threads differs from the reference\n", workload.name, threads);
+                allMatch = false;
+            }
+
+            json.BeginObject();
+            json.Value("threads", jobs.GetThreadCount());
+            json.Summary("ms", summary);
+            json.Value("speedup", singleP50 / summary.p50);
+            if (!workload.ownScheduler)
+            {
+                json.Value("jobs_per_iteration", (after.executed - before.executed) / (size_t)options.iterations);
+                json.Value("stolen_per_iteration", (after.stolen - before.stolen) / (size_t)options.iterations);
+            }
+            json.Value("matches_reference", match);
+            json.EndObject();
+        }
+        json.EndArray();
+        json.EndObject();
+    }
+    json.EndArray();
+    json.Value("outputs_match", allMatch);
+    json.EndObject();
+
+    if (out != stdout)
+        std::fclose(out);
+
+    return allMatch ? 0 : 1;
+}
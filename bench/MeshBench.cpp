@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchCommon.h"
+#include "JobSystem.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+
+// Mesh loading throughput (CPU only, no GL), JSON on stdout (or --output FILE).
+// Usage: mesh_bench [--triangles N] [--threads 1,2,4] [--iterations N]
+//                   [--dir DIR] [--keep] [--label TEXT]
+// Writes one generated mesh as OBJ, ASCII PLY, binary PLY and .rmesh into DIR
+// (a temporary directory by default), then loads each format per thread
+// count. Reported per run: p50 ms, MB/s of file read, and the peak resident
+// memory the load added over the baseline. rmesh_mapped walks the mapping in
+// upload-sized slices and releases each one, the way Renderer::LoadMesh feeds
+// glBufferSubData. Files are read from the page cache (they were just written),
+// so this measures parsing, not the disk.
+// The "optimize" section runs MeshOptimizer::Optimize over the same mesh as
+// generated, with its triangles shuffled, and unindexed (three vertices of its
+// own per triangle), and reports the vertex cache figures before and after.
+
+namespace
+{
+struct Options
+{
+    long long triangles = 2000000;
+    std::vector<long long> threads;
+    int iterations = 5;
+    std::string dir;
+    bool keep = false;
+    std::string label;
+    std::string output;
+};
+
+const size_t kSliceBytes = 64u << 20; // Matches the renderer's upload slices
+
+std::vector<long long> DefaultThreadCounts()
+{
+    long long hardware = (long long)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<long long> counts;
+    for (long long count = 1; count < hardware; count *= 2)
+        counts.push_back(count);
+    counts.push_back(hardware);
+    return counts;
+}
+
+// Rolling height field, side x side vertices, two triangles per cell
+MeshData MakeMesh(long long triangles)
+{
+    size_t side = std::max<size_t>(2, (size_t)std::sqrt((double)triangles / 2.0) + 1);
+    MeshData mesh;
+    mesh.positions.reserve(side * side * 3);
+    for (size_t z = 0; z < side; ++z)
+    {
+        for (size_t x = 0; x < side; ++x)
+        {
+            float u = (float)x / (side - 1), v = (float)z / (side - 1);
+            mesh.positions.push_back(u * 2.0f - 1.0f);
+            mesh.positions.push_back(0.1f * std::sin(u * 20.0f) * std::cos(v * 17.0f));
+            mesh.positions.push_back(v * 2.0f - 1.0f);
+        }
+    }
+    mesh.indices.reserve((side - 1) * (side - 1) * 6);
+    for (size_t z = 0; z + 1 < side; ++z)
+    {
+        for (size_t x = 0; x + 1 < side; ++x)
+        {
+            uint32_t a = (uint32_t)(z * side + x), b = a + 1, c = a + (uint32_t)side, d = c + 1;
+            uint32_t quad[6] = { a, c, b, b, c, d };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+    MeshLoader::ComputeBounds(mesh);
+    return mesh;
+}
+
+// %.9g round-trips a float, so the text formats must load back exactly
+bool WriteObj(const std::string& path, const MeshData& mesh)
+{
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+    std::fprintf(file, "# mesh_bench\n");
+    for (size_t i = 0; i < mesh.positions.size(); i += 3)
+        std::fprintf(file, "v %.9g %.9g %.9g\n", mesh.positions[i], mesh.positions[i + 1], mesh.positions[i + 2]);
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        std::fprintf(file, "f %u %u %u\n", mesh.indices[i] + 1, mesh.indices[i + 1] + 1, mesh.indices[i + 2] + 1);
+    return std::fclose(file) == 0;
+}
+
+bool WritePly(const std::string& path, const MeshData& mesh, bool binary)
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    std::fprintf(file, "ply\nformat %s 1.0\nelement vertex %zu\nproperty float x\nproperty float y\nproperty float z\n"
+                       "element face %zu\nproperty list uchar int vertex_indices\nend_header\n",
+                 binary ? "binary_little_endian" : "ascii", mesh.GetVertexCount(), mesh.GetTriangleCount());
+    if (binary)
+    {
+        std::fwrite(mesh.positions.data(), sizeof(float), mesh.positions.size(), file);
+        std::vector<unsigned char> faces(mesh.GetTriangleCount() * 13);
+        for (size_t i = 0; i < mesh.GetTriangleCount(); ++i)
+        {
+            faces[i * 13] = 3;
+            std::memcpy(&faces[i * 13 + 1], &mesh.indices[i * 3], 12);
+        }
+        std::fwrite(faces.data(), 1, faces.size(), file);
+    }
+    else
+    {
+        for (size_t i = 0; i < mesh.positions.size(); i += 3)
+            std::fprintf(file, "%.9g %.9g %.9g\n", mesh.positions[i], mesh.positions[i + 1], mesh.positions[i + 2]);
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+            std::fprintf(file, "3 %u %u %u\n", mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]);
+    }
+    return std::fclose(file) == 0;
+}
+
+// VmHWM / VmRSS in bytes from /proc/self/status; 0 where there is no procfs
+size_t ReadStatus(const char* field)
+{
+    FILE* file = std::fopen("/proc/self/status", "r");
+    if (!file)
+        return 0;
+    char line[256];
+    size_t kb = 0;
+    size_t length = std::strlen(field);
+    while (std::fgets(line, sizeof(line), file))
+    {
+        if (std::strncmp(line, field, length) == 0 && line[length] == ':')
+        {
+            kb = (size_t)std::strtoull(line + length + 1, nullptr, 10);
+            break;
+        }
+    }
+    std::fclose(file);
+    return kb * 1024;
+}
+
+// Drops the high-water mark back to the current RSS (Linux 4.0+)
+bool ResetPeakRss()
+{
+    FILE* file = std::fopen("/proc/self/clear_refs", "w");
+    if (!file)
+        return false;
+    bool ok = std::fputs("5", file) >= 0;
+    return std::fclose(file) == 0 && ok;
+}
+
+// Same triangles in a random (fixed seed) order, as exported by tools that do not care
+MeshData ShuffleTriangles(const MeshData& mesh)
+{
+    MeshData shuffled = mesh;
+    uint32_t state = 12345u;
+    for (size_t i = shuffled.GetTriangleCount(); i > 1; --i)
+    {
+        state = state * 1664525u + 1013904223u;
+        size_t j = (size_t)(((uint64_t)state * i) >> 32);
+        std::swap_ranges(&shuffled.indices[(i - 1) * 3], &shuffled.indices[(i - 1) * 3] + 3, &shuffled.indices[j * 3]);
+    }
+    return shuffled;
+}
+
+// Every corner a vertex of its own, like geometry drawn with glDrawArrays
+MeshData SplitVertices(const MeshData& mesh)
+{
+    MeshData split;
+    split.positions.reserve(mesh.indices.size() * 3);
+    split.indices.resize(mesh.indices.size());
+    for (size_t i = 0; i < mesh.indices.size(); ++i)
+    {
+        const float* position = &mesh.positions[mesh.indices[i] * 3];
+        split.positions.insert(split.positions.end(), position, position + 3);
+        split.indices[i] = (uint32_t)i;
+    }
+    std::copy(mesh.boundsMin, mesh.boundsMin + 3, split.boundsMin);
+    std::copy(mesh.boundsMax, mesh.boundsMax + 3, split.boundsMax);
+    return split;
+}
+
+void WriteCacheStats(bench::JsonWriter& json, const char* key, const MeshData& mesh)
+{
+    VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.GetVertexCount());
+    json.BeginObject(key);
+    json.Value("vertices", mesh.GetVertexCount());
+    json.Value("triangles", mesh.GetTriangleCount());
+    json.Value("acmr", stats.acmr);
+    json.Value("atvr", stats.atvr);
+    json.Value("overfetch", stats.overfetch);
+    json.EndObject();
+}
+
+bool SameMesh(const MeshData& a, const MeshData& b)
+{
+    return a.positions == b.positions && a.indices == b.indices
+        && std::equal(a.boundsMin, a.boundsMin + 3, b.boundsMin) && std::equal(a.boundsMax, a.boundsMax + 3, b.boundsMax);
+}
+
+bool ParseArgs(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--triangles") == 0 && hasValue) options.triangles = std::max(2LL, bench::ParseSizeList(argv[++i]).front());
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) options.threads = bench::ParseSizeList(argv[++i]);
+        else if (std::strcmp(argv[i], "--iterations") == 0 && hasValue) options.iterations = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--dir") == 0 && hasValue) options.dir = argv[++i];
+        else if (std::strcmp(argv[i], "--keep") == 0) options.keep = true;
+        else if (std::strcmp(argv[i], "--label") == 0 && hasValue) options.label = argv[++i];
+        else if (std::strcmp(argv[i], "--output") == 0 && hasValue) options.output = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return false;
+        }
+    }
+    if (options.threads.empty())
+        options.threads = DefaultThreadCounts();
+    return true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseArgs(argc, argv, options))
+        return 2;
+
+    FILE* out = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "w");
+    if (!out)
+    {
+        std::fprintf(stderr, "Cannot open %s\n", options.output.c_str());
+        return 1;
+    }
+
+    namespace fs = std::filesystem;
+    fs::path dir = options.dir.empty() ? fs::temp_directory_path() / "mesh_bench" : fs::path(options.dir);
+    std::error_code error;
+    fs::create_directories(dir, error);
+
+    struct Format
+    {
+        const char* name;
+        std::string path;
+        bool mapped; // Walk the .rmesh mapping instead of loading into MeshData
+    };
+    std::vector<Format> formats = {
+        { "obj", (dir / "bench.obj").string(), false },
+        { "ply_ascii", (dir / "bench_ascii.ply").string(), false },
+        { "ply_binary", (dir / "bench_binary.ply").string(), false },
+        { "rmesh", (dir / "bench.rmesh").string(), false },
+        { "rmesh_mapped", (dir / "bench.rmesh").string(), true },
+    };
+
+    size_t referenceVertices, referenceTriangles;
+    {
+        MeshData reference = MakeMesh(options.triangles);
+        referenceVertices = reference.GetVertexCount();
+        referenceTriangles = reference.GetTriangleCount();
+        if (!WriteObj(formats[0].path, reference) || !WritePly(formats[1].path, reference, false)
+            || !WritePly(formats[2].path, reference, true) || !MeshFile::Write(formats[3].path, reference))
+        {
+            std::fprintf(stderr, "Cannot write the test meshes to %s\n", dir.string().c_str());
+            return 1;
+        }
+    }
+    // Regenerated for the checks so the loads start from the same baseline
+    const MeshData reference = MakeMesh(options.triangles);
+
+    bench::JsonWriter json(out);
+    json.BeginObject();
+    json.Value("benchmark", "mesh_bench");
+    json.Value("label", options.label);
+    json.Value("hardware_threads", (long long)std::thread::hardware_concurrency());
+    json.Value("vertices", referenceVertices);
+    json.Value("triangles", referenceTriangles);
+    json.Value("peak_rss_measured", ResetPeakRss());
+
+    bool allMatch = true;
+    json.BeginArray("results");
+    for (const Format& format : formats)
+    {
+        const double fileMb = (double)fs::file_size(format.path, error) / (1024.0 * 1024.0);
+        json.BeginObject();
+        json.Value("format", format.name);
+        json.Value("file_mb", fileMb);
+        json.BeginArray("runs");
+        for (long long threads : options.threads)
+        {
+            // A mapped file is never parsed, so one thread count says it all
+            if (format.mapped && threads != options.threads.front())
+                continue;
+
+            JobSystem jobs((int)std::max(1LL, threads));
+            std::vector<double> ms;
+            size_t peakBytes = 0;
+            bool match = true;
+            for (int i = 0; i < options.iterations; ++i)
+            {
+                MeshData mesh;
+                ResetPeakRss();
+                const size_t baseline = ReadStatus("VmRSS");
+                bench::Clock::time_point start = bench::Clock::now();
+                if (format.mapped)
+                {
+                    MeshFile file;
+                    match = file.Open(format.path) && match;
+                    const MappedFile& mapping = file.GetMapping();
+                    unsigned long long sum = 0;
+                    for (size_t offset = 0; offset < mapping.GetSize(); offset += kSliceBytes)
+                    {
+                        size_t size = std::min(kSliceBytes, mapping.GetSize() - offset);
+                        for (size_t page = offset; page < offset + size; page += 4096)
+                            sum += mapping.GetData()[page];
+                        mapping.Release(offset, size);
+                    }
+                    ms.push_back(bench::ElapsedMs(start));
+                    match = match && file.GetVertexCount() == referenceVertices && file.GetIndexCount() == referenceTriangles * 3
+                        && std::equal(reference.indices.begin(), reference.indices.end(), file.GetIndices()) && sum != ~0ull;
+                }
+                else
+                {
+                    match = MeshLoader::Load(format.path, mesh, &jobs) && match;
+                    ms.push_back(bench::ElapsedMs(start));
+                    match = match && SameMesh(mesh, reference);
+                }
+                size_t peak = ReadStatus("VmHWM");
+                peakBytes = std::max(peakBytes, peak > baseline ? peak - baseline : 0);
+            }
+
+            bench::Summary summary = bench::Summarize(ms);
+            if (!match)
+            {
+                std::fprintf(stderr, "%s with %lld threads differs from the generated mesh\n", format.name, threads);
+                allMatch = false;
+            }
+
+            json.BeginObject();
+            json.Value("threads", jobs.GetThreadCount());
+            json.Summary("ms", summary);
+            json.Value("mb_per_s", summary.p50 > 0.0 ? fileMb * 1000.0 / summary.p50 : 0.0);
+            json.Value("peak_rss_added_mb", (double)peakBytes / (1024.0 * 1024.0));
+            json.Value("matches_reference", match);
+            json.EndObject();
+        }
+        json.EndArray();
+        json.EndObject();
+    }
+    json.EndArray();
+
+    json.BeginArray("optimize");
+    {
+        struct Variant
+        {
+            const char* name;
+            MeshData mesh;
+        };
+        Variant variants[] = {
+            { "generated", reference },
+            { "shuffled", ShuffleTriangles(reference) },
+            { "split_vertices", SplitVertices(reference) },
+        };
+        for (Variant& variant : variants)
+        {
+            json.BeginObject();
+            json.Value("mesh", variant.name);
+            WriteCacheStats(json, "before", variant.mesh);
+            bench::Clock::time_point start = bench::Clock::now();
+            MeshOptimizer::Optimize(variant.mesh);
+            json.Value("optimize_ms", bench::ElapsedMs(start));
+            WriteCacheStats(json, "after", variant.mesh);
+            json.EndObject();
+        }
+    }
+    json.EndArray();
+    json.EndObject();
+
+    if (out != stdout)
+        std::fclose(out);
+    if (!options.keep)
+    {
+        for (const Format& format : formats)
+            fs::remove(format.path, error);
+        if (options.dir.empty())
+            fs::remove(dir, error);
+    }
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "BenchCommon.h"
+#include "PixelConvert.h"
+
+// Pixel conversion throughput (CPU only, no GL), JSON on stdout (or --output FILE).
+// Usage: pixel_bench [--sizes 64k,1M,16M] [--iterations N] [--warmup N] [--label TEXT]
+// GB/s counts bytes read plus bytes written. Every SIMD level is checked
+// against the scalar kernels before it is timed.
+
+namespace
+{
+struct Options
+{
+    std::vector<long long> sizes = { 65536, 1048576, 16777216 };
+    int iterations = 20;
+    int warmup = 2;
+    std::string label;
+    std::string output;
+};
+
+// The loop Renderer::LoadTexture used before the kernels existed
+void LegacyRgbAlphaToRgba(const unsigned char* data, const unsigned char* alpha, unsigned char* rgba_data, int pixels)
+{
+    for (int i = 0; i < pixels; ++i)
+    {
+        rgba_data[i * 4 + 0] = data[i * 3 + 0]; // R
+        rgba_data[i * 4 + 1] = data[i * 3 + 1]; // G
+        rgba_data[i * 4 + 2] = data[i * 3 + 2]; // B
+        rgba_data[i * 4 + 3] = alpha ? alpha[i] : 255; // A
+    }
+}
+
+struct Buffers
+{
+    std::vector<unsigned char> rgb, alpha, rgba, rgbaSource, yuv;
+    std::vector<float> linear;
+};
+
+struct Kernel
+{
+    const char* name;
+    double bytesPerPixel; // Read + written
+    std::function<void(Buffers&, size_t)> prepare; // Untimed, e.g. restore in-place input
+    std::function<void(Buffers&, size_t)> run;
+    std::function<bool(const Buffers&, const Buffers&, size_t)> same;
+};
+
+bool SameBytes(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, size_t count)
+{
+    return std::memcmp(a.data(), b.data(), count) == 0;
+}
+
+// The source as 1920-pixel rows, the way FrameCapture converts a video frame
+void RgbaToYuv420Frame(Buffers& b, size_t pixels)
+{
+    const size_t width = std::min<size_t>(pixels, 1920);
+    const size_t rows = pixels / width;
+    unsigned char* luma = b.yuv.data();
+    unsigned char* u = luma + width * rows;
+    unsigned char* v = u + (width + 1) / 2 * ((rows + 1) / 2);
+    for (size_t y = 0; y < rows; y += 2)
+    {
+        size_t y1 = y + 1 < rows ? y + 1 : y;
+        PixelConvert::RgbaToYuv420(b.rgbaSource.data() + y * width * 4, b.rgbaSource.data() + y1 * width * 4,
+                                   luma + y * width, luma + y1 * width,
+                                   u + y / 2 * ((width + 1) / 2), v + y / 2 * ((width + 1) / 2), width);
+    }
+}
+
+std::vector<Kernel> MakeKernels()
+{
+    auto noPrepare = [](Buffers&, size_t) {};
+    auto restoreRgba = [](Buffers& b, size_t n) { std::memcpy(b.rgba.data(), b.rgbaSource.data(), n * 4); };
+    auto sameRgba = [](const Buffers& a, const Buffers& b, size_t n) { return SameBytes(a.rgba, b.rgba, n * 4); };
+
+    std::vector<Kernel> kernels;
+    kernels.push_back({ "rgb_alpha_to_rgba", 8.0, noPrepare,
+        [](Buffers& b, size_t n) { PixelConvert::RgbAlphaToRgba(b.rgb.data(), b.alpha.data(), b.rgba.data(), n); },
+        sameRgba });
+    kernels.push_back({ "rgb_to_rgba", 7.0, noPrepare,
+        [](Buffers& b, size_t n) { PixelConvert::RgbToRgba(b.rgb.data(), 255, b.rgba.data(), n); },
+        sameRgba });
+    kernels.push_back({ "premultiply_alpha", 8.0, restoreRgba,
+        [](Buffers& b, size_t n) { PixelConvert::PremultiplyAlpha(b.rgba.data(), n); },
+        sameRgba });
+    kernels.push_back({ "srgb_to_linear", 20.0, noPrepare,
+        [](Buffers& b, size_t n) { PixelConvert::SrgbToLinear(b.rgbaSource.data(), b.linear.data(), n); },
+        [](const Buffers& a, const Buffers& b, size_t n) {
+            return std::memcmp(a.linear.data(), b.linear.data(), n * 4 * sizeof(float)) == 0;
+        } });
+    kernels.push_back({ "rgba_to_yuv420", 5.5, noPrepare, RgbaToYuv420Frame,
+        [](const Buffers& a, const Buffers& b, size_t) { return a.yuv == b.yuv; } });
+    return kernels;
+}
+
+Buffers MakeBuffers(size_t pixels)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    Buffers b;
+    b.rgb.resize(pixels * 3);
+    b.alpha.resize(pixels);
+    b.rgba.resize(pixels * 4);
+    b.rgbaSource.resize(pixels * 4);
+    b.linear.resize(pixels * 4);
+    b.yuv.resize(pixels * 2 + 4);
+    for (unsigned char& v : b.rgb) v = (unsigned char)byte(rng);
+    for (unsigned char& v : b.alpha) v = (unsigned char)byte(rng);
+    for (unsigned char& v : b.rgbaSource) v = (unsigned char)byte(rng);
+    return b;
+}
+
+// Exact reference for the premultiply rounding, independent of the kernels
+bool CheckPremultiplyReference(const Buffers& b, size_t pixels)
+{
+    for (size_t i = 0; i < pixels * 4; ++i)
+    {
+        unsigned char source = b.rgbaSource[i];
+        unsigned char alpha = b.rgbaSource[i - i % 4 + 3];
+        unsigned char expected = i % 4 == 3 ? source : (unsigned char)std::lround(source * alpha / 255.0);
+        if (b.rgba[i] != expected)
+            return false;
+    }
+    return true;
+}
+
+double Measure(const Kernel& kernel, Buffers& buffers, size_t pixels, int warmup, int iterations, bench::Summary& summary)
+{
+    for (int i = 0; i < warmup; ++i)
+    {
+        kernel.prepare(buffers, pixels);
+        kernel.run(buffers, pixels);
+    }
+
+    std::vector<double> ms;
+    for (int i = 0; i < iterations; ++i)
+    {
+        kernel.prepare(buffers, pixels);
+        bench::Clock::time_point start = bench::Clock::now();
+        kernel.run(buffers, pixels);
+        ms.push_back(bench::ElapsedMs(start));
+    }
+    summary = bench::Summarize(ms);
+    return kernel.bytesPerPixel * pixels / (summary.p50 * 1.0e6);
+}
+
+void WriteResult(bench::JsonWriter& json, const char* kernel, const char* level, size_t pixels,
+                 const bench::Summary& summary, double gbPerSecond, double speedup)
+{
+    json.BeginObject();
+    json.Value("kernel", kernel);
+    json.Value("level", level);
+    json.Value("pixels", pixels);
+    json.Summary("ms", summary);
+    json.Value("gb_per_s", gbPerSecond);
+    if (speedup > 0.0)
+        json.Value("speedup_vs_legacy", speedup);
+    json.EndObject();
+}
+
+bool ParseArgs(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--sizes") == 0 && hasValue) options.sizes = bench::ParseSizeList(argv[++i]);
+        else if (std::strcmp(argv[i], "--iterations") == 0 && hasValue) options.iterations = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) options.warmup = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--label") == 0 && hasValue) options.label = argv[++i];
+        else if (std::strcmp(argv[i], "--output") == 0 && hasValue) options.output = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseArgs(argc, argv, options))
+        return 2;
+
+    FILE* out = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "w");
+    if (!out)
+    {
+        std::fprintf(stderr, "Cannot open %s\n", options.output.c_str());
+        return 1;
+    }
+
+    PixelConvert::SimdLevel supported = PixelConvert::GetSupportedLevel();
+    std::vector<PixelConvert::SimdLevel> levels = { PixelConvert::SimdLevel::Scalar };
+    if ((int)supported >= (int)PixelConvert::SimdLevel::SSE2) levels.push_back(PixelConvert::SimdLevel::SSE2);
+    if ((int)supported >= (int)PixelConvert::SimdLevel::AVX2) levels.push_back(PixelConvert::SimdLevel::AVX2);
+
+    bench::JsonWriter json(out);
+    json.BeginObject();
+    json.Value("benchmark", "pixel_bench");
+    json.Value("label", options.label);
+    json.Value("simd_supported", PixelConvert::GetLevelName(supported));
+
+    bool allMatch = true;
+    std::vector<Kernel> kernels = MakeKernels();
+    json.BeginArray("results");
+    for (long long size : options.sizes)
+    {
+        size_t pixels = (size_t)std::max(1LL, size);
+        Buffers buffers = MakeBuffers(pixels);
+
+        // Baseline: the old per-byte loop, same GB/s accounting as rgb_alpha_to_rgba
+        Kernel legacy = { "rgb_alpha_to_rgba", 8.0, [](Buffers&, size_t) {},
+            [](Buffers& b, size_t n) { LegacyRgbAlphaToRgba(b.rgb.data(), b.alpha.data(), b.rgba.data(), (int)n); },
+            nullptr };
+        bench::Summary summary;
+        double legacyGbPerSecond = Measure(legacy, buffers, pixels, options.warmup, options.iterations, summary);
+        WriteResult(json, "rgb_alpha_to_rgba", "legacy_loop", pixels, summary, legacyGbPerSecond, 1.0);
+        Buffers legacyOutput = buffers;
+
+        for (const Kernel& kernel : kernels)
+        {
+            Buffers reference;
+            for (PixelConvert::SimdLevel level : levels)
+            {
+                PixelConvert::SetLevel(level);
+                kernel.prepare(buffers, pixels);
+                kernel.run(buffers, pixels);
+
+                bool match = true;
+                if (level == PixelConvert::SimdLevel::Scalar)
+                {
+                    reference = buffers;
+                    if (std::strcmp(kernel.name, "rgb_alpha_to_rgba") == 0)
+                        match = kernel.same(buffers, legacyOutput, pixels);
+                    else if (std::strcmp(kernel.name, "premultiply_alpha") == 0)
+                        match = CheckPremultiplyReference(buffers, pixels);
+                }
+                else
+                {
+                    match = kernel.same(buffers, reference, pixels);
+                }
+                if (!match)
+                {
+                    std::fprintf(stderr, "%s/%s output differs from the reference at %zu pixels\n",
+                                 kernel.name, PixelConvert::GetLevelName(level), pixels);
+                    allMatch = false;
+                }
+
+                double gbPerSecond = Measure(kernel, buffers, pixels, options.warmup, options.iterations, summary);
+                double speedup = std::strcmp(kernel.name, "rgb_alpha_to_rgba") == 0 ? gbPerSecond / legacyGbPerSecond : -1.0;
+                WriteResult(json, kernel.name, PixelConvert::GetLevelName(level), pixels, summary, gbPerSecond, speedup);
+            }
+        }
+    }
+    json.EndArray();
+    json.Value("outputs_match", allMatch);
+    json.EndObject();
+
+    if (out != stdout)
+        std::fclose(out);
+
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,1456 @@
+#include <GL/glew.h>
+#include <wx/init.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchCommon.h"
+#include "HeadlessContext.h"
+#include "LatencyMonitor.h"
+#include "GLStateCache.h"
+#include "OffscreenTarget.h"
+#include "RenderQueue.h"
+#include "Renderer.h"
+#include "PixelConvert.h"
+#include "ShaderProgram.h"
+#include "Shaders.h"
+#include "SoftwareRenderer.h"
+#include "SpriteBatch.h"
+#include "StreamBuffer.h"
+#include "TextureAtlas.h"
+#include "Trace.h"
+
+// Headless Renderer benchmarks, JSON on stdout (or --output FILE).
+// Usage: renderer_bench [--sizes 1,1k,100k,1M] [--iterations N] [--warmup N]
+//                       [--width N] [--height N] [--max-per-object N] [--icons N]
+//                       [--stream-mb 10,50,100] [--queue-sizes 10k,100k,1M] [--toolbar N]
+//                       [--pick-sizes 1k,10k,100k] [--latency-sizes 1,10k,100k]
+//                       [--capture-size 1920x1080] [--capture-frames N] [--raster-threads 1,2,4]
+//                       [--mesh FILE.obj|FILE.ply] [--label TEXT]
+// stream_regrow checks that the vertex ring can grow in the middle of a frame.
+// --mesh adds frames drawing that mesh, loaded with and without MeshOptimizer.
+
+// Allocation counting. Every replaceable form is replaced, nothrow ones
+// included, so each new pairs with a delete from the same malloc family.
+static std::atomic<long long> g_allocationCount(0);
+static std::atomic<long long> g_allocatedBytes(0);
+
+// Null on failure, for the nothrow forms
+static void* CountedAlloc(size_t size, size_t alignment)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add((long long)size, std::memory_order_relaxed);
+    size = size ? size : 1;
+    // aligned_alloc wants the size to be a multiple of the alignment
+    return alignment ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                     : std::malloc(size);
+}
+
+static void* CountedAllocOrThrow(size_t size, size_t alignment)
+{
+    void* ptr = CountedAlloc(size, alignment);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size) { return CountedAllocOrThrow(size, 0); }
+void* operator new[](size_t size) { return CountedAllocOrThrow(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return CountedAllocOrThrow(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return CountedAllocOrThrow(size, (size_t)alignment); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAlloc(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAlloc(size, (size_t)alignment); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+// Access to the private Renderer stage being measured
+class RendererBench
+{
+public:
+    static unsigned int LoadTexture(Renderer& renderer, const std::string& path)
+    {
+        return renderer.LoadTexture(path);
+    }
+
+    static const StreamBuffer& Stream(const Renderer& renderer)
+    {
+        return renderer.m_streamBuffer;
+    }
+
+    static std::shared_ptr<const SpatialIndex> TriangleIndex(const Renderer& renderer)
+    {
+        std::lock_guard<std::mutex> lock(renderer.m_pickMutex);
+        return renderer.m_triangleIndex;
+    }
+};
+
+namespace
+{
+struct Options
+{
+    std::vector<long long> sizes = { 1, 1000, 100000, 1000000 };
+    int iterations = 50;
+    int warmup = 5;
+    int width = 1280;
+    int height = 720;
+    long long maxPerObject = 100000;
+    int icons = 64;
+    std::vector<long long> streamMegabytes = { 10, 25, 50, 100 };
+    std::vector<long long> queueSizes = { 10000, 100000, 1000000 };
+    int toolbar = 50;
+    std::vector<long long> pickSizes = { 1000, 10000, 100000 };
+    std::vector<long long> latencySizes = { 1, 10000, 100000 };
+    int captureWidth = 1920;
+    int captureHeight = 1080;
+    int captureFrames = 240;
+    std::vector<long long> rasterThreads = { 1, (long long)std::max(1u, std::thread::hardware_concurrency()) };
+    std::string mesh;
+    std::string label;
+    std::string output;
+};
+
+std::vector<TriangleInstance> MakeScene(long long count)
+{
+    // Fixed seed so every run draws the same scene
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // Keep the covered area roughly constant so the sweep measures per-object cost
+    float scale = count > 1 ? std::max(0.005f, 0.5f / std::sqrt((float)count)) : 1.0f;
+
+    std::vector<TriangleInstance> instances((size_t)count);
+    for (TriangleInstance& instance : instances)
+    {
+        instance.offset[0] = count > 1 ? unit(rng) * 2.0f - 1.0f : 0.0f;
+        instance.offset[1] = count > 1 ? unit(rng) * 2.0f - 1.0f : 0.0f;
+        instance.rotation = unit(rng) * 360.0f;
+        instance.scale = scale;
+        for (float& channel : instance.colors)
+            channel = unit(rng);
+    }
+    return instances;
+}
+
+// Fewer frames for the big scenes so a full sweep stays in minutes
+int IterationsFor(const Options& options, long long triangles)
+{
+    if (triangles >= 100000)
+        return std::max(3, options.iterations / 10);
+    return options.iterations;
+}
+
+void MeasureFrames(bench::JsonWriter& json, Renderer& renderer, const char* name,
+                   long long triangles, int warmup, int iterations)
+{
+    unsigned int query = 0;
+    glGenQueries(1, &query);
+
+    for (int i = 0; i < warmup; ++i)
+        renderer.Render();
+    glFinish();
+    renderer.GetProfiler().ResetStats();
+
+    std::vector<double> cpuMs, frameMs, gpuMs;
+    long long allocations = 0, allocatedBytes = 0;
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        long long allocationsBefore = g_allocationCount.load();
+        long long bytesBefore = g_allocatedBytes.load();
+
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        bench::Clock::time_point start = bench::Clock::now();
+        renderer.Render();
+        cpuMs.push_back(bench::ElapsedMs(start));
+        glEndQuery(GL_TIME_ELAPSED);
+        glFinish();
+        frameMs.push_back(bench::ElapsedMs(start));
+
+        allocations += g_allocationCount.load() - allocationsBefore;
+        allocatedBytes += g_allocatedBytes.load() - bytesBefore;
+
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+        gpuMs.push_back(elapsedNs / 1.0e6);
+    }
+
+    glDeleteQueries(1, &query);
+
+    json.BeginObject();
+    json.Value("name", name);
+    json.Value("triangles", triangles);
+    json.Value("iterations", iterations);
+    json.Value("draw_calls", (long long)renderer.GetFrameStats().drawCalls);
+    json.Value("state_changes", (long long)renderer.GetFrameStats().stateChanges);
+    json.Value("state_changes_skipped", (long long)renderer.GetFrameStats().stateChangesSkipped);
+    json.Summary("cpu_ms", bench::Summarize(cpuMs));
+    json.Summary("frame_ms", bench::Summarize(frameMs));
+    json.Summary("gpu_ms", bench::Summarize(gpuMs));
+    json.Value("allocations_per_frame", (double)allocations / iterations);
+    json.Value("allocated_bytes_per_frame", (double)allocatedBytes / iterations);
+
+    // Per-pass timer queries, as seen through the Renderer API
+    json.BeginObject("passes");
+    const RenderPass passes[] = { RenderPass::Triangle, RenderPass::Button };
+    for (RenderPass pass : passes)
+    {
+        PassTimingStats stats = renderer.GetPassTimings(pass);
+        json.BeginObject(GpuProfiler::GetPassName(pass));
+        json.Value("min_ms", stats.minMs);
+        json.Value("avg_ms", stats.avgMs);
+        json.Value("p99_ms", stats.p99Ms);
+        json.Value("samples", stats.samples);
+        json.EndObject();
+    }
+    json.EndObject();
+    json.EndObject();
+}
+
+template <typename Fn>
+void MeasureCalls(bench::JsonWriter& json, const char* name, int warmup, int iterations, Fn&& fn)
+{
+    for (int i = 0; i < warmup; ++i)
+        fn();
+    glFinish();
+
+    std::vector<double> callMs;
+    long long allocationsBefore = g_allocationCount.load();
+    for (int i = 0; i < iterations; ++i)
+    {
+        bench::Clock::time_point start = bench::Clock::now();
+        fn();
+        glFinish();
+        callMs.push_back(bench::ElapsedMs(start));
+    }
+    long long allocations = g_allocationCount.load() - allocationsBefore;
+
+    json.BeginObject();
+    json.Value("name", name);
+    json.Value("iterations", iterations);
+    json.Summary("call_ms", bench::Summarize(callMs));
+    json.Value("allocations_per_call", (double)allocations / iterations);
+    json.EndObject();
+}
+
+// N distinct copies of the button icon, so the loader cannot dedupe them
+std::vector<std::string> MakeIconSet(int count)
+{
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "renderer_bench_icons";
+    fs::create_directories(dir);
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < count; ++i)
+    {
+        fs::path path = dir / ("icon_" + std::to_string(i) + ".png");
+        fs::copy_file("icon/button_icon.png", path, fs::copy_options::overwrite_existing);
+        paths.push_back(path.string());
+    }
+    return paths;
+}
+
+// Sync LoadTexture loop vs the async loader: time the render thread is blocked
+// before it can draw (request_ms) and until every icon is on the GPU (all_ready_ms)
+void MeasureTextureLoading(bench::JsonWriter& json, Renderer& renderer, int icons, int iterations)
+{
+    std::vector<std::string> paths = MakeIconSet(icons);
+    std::vector<double> syncMs, requestMs, readyMs;
+    int workers = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        std::vector<unsigned int> textures;
+        bench::Clock::time_point start = bench::Clock::now();
+        for (const std::string& path : paths)
+            textures.push_back(RendererBench::LoadTexture(renderer, path));
+        glFinish();
+        syncMs.push_back(bench::ElapsedMs(start));
+        glDeleteTextures((GLsizei)textures.size(), textures.data());
+
+        TextureLoader loader;
+        loader.Initialize();
+        workers = loader.GetWorkerCount();
+        start = bench::Clock::now();
+        for (const std::string& path : paths)
+            loader.RequestTexture(path);
+        requestMs.push_back(bench::ElapsedMs(start));
+        loader.Flush();
+        glFinish();
+        readyMs.push_back(bench::ElapsedMs(start));
+    }
+
+    json.BeginObject("texture_loading");
+    json.Value("icons", icons);
+    json.Value("iterations", iterations);
+    json.Value("workers", workers);
+    json.Summary("sync_ms", bench::Summarize(syncMs));
+    json.Summary("async_request_ms", bench::Summarize(requestMs));
+    json.Summary("async_all_ready_ms", bench::Summarize(readyMs));
+    json.EndObject();
+}
+
+// Renderer::Initialize to the first finished frame, without a shader cache,
+// with an empty one (compile + store) and with a filled one (binary restore)
+void MeasureStartup(bench::JsonWriter& json, int width, int height, int iterations)
+{
+    namespace fs = std::filesystem;
+    fs::path cacheDir = fs::temp_directory_path() / "renderer_bench_shader_cache";
+
+    const char* driverCache = std::getenv("MESA_SHADER_CACHE_DISABLE");
+    json.BeginObject("startup");
+    json.Value("iterations", iterations);
+    json.Value("mesa_shader_cache_disable", driverCache ? driverCache : "");
+
+    const char* modes[] = { "no_cache", "cold", "warm" };
+    for (const char* mode : modes)
+    {
+        bool useCache = std::strcmp(mode, "no_cache") != 0;
+        bool cold = std::strcmp(mode, "cold") == 0;
+        std::vector<double> firstFrameMs;
+        ShaderCache::Stats stats = {};
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            std::error_code error;
+            if (cold)
+                fs::remove_all(cacheDir, error);
+
+            bench::Clock::time_point start = bench::Clock::now();
+            {
+                Renderer renderer;
+                renderer.SetShaderCache(useCache, cacheDir.string());
+                if (!renderer.Initialize())
+                    return;
+                renderer.GetTextureLoader().Flush();
+                renderer.SetViewport(width, height);
+                renderer.SetTriangleVisible(true);
+                renderer.Render();
+                glFinish();
+                firstFrameMs.push_back(bench::ElapsedMs(start));
+                stats = renderer.GetShaderCache().GetStats();
+            }
+        }
+
+        json.BeginObject(mode);
+        json.Summary("first_frame_ms", bench::Summarize(firstFrameMs));
+        json.Value("cache_hits", (int)stats.hits);
+        json.Value("cache_misses", (int)stats.misses);
+        json.Value("cache_rejected", (int)stats.rejected);
+        json.EndObject();
+    }
+    json.EndObject();
+}
+
+// Streams N MB per frame that the GPU then reads (copied into a scratch
+// buffer), through the ring and through the old single-buffer glBufferSubData
+void MeasureStreaming(bench::JsonWriter& json, const std::vector<long long>& megabytes, int frames)
+{
+    json.BeginArray("streaming");
+    for (long long mb : megabytes)
+    {
+        size_t size = (size_t)std::max(1LL, mb) * 1024 * 1024;
+        std::vector<unsigned char> source(size);
+        for (size_t i = 0; i < size; ++i)
+            source[i] = (unsigned char)(i * 31);
+
+        unsigned int scratch = 0;
+        glGenBuffers(1, &scratch);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_COPY);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        const char* modes[] = { "persistent_ring", "orphan_ring", "buffer_sub_data" };
+        for (const char* mode : modes)
+        {
+            bool subData = std::strcmp(mode, "buffer_sub_data") == 0;
+            StreamBuffer ring;
+            unsigned int single = 0;
+            if (subData)
+            {
+                glGenBuffers(1, &single);
+                glBindBuffer(GL_ARRAY_BUFFER, single);
+                glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+            else
+            {
+                ring.Create(size, std::strcmp(mode, "persistent_ring") == 0);
+            }
+
+            // Persistent mode is only reported when the driver actually provides it
+            if (!subData && std::strcmp(mode, "persistent_ring") == 0 && !ring.IsPersistent())
+                continue;
+
+            std::vector<double> frameMs;
+            glFinish();
+            bench::Clock::time_point total = bench::Clock::now();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                bench::Clock::time_point start = bench::Clock::now();
+                unsigned int buffer = single;
+                size_t offset = 0;
+                if (subData)
+                {
+                    glBindBuffer(GL_ARRAY_BUFFER, single);
+                    glBufferSubData(GL_ARRAY_BUFFER, 0, size, source.data());
+                    glBindBuffer(GL_ARRAY_BUFFER, 0);
+                }
+                else
+                {
+                    void* target = ring.Map(size, offset);
+                    if (target)
+                        std::memcpy(target, source.data(), size);
+                    ring.Unmap();
+                    buffer = ring.GetBuffer();
+                }
+
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size);
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+                ring.EndFrame();
+                frameMs.push_back(bench::ElapsedMs(start));
+            }
+            glFinish();
+            double totalMs = bench::ElapsedMs(total);
+
+            json.BeginObject();
+            json.Value("mode", mode);
+            json.Value("megabytes_per_frame", mb);
+            json.Value("frames", frames);
+            json.Summary("cpu_ms", bench::Summarize(frameMs));
+            json.Value("total_ms_per_frame", totalMs / frames);
+            json.Value("gb_per_s", (double)size * frames / (totalMs * 1.0e6));
+            json.Value("fence_waits", (int)ring.GetStats().fenceWaits);
+            json.Value("orphans", (int)ring.GetStats().orphans);
+            json.EndObject();
+
+            if (single)
+                glDeleteBuffers(1, &single);
+        }
+        glDeleteBuffers(1, &scratch);
+    }
+    json.EndArray();
+}
+
+// Queues N draws over a few programs, textures and vertex arrays in random
+// order and submits them unsorted and radix-sorted. The vertex arrays have no
+// enabled attributes, so every triangle is degenerate and the numbers are
+// submission cost rather than fill.
+// Growing the ring mid-frame. With one instance per sizeof(TriangleInstance)
+// of the first segment, the animated instances fill it exactly and the
+// animated sprites force the regrow after the instances were mapped and
+// bound; one more instance makes the instances themselves regrow it. Either
+// way the regrow frame must match the same scene drawn from static buffers.
+void MeasureStreamRegrow(bench::JsonWriter& json, OffscreenTarget& target, int width, int height)
+{
+    json.BeginArray("stream_regrow");
+    const char* cases[] = { "after_other_stream", "on_first_stream" };
+    for (int extra = 0; extra < 2; ++extra)
+    {
+        std::vector<TriangleInstance> scene;
+        std::vector<unsigned char> pixels, reference;
+        bool hovered = false;
+        unsigned int reallocations = 0;
+        int frame = 0;
+        {
+            Renderer renderer;
+            if (!renderer.Initialize())
+                return;
+            renderer.GetTextureLoader().Flush();
+            renderer.SetViewport(width, height);
+            renderer.SetTriangleVisible(true);
+            const size_t count = RendererBench::Stream(renderer).GetSegmentSize() / sizeof(TriangleInstance) + extra;
+
+            // Both streams change every frame; the second frame puts them in the ring
+            for (; frame < 4 && reallocations == 0; ++frame)
+            {
+                scene = MakeScene((long long)count);
+                for (TriangleInstance& instance : scene)
+                    instance.rotation += 10.0f * frame;
+                hovered = frame % 2 == 1;
+                renderer.SetTriangleInstances(scene);
+                renderer.SetButtonHovered(0, hovered);
+                renderer.Render();
+                reallocations = RendererBench::Stream(renderer).GetStats().reallocations;
+            }
+            glFinish();
+            target.ReadPixels(pixels);
+        }
+        {
+            Renderer renderer;
+            if (!renderer.Initialize())
+                return;
+            renderer.GetTextureLoader().Flush();
+            renderer.SetViewport(width, height);
+            renderer.SetTriangleVisible(true);
+            renderer.SetTriangleInstances(scene);
+            renderer.SetButtonHovered(0, hovered);
+            renderer.Render();
+            glFinish();
+            target.ReadPixels(reference);
+        }
+
+        json.BeginObject();
+        json.Value("case", cases[extra]);
+        json.Value("instances", scene.size());
+        json.Value("regrow_frame", frame - 1);
+        json.Value("reallocations", (int)reallocations);
+        json.Value("matches_static", pixels == reference);
+        json.EndObject();
+    }
+    json.EndArray();
+}
+
+void MeasureRenderQueue(bench::JsonWriter& json, const std::vector<long long>& sizes, int iterations)
+{
+    const int kPrograms = 4, kTextures = 8, kVertexArrays = 4;
+
+    ShaderProgram programs[kPrograms];
+    int rotationLocations[kPrograms];
+    for (int i = 0; i < kPrograms; ++i)
+    {
+        programs[i].Create(triangleVertexShader, triangleFragmentShader);
+        rotationLocations[i] = programs[i].GetUniformLocation("rotation");
+    }
+
+    unsigned int textures[kTextures], vertexArrays[kVertexArrays];
+    glGenTextures(kTextures, textures);
+    glGenVertexArrays(kVertexArrays, vertexArrays);
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+    for (unsigned int texture : textures)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLStateCache state;
+    RenderQueue queue;
+
+    json.BeginArray("render_queue");
+    for (long long size : sizes)
+    {
+        size_t count = (size_t)std::max(1LL, size);
+
+        std::mt19937 rng(1234);
+        struct Draw { int program, texture, vertexArray; unsigned int depth; float rotation; };
+        std::vector<Draw> draws(count);
+        for (Draw& draw : draws)
+        {
+            draw.program = (int)(rng() % kPrograms);
+            draw.texture = (int)(rng() % kTextures);
+            draw.vertexArray = (int)(rng() % kVertexArrays);
+            draw.depth = rng() & 0xFFFF;
+            draw.rotation = (float)(rng() % 360);
+        }
+
+        const char* modes[] = { "unsorted", "radix_sorted" };
+        for (const char* mode : modes)
+        {
+            bool sorted = std::strcmp(mode, "radix_sorted") == 0;
+            std::vector<double> pushMs, sortMs, submitMs, frameMs;
+            RenderQueue::SubmitStats submitted = { 0, 0 };
+            StateCacheStats stateStats = { 0, 0 };
+            for (int i = 0; i < iterations + 1; ++i)
+            {
+                glFinish();
+                bench::Clock::time_point start = bench::Clock::now();
+                queue.Clear();
+                for (const Draw& draw : draws)
+                {
+                    unsigned int program = programs[draw.program].GetId();
+                    unsigned int texture = textures[draw.texture];
+                    unsigned int vertexArray = vertexArrays[draw.vertexArray];
+                    DrawCommand& command = queue.Push(RenderQueue::MakeKey(0, program, texture, vertexArray, draw.depth));
+                    command.program = program;
+                    command.texture = texture;
+                    command.vertexArray = vertexArray;
+                    command.count = 3;
+                    command.SetUniform(rotationLocations[draw.program], draw.rotation);
+                }
+                double pushed = bench::ElapsedMs(start);
+
+                bench::Clock::time_point sortStart = bench::Clock::now();
+                if (sorted)
+                    queue.Sort();
+                double sortedMs = bench::ElapsedMs(sortStart);
+
+                state.Invalidate();
+                state.ResetStats();
+                bench::Clock::time_point submitStart = bench::Clock::now();
+                submitted = queue.Submit(state);
+                double submittedMs = bench::ElapsedMs(submitStart);
+                glFinish();
+                double totalMs = bench::ElapsedMs(start);
+                stateStats = state.GetStats();
+
+                // First pass is warmup (queue capacity, driver caches)
+                if (i == 0)
+                    continue;
+                pushMs.push_back(pushed);
+                sortMs.push_back(sortedMs);
+                submitMs.push_back(submittedMs);
+                frameMs.push_back(totalMs);
+            }
+
+            bench::Summary frame = bench::Summarize(frameMs);
+            json.BeginObject();
+            json.Value("mode", mode);
+            json.Value("items", count);
+            json.Summary("push_ms", bench::Summarize(pushMs));
+            json.Summary("sort_ms", bench::Summarize(sortMs));
+            json.Summary("submit_ms", bench::Summarize(submitMs));
+            json.Summary("frame_ms", frame);
+            json.Value("items_per_s", count / (frame.p50 / 1000.0));
+            json.Value("draw_calls", (int)submitted.drawCalls);
+            json.Value("state_changes", (int)stateStats.issued);
+            json.Value("state_changes_skipped", (int)stateStats.skipped);
+            json.EndObject();
+        }
+
+        // The same keys through std::sort, for scale
+        std::vector<std::pair<uint64_t, uint32_t>> keys(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Draw& draw = draws[i];
+            keys[i] = std::make_pair(RenderQueue::MakeKey(0, programs[draw.program].GetId(), textures[draw.texture],
+                                                          vertexArrays[draw.vertexArray], draw.depth), (uint32_t)i);
+        }
+        std::vector<double> stdSortMs;
+        for (int i = 0; i < iterations; ++i)
+        {
+            std::vector<std::pair<uint64_t, uint32_t>> copy = keys;
+            bench::Clock::time_point start = bench::Clock::now();
+            std::sort(copy.begin(), copy.end()); // Index breaks ties, so this is stable too
+            stdSortMs.push_back(bench::ElapsedMs(start));
+        }
+        json.BeginObject();
+        json.Value("mode", "std_sort");
+        json.Value("items", count);
+        json.Summary("sort_ms", bench::Summarize(stdSortMs));
+        json.EndObject();
+    }
+    json.EndArray();
+
+    state.BindVertexArray(0);
+    state.UseProgram(0);
+    glDeleteVertexArrays(kVertexArrays, vertexArrays);
+    glDeleteTextures(kTextures, textures);
+}
+
+// A toolbar of N icons: packing them into an atlas, then drawing it as one
+// batch through the Renderer vs one quad, texture bind and draw per icon
+// (same sprite shader and quads, separate textures)
+void MeasureToolbar(bench::JsonWriter& json, Renderer& renderer, int icons, int iterations)
+{
+    std::vector<std::string> paths = MakeIconSet(icons);
+
+    std::vector<double> buildMs;
+    int atlasWidth = 0, atlasHeight = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        TextureAtlas atlas;
+        DecodedImage image;
+        bench::Clock::time_point start = bench::Clock::now();
+        atlas.Build(paths, 4096, image);
+        buildMs.push_back(bench::ElapsedMs(start));
+        atlasWidth = image.width;
+        atlasHeight = image.height;
+    }
+
+    const float buttonSize = 32.0f, spacing = 4.0f;
+    const int perRow = 20;
+    renderer.SetTriangleVisible(false);
+    for (int i = (int)renderer.GetButtonCount(); i < icons; ++i)
+    {
+        renderer.AddButton(100.0f + (i % perRow) * (buttonSize + spacing), 20.0f + (i / perRow) * (buttonSize + spacing),
+                           buttonSize, buttonSize, "icon/button_icon.png");
+    }
+
+    std::vector<double> batchedMs;
+    for (int i = 0; i < iterations + 1; ++i)
+    {
+        glFinish();
+        bench::Clock::time_point start = bench::Clock::now();
+        renderer.Render();
+        glFinish();
+        if (i > 0)
+            batchedMs.push_back(bench::ElapsedMs(start));
+    }
+    unsigned int batchedDraws = renderer.GetFrameStats().drawCalls;
+
+    // Per-icon baseline
+    ShaderProgram program;
+    program.Create(spriteVertexShader, spriteFragmentShader);
+    program.BindUniformBlock("FrameData", 0);
+    glUseProgram(program.GetId());
+    glUniform1i(program.GetUniformLocation("spriteTexture"), 0);
+
+    std::vector<unsigned int> textures;
+    SpriteBatch quads;
+    const AtlasRegion whole = { 0, 0, 1, 1, 0.0f, 0.0f, 1.0f, 1.0f };
+    const float tint[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int i = 0; i < icons; ++i)
+    {
+        textures.push_back(RendererBench::LoadTexture(renderer, paths[i]));
+        quads.AddQuad(100.0f + (i % perRow) * (buttonSize + spacing), 20.0f + (i / perRow) * (buttonSize + spacing),
+                      buttonSize, buttonSize, whole, tint);
+    }
+
+    std::vector<uint32_t> quadIndices;
+    SpriteBatch::BuildQuadIndices(quads.GetQuadCount(), quadIndices);
+
+    unsigned int vao = 0, vbo = 0, ebo = 0;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, quadIndices.size() * sizeof(uint32_t), quadIndices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, quads.GetSizeBytes(), quads.GetVertices(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, position));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, texCoord));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, tint));
+    for (int attrib = 0; attrib < 3; ++attrib)
+        glEnableVertexAttribArray(attrib);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::vector<double> perIconMs;
+    glActiveTexture(GL_TEXTURE0);
+    for (int i = 0; i < iterations + 1; ++i)
+    {
+        glFinish();
+        bench::Clock::time_point start = bench::Clock::now();
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (int icon = 0; icon < icons; ++icon)
+        {
+            glBindTexture(GL_TEXTURE_2D, textures[icon]);
+            glDrawElements(GL_TRIANGLES, SpriteBatch::kIndicesPerQuad, GL_UNSIGNED_INT,
+                           (void*)(icon * SpriteBatch::kIndicesPerQuad * sizeof(uint32_t)));
+        }
+        glFinish();
+        if (i > 0)
+            perIconMs.push_back(bench::ElapsedMs(start));
+    }
+
+    glBindVertexArray(0);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    glDeleteTextures((GLsizei)textures.size(), textures.data());
+    glUseProgram(0);
+    renderer.ResetStateCache();
+
+    json.BeginObject("toolbar");
+    json.Value("icons", icons);
+    json.Value("iterations", iterations);
+    json.Summary("atlas_build_ms", bench::Summarize(buildMs));
+    json.Value("atlas_width", atlasWidth);
+    json.Value("atlas_height", atlasHeight);
+    json.Summary("batched_frame_ms", bench::Summarize(batchedMs));
+    json.Value("batched_draw_calls", (int)batchedDraws);
+    json.Summary("per_icon_frame_ms", bench::Summarize(perIconMs));
+    json.Value("per_icon_draw_calls", icons);
+    json.EndObject();
+}
+
+// Pointer queries against N widget rectangles and N scene triangles: the
+// bounding volume hierarchy vs testing every item. Triangles go through
+// Renderer::Pick, the path the UI thread uses for hover tracking.
+void MeasureHitTesting(bench::JsonWriter& json, Renderer& renderer, const std::vector<long long>& sizes,
+                       int width, int height)
+{
+    const int kQueries = 100000;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> px(0.0f, (float)width), py(0.0f, (float)height);
+    std::vector<float> points(kQueries * 2);
+    for (int i = 0; i < kQueries; ++i)
+    {
+        points[i * 2 + 0] = px(rng);
+        points[i * 2 + 1] = py(rng);
+    }
+
+    json.BeginArray("hit_testing");
+    for (long long size : sizes)
+    {
+        size_t count = (size_t)std::max(1LL, size);
+
+        // Widgets: small rectangles scattered over the viewport
+        std::vector<Bounds> rects(count);
+        std::uniform_real_distribution<float> extent(4.0f, 32.0f);
+        for (Bounds& rect : rects)
+        {
+            rect.minX = px(rng);
+            rect.minY = py(rng);
+            rect.maxX = rect.minX + extent(rng);
+            rect.maxY = rect.minY + extent(rng);
+        }
+        bench::Clock::time_point start = bench::Clock::now();
+        std::shared_ptr<SpatialIndex> widgets = std::make_shared<SpatialIndex>();
+        widgets->BuildRects(rects);
+        double widgetBuildMs = bench::ElapsedMs(start);
+
+        // Scene: triangle instances, the index is rebuilt by the next Render()
+        renderer.SetTriangleVisible(true);
+        renderer.SetTriangleInstances(MakeScene((long long)count));
+        renderer.Render();
+        glFinish();
+        start = bench::Clock::now();
+        renderer.SetTriangleInstances(MakeScene((long long)count));
+        renderer.Render();
+        glFinish();
+        double sceneFrameMs = bench::ElapsedMs(start);
+        std::shared_ptr<const SpatialIndex> triangles = RendererBench::TriangleIndex(renderer);
+
+        const char* kinds[] = { "widgets", "triangles" };
+        for (const char* kind : kinds)
+        {
+            bool scene = std::strcmp(kind, "triangles") == 0;
+            const SpatialIndex& index = scene ? *triangles : *widgets;
+
+            size_t hits = 0, mismatches = 0;
+            start = bench::Clock::now();
+            for (int i = 0; i < kQueries; ++i)
+            {
+                size_t item = 0;
+                bool hit;
+                if (scene)
+                {
+                    PickResult pick = renderer.Pick(points[i * 2], points[i * 2 + 1]);
+                    hit = pick.kind != PickResult::None;
+                }
+                else
+                {
+                    hit = index.Pick(points[i * 2], points[i * 2 + 1], item);
+                }
+                hits += hit ? 1 : 0;
+            }
+            double indexedMs = bench::ElapsedMs(start);
+
+            // Linear scans are slow at the top sizes, a slice of the queries is enough
+            int linearQueries = std::max(100, (int)std::min<size_t>(kQueries, 100000000 / count));
+            std::vector<long long> linearItems(linearQueries);
+            start = bench::Clock::now();
+            for (int i = 0; i < linearQueries; ++i)
+            {
+                size_t item = 0;
+                linearItems[i] = index.PickLinear(points[i * 2], points[i * 2 + 1], item) ? (long long)item : -1;
+            }
+            double linearMs = bench::ElapsedMs(start);
+
+            for (int i = 0; i < linearQueries; ++i)
+            {
+                size_t item = 0;
+                long long indexed = index.Pick(points[i * 2], points[i * 2 + 1], item) ? (long long)item : -1;
+                if (indexed != linearItems[i])
+                    ++mismatches;
+            }
+
+            json.BeginObject();
+            json.Value("kind", kind);
+            json.Value("items", count);
+            json.Value("nodes", index.GetNodeCount());
+            if (scene)
+                json.Value("rebuild_frame_ms", sceneFrameMs);
+            else
+                json.Value("build_ms", widgetBuildMs);
+            json.Value("queries", kQueries);
+            json.Value("hit_ratio", (double)hits / kQueries);
+            json.Value("queries_per_s", kQueries / (indexedMs / 1000.0));
+            json.Value("linear_queries_per_s", linearQueries / (linearMs / 1000.0));
+            json.Value("mismatches", mismatches);
+            json.EndObject();
+        }
+    }
+    json.EndArray();
+    renderer.SetTriangleInstances(std::vector<TriangleInstance>());
+}
+
+void MeasureGpuPicking(bench::JsonWriter& json, Renderer& renderer, const std::vector<long long>& sizes,
+                       int width, int height, int iterations)
+{
+    const int kSamples = 200;
+    const int kQueries = 100000;
+    std::mt19937 rng(4321);
+    std::uniform_int_distribution<int> px(0, width - 1), py(0, height - 1);
+    std::vector<int> points(kSamples * 2);
+    for (int i = 0; i < kSamples; ++i)
+    {
+        points[i * 2 + 0] = px(rng);
+        points[i * 2 + 1] = py(rng);
+    }
+
+    json.BeginArray("gpu_picking");
+    for (long long size : sizes)
+    {
+        size_t count = (size_t)std::max(1LL, size);
+
+        // Reference answers from the CPU index, built by the first frame
+        renderer.SetGpuPicking(false);
+        renderer.SetTriangleVisible(true);
+        renderer.SetTriangleInstances(MakeScene((long long)count));
+        renderer.Render();
+        glFinish();
+        std::shared_ptr<const SpatialIndex> triangles = RendererBench::TriangleIndex(renderer);
+
+        // Frame cost without the id pass: the pick point does not move
+        renderer.SetGpuPicking(true);
+        renderer.Render();
+        glFinish();
+        std::vector<double> plainMs;
+        for (int i = 0; i < iterations; ++i)
+        {
+            bench::Clock::time_point start = bench::Clock::now();
+            renderer.Render();
+            glFinish();
+            plainMs.push_back(bench::ElapsedMs(start));
+        }
+
+        // Move the pick point every frame; the readback is collected once the GPU is done
+        std::vector<double> pickMs;
+        size_t hits = 0, agreements = 0;
+        for (int i = 0; i < kSamples; ++i)
+        {
+            int x = points[i * 2], y = points[i * 2 + 1];
+            bench::Clock::time_point start = bench::Clock::now();
+            renderer.SetPickPoint(x, y);
+            renderer.Render();
+            glFinish();
+            pickMs.push_back(bench::ElapsedMs(start));
+            renderer.CollectPicks();
+
+            PickResult pick = renderer.Pick((float)x, (float)y);
+            long long gpu = pick.kind == PickResult::Triangle ? (long long)pick.index : -1;
+            size_t item = 0;
+            long long cpu = triangles && triangles->Pick(x + 0.5f, y + 0.5f, item) ? (long long)item : -1;
+            hits += gpu >= 0 ? 1 : 0;
+            agreements += gpu == cpu ? 1 : 0;
+        }
+
+        // Pick() itself only reads the stored answer
+        size_t found = 0;
+        bench::Clock::time_point start = bench::Clock::now();
+        for (int i = 0; i < kQueries; ++i)
+        {
+            PickResult pick = renderer.Pick((float)points[(i % kSamples) * 2], (float)points[(i % kSamples) * 2 + 1]);
+            found += pick.kind != PickResult::None ? 1 : 0;
+        }
+        double queryMs = bench::ElapsedMs(start);
+
+        json.BeginObject();
+        json.Value("items", count);
+        json.Value("samples", kSamples);
+        json.Value("hit_ratio", (double)hits / kSamples);
+        json.Value("agreement_with_index", (double)agreements / kSamples);
+        json.Summary("frame_ms", bench::Summarize(plainMs));
+        json.Summary("pick_frame_ms", bench::Summarize(pickMs));
+        json.Value("queries_per_s", kQueries / (queryMs / 1000.0));
+        json.Value("found", found);
+        json.EndObject();
+    }
+    json.EndArray();
+    renderer.SetGpuPicking(false);
+    renderer.SetTriangleInstances(std::vector<TriangleInstance>());
+}
+
+void MeasureInputLatency(bench::JsonWriter& json, Renderer& renderer, const std::vector<long long>& sizes,
+                         int iterations)
+{
+    json.BeginArray("input_latency");
+    for (long long size : sizes)
+    {
+        renderer.SetTriangleVisible(true);
+        renderer.SetTriangleInstances(size > 1 ? MakeScene(size) : std::vector<TriangleInstance>());
+        renderer.Render();
+        glFinish();
+
+        // Same steps as the render thread: apply the input, draw, present, then
+        // poll the fence every millisecond while idle
+        LatencyMonitor monitor;
+        std::vector<uint64_t> inputs(1);
+        for (int i = 0; i < iterations; ++i)
+        {
+            inputs[0] = LatencyMonitor::Now();
+            renderer.SetRotation((float)(i % 360));
+            renderer.Render();
+            glFlush(); // No swap without a window
+            monitor.FramePresented(inputs);
+            while (monitor.HasPending())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                monitor.Collect();
+            }
+        }
+
+        LatencyStats stats = monitor.GetStats();
+        std::vector<size_t> histogram = monitor.GetHistogram();
+        json.BeginObject();
+        json.Value("triangles", size);
+        json.Value("samples", stats.samples);
+        json.Value("p50_ms", stats.p50Ms);
+        json.Value("p95_ms", stats.p95Ms);
+        json.Value("p99_ms", stats.p99Ms);
+        json.Value("max_ms", stats.maxMs);
+        json.Value("swap_p50_ms", stats.swapP50Ms);
+        json.BeginArray("histogram");
+        for (int bucket = 0; bucket < LatencyMonitor::kBucketCount; ++bucket)
+        {
+            if (histogram[bucket] == 0)
+                continue;
+            json.BeginObject();
+            if (bucket < LatencyMonitor::kBucketCount - 1)
+                json.Value("le_ms", LatencyMonitor::GetBucketLimitMs(bucket));
+            else
+                json.Value("gt_ms", LatencyMonitor::GetBucketLimitMs(bucket - 1));
+            json.Value("count", histogram[bucket]);
+            json.EndObject();
+        }
+        json.EndArray();
+        json.EndObject();
+    }
+    json.EndArray();
+    renderer.SetRotation(0.0f);
+    renderer.SetTriangleInstances(std::vector<TriangleInstance>());
+}
+
+void MeasureTracing(bench::JsonWriter& json, int iterations)
+{
+    const int kSpans = 100000;
+
+    // Registers this thread and allocates its first chunk
+    {
+        TraceScope scope("bench::warmup");
+    }
+
+    std::vector<double> spanNs, clockNs;
+    for (int i = 0; i < iterations; ++i)
+    {
+        bench::Clock::time_point start = bench::Clock::now();
+        for (int span = 0; span < kSpans; ++span)
+        {
+            TraceScope scope("bench::span");
+        }
+        spanNs.push_back(bench::ElapsedMs(start) * 1e6 / kSpans);
+
+        // The two clock reads alone, for comparison
+        start = bench::Clock::now();
+        for (int span = 0; span < kSpans; ++span)
+        {
+            Trace::Now();
+            Trace::Now();
+        }
+        clockNs.push_back(bench::ElapsedMs(start) * 1e6 / kSpans);
+    }
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "renderer_bench_trace.json";
+    bench::Clock::time_point start = bench::Clock::now();
+    bool written = Trace::WriteJson(path.string());
+    double writeMs = bench::ElapsedMs(start);
+    std::error_code error;
+    uintmax_t fileBytes = written ? std::filesystem::file_size(path, error) : 0;
+    std::filesystem::remove(path, error);
+
+#ifdef ENABLE_TRACING
+    bool instrumented = true;
+#else
+    bool instrumented = false;
+#endif
+
+    json.BeginObject("tracing");
+    json.Value("instrumented_build", instrumented);
+    json.Value("spans_per_iteration", kSpans);
+    json.Summary("span_ns", bench::Summarize(spanNs));
+    json.Summary("clock_pair_ns", bench::Summarize(clockNs));
+    json.Value("events", Trace::GetEventCount());
+    json.Value("dropped", Trace::GetDroppedCount());
+    json.Value("write_ms", writeMs);
+    json.Value("file_bytes", (size_t)fileBytes);
+    json.EndObject();
+}
+
+// Sustained capture: frames per second rendering a moving scene while every
+// frame is read back and written out, against no readback at all and against
+// a blocking glReadPixels into client memory (without encoding)
+void MeasureCapture(bench::JsonWriter& json, int width, int height, int frames)
+{
+    namespace fs = std::filesystem;
+    fs::path directory = fs::temp_directory_path() / "renderer_bench_capture";
+    std::error_code error;
+    fs::remove_all(directory, error);
+    fs::create_directories(directory, error);
+
+    OffscreenTarget target;
+    if (!target.Create(width, height))
+        return;
+    target.Bind();
+    Renderer renderer;
+    if (!renderer.Initialize())
+        return;
+    renderer.GetTextureLoader().Flush();
+    renderer.SetViewport(width, height);
+    renderer.SetTriangleVisible(true);
+    renderer.SetTriangleInstances(MakeScene(1000));
+
+    json.BeginObject("capture");
+    json.Value("width", width);
+    json.Value("height", height);
+
+    struct Mode { const char* name; const char* file; bool drop; int frames; };
+    const Mode modes[] = {
+        { "none", nullptr, false, frames },
+        { "sync_readpixels", nullptr, false, frames },
+        { "pbo_y4m", "capture.y4m", false, frames },
+        { "pbo_y4m_drop", "capture_drop.y4m", true, frames },
+        { "pbo_png", "capture.png", false, std::max(1, frames / 8) },
+    };
+    std::vector<unsigned char> pixels;
+    for (const Mode& mode : modes)
+    {
+        bool sync = std::strcmp(mode.name, "sync_readpixels") == 0;
+        if (mode.file && !renderer.StartCapture((directory / mode.file).string(), 60, mode.drop))
+            continue;
+
+        std::vector<double> frameMs;
+        bench::Clock::time_point start = bench::Clock::now();
+        for (int i = 0; i < mode.frames; ++i)
+        {
+            bench::Clock::time_point frameStart = bench::Clock::now();
+            renderer.SetRotation((float)(i % 360));
+            renderer.Render();
+            if (sync)
+                target.ReadPixels(pixels);
+            glFlush();
+            frameMs.push_back(bench::ElapsedMs(frameStart));
+        }
+        renderer.StopCapture(); // Counts the tail of the encode queue in the total
+        glFinish();
+        double totalMs = bench::ElapsedMs(start);
+        CaptureStats stats = renderer.GetCaptureStats();
+
+        json.BeginObject(mode.name);
+        json.Value("frames", mode.frames);
+        json.Value("fps", mode.frames * 1000.0 / totalMs);
+        json.Summary("frame_ms", bench::Summarize(frameMs));
+        if (mode.file)
+        {
+            json.Value("written", stats.written);
+            json.Value("dropped", stats.dropped);
+            json.Value("readback_waits", stats.readbackWaits);
+            json.Value("encode_ms", stats.encodeMs);
+        }
+        json.EndObject();
+    }
+    json.EndObject();
+
+    fs::remove_all(directory, error);
+}
+
+// The CPU rasterizer against the GL path (llvmpipe here) on the same scenes,
+// per worker count, plus how many pixels the two pictures disagree on
+void MeasureSoftwareRaster(bench::JsonWriter& json, const Options& options)
+{
+    const int width = options.width, height = options.height;
+    OffscreenTarget target;
+    if (!target.Create(width, height))
+        return;
+    target.Bind();
+    Renderer renderer;
+    if (!renderer.Initialize())
+        return;
+    renderer.GetTextureLoader().Flush();
+    renderer.SetViewport(width, height);
+    renderer.SetTriangleVisible(true);
+
+    std::vector<long long> threadCounts = options.rasterThreads;
+    std::sort(threadCounts.begin(), threadCounts.end());
+    threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+    std::vector<std::unique_ptr<SoftwareRenderer>> rasterizers;
+    for (long long threads : threadCounts)
+    {
+        rasterizers.emplace_back(new SoftwareRenderer((int)std::max(1LL, threads)));
+        rasterizers.back()->LoadIconAtlas();
+        rasterizers.back()->SetViewport(width, height);
+        rasterizers.back()->SetTriangleVisible(true);
+    }
+
+    json.BeginObject("software_raster");
+    json.Value("width", width);
+    json.Value("height", height);
+    json.Value("hardware_threads", (long long)std::thread::hardware_concurrency());
+    const char* llvmpipeThreads = std::getenv("LP_NUM_THREADS");
+    json.Value("lp_num_threads", llvmpipeThreads ? llvmpipeThreads : "default");
+    json.Value("simd", PixelConvert::GetLevelName(PixelConvert::GetLevel()));
+
+    std::vector<unsigned char> glPixels;
+    json.BeginArray("scenes");
+    for (long long size : options.sizes)
+    {
+        std::vector<TriangleInstance> scene = MakeScene(size);
+        int iterations = IterationsFor(options, size);
+        renderer.SetTriangleInstances(scene);
+
+        std::vector<double> glMs;
+        for (int i = 0; i < options.warmup + iterations; ++i)
+        {
+            bench::Clock::time_point start = bench::Clock::now();
+            renderer.Render();
+            glFinish();
+            if (i >= options.warmup)
+                glMs.push_back(bench::ElapsedMs(start));
+        }
+        target.ReadPixels(glPixels);
+
+        json.BeginObject();
+        json.Value("triangles", size);
+        json.Value("iterations", iterations);
+        json.Summary("gl_ms", bench::Summarize(glMs));
+        json.BeginArray("software");
+        PixelDiff diff = { 0, 0, 0 };
+        for (std::unique_ptr<SoftwareRenderer>& rasterizer : rasterizers)
+        {
+            rasterizer->SetTriangleInstances(scene);
+            std::vector<double> frameMs, binMs, shadeMs;
+            for (int i = 0; i < options.warmup + iterations; ++i)
+            {
+                bench::Clock::time_point start = bench::Clock::now();
+                rasterizer->Render();
+                if (i < options.warmup)
+                    continue;
+                frameMs.push_back(bench::ElapsedMs(start));
+                binMs.push_back(rasterizer->GetFrameStats().binMs);
+                shadeMs.push_back(rasterizer->GetFrameStats().shadeMs);
+            }
+            diff = SoftwareRenderer::Compare(glPixels, rasterizer->GetPixels(), 1);
+
+            json.BeginObject();
+            json.Value("threads", rasterizer->GetThreadCount());
+            json.Summary("frame_ms", bench::Summarize(frameMs));
+            json.Summary("bin_ms", bench::Summarize(binMs));
+            json.Summary("shade_ms", bench::Summarize(shadeMs));
+            json.Value("bin_entries", rasterizer->GetFrameStats().binEntries);
+            json.Value("jobs_stolen", rasterizer->GetFrameStats().jobsStolen);
+            json.EndObject();
+        }
+        json.EndArray();
+
+        // The same picture at every thread count, so the last one stands for all
+        json.BeginObject("diff");
+        json.Value("differing_pixels", diff.differing);
+        json.Value("fraction", (double)diff.differing / std::max<size_t>(1, diff.pixels));
+        json.Value("max_channel_diff", diff.maxDiff);
+        json.EndObject();
+        json.EndObject();
+    }
+    json.EndArray();
+
+    // Row kernels alone: the single big triangle on one thread
+    SoftwareRenderer& single = *rasterizers.front();
+    single.SetTriangleInstances(std::vector<TriangleInstance>());
+    const PixelConvert::SimdLevel supported = PixelConvert::GetSupportedLevel();
+    json.BeginArray("kernels");
+    for (PixelConvert::SimdLevel level : { PixelConvert::SimdLevel::Scalar, PixelConvert::SimdLevel::SSE2, PixelConvert::SimdLevel::AVX2 })
+    {
+        if ((int)level > (int)supported)
+            break;
+        PixelConvert::SetLevel(level);
+        std::vector<double> shadeMs;
+        for (int i = 0; i < options.warmup + options.iterations; ++i)
+        {
+            single.Render();
+            if (i >= options.warmup)
+                shadeMs.push_back(single.GetFrameStats().shadeMs);
+        }
+        json.BeginObject();
+        json.Value("level", PixelConvert::GetLevelName(level));
+        json.Value("threads", single.GetThreadCount());
+        json.Summary("shade_ms", bench::Summarize(shadeMs));
+        json.EndObject();
+    }
+    PixelConvert::SetLevel(supported);
+    json.EndArray();
+    json.EndObject();
+}
+
+bool ParseArgs(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--sizes") == 0 && hasValue) options.sizes = bench::ParseSizeList(argv[++i]);
+        else if (std::strcmp(argv[i], "--iterations") == 0 && hasValue) options.iterations = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) options.warmup = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--width") == 0 && hasValue) options.width = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--height") == 0 && hasValue) options.height = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--max-per-object") == 0 && hasValue) options.maxPerObject = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--icons") == 0 && hasValue) options.icons = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--stream-mb") == 0 && hasValue) options.streamMegabytes = bench::ParseSizeList(argv[++i]);
+        else if (std::strcmp(argv[i], "--queue-sizes") == 0 && hasValue) options.queueSizes = bench::ParseSizeList(argv[++i]);
+        else if (std::strcmp(argv[i], "--toolbar") == 0 && hasValue) options.toolbar = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--pick-sizes") == 0 && hasValue) options.pickSizes = bench::ParseSizeList(argv[++i]);
+        else if (std::strcmp(argv[i], "--latency-sizes") == 0 && hasValue) options.latencySizes = bench::ParseSizeList(argv[++i]);
+        else if (std::strcmp(argv[i], "--capture-size") == 0 && hasValue)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &options.captureWidth, &options.captureHeight) != 2)
+            {
+                std::fprintf(stderr, "--capture-size wants WxH, e.g. 1920x1080\n");
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--capture-frames") == 0 && hasValue) options.captureFrames = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--raster-threads") == 0 && hasValue) options.rasterThreads = bench::ParseSizeList(argv[++i]);
+        else if (std::strcmp(argv[i], "--mesh") == 0 && hasValue) options.mesh = argv[++i];
+        else if (std::strcmp(argv[i], "--label") == 0 && hasValue) options.label = argv[++i];
+        else if (std::strcmp(argv[i], "--output") == 0 && hasValue) options.output = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseArgs(argc, argv, options))
+        return 2;
+
+    wxInitializer initializer;
+    HeadlessContext context;
+    if (!context.Create())
+        return 1;
+
+    OffscreenTarget target;
+    if (!target.Create(options.width, options.height))
+        return 1;
+    target.Bind();
+
+    Renderer renderer;
+    if (!renderer.Initialize())
+        return 1;
+    renderer.GetTextureLoader().Flush();
+    renderer.SetViewport(options.width, options.height);
+    renderer.SetTriangleVisible(true);
+
+    FILE* out = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "w");
+    if (!out)
+    {
+        std::fprintf(stderr, "Cannot open %s\n", options.output.c_str());
+        return 1;
+    }
+
+    bench::JsonWriter json(out);
+    json.BeginObject();
+    json.Value("benchmark", "renderer_bench");
+    json.Value("label", options.label);
+    json.BeginObject("gl");
+    json.Value("vendor", (const char*)glGetString(GL_VENDOR));
+    json.Value("renderer", (const char*)glGetString(GL_RENDERER));
+    json.Value("version", (const char*)glGetString(GL_VERSION));
+    json.EndObject();
+    json.Value("width", options.width);
+    json.Value("height", options.height);
+
+    json.BeginArray("frames");
+
+    // Original single-triangle path
+    MeasureFrames(json, renderer, "render_single", 1, options.warmup, options.iterations);
+
+    for (long long size : options.sizes)
+    {
+        renderer.SetTriangleInstances(MakeScene(size));
+        int iterations = IterationsFor(options, size);
+
+        renderer.SetInstancedRendering(true);
+        MeasureFrames(json, renderer, "render_instanced", size, options.warmup, iterations);
+
+        if (size <= options.maxPerObject)
+        {
+            renderer.SetInstancedRendering(false);
+            MeasureFrames(json, renderer, "render_per_object", size, options.warmup, iterations);
+        }
+    }
+    renderer.SetTriangleInstances(std::vector<TriangleInstance>());
+
+    // Same file both ways; the optimizer only reorders parsed meshes
+    if (!options.mesh.empty())
+    {
+        for (bool optimize : { true, false })
+        {
+            renderer.SetMeshOptimization(optimize);
+            if (!renderer.LoadMesh(options.mesh))
+                return 1;
+            long long triangles = (long long)renderer.GetMeshStats().triangles;
+            MeasureFrames(json, renderer, optimize ? "render_mesh" : "render_mesh_unoptimized", triangles,
+                          options.warmup, IterationsFor(options, triangles));
+            renderer.ClearMesh();
+        }
+        renderer.SetMeshOptimization(true);
+    }
+    json.EndArray();
+
+    json.BeginArray("calls");
+    renderer.SetUseCustomColor(true);
+    MeasureCalls(json, "update_triangle_geometry", options.warmup, options.iterations * 20, [&]() {
+        renderer.UpdateTriangleGeometry();
+    });
+    MeasureCalls(json, "load_texture", 1, options.iterations, [&]() {
+        unsigned int texture = RendererBench::LoadTexture(renderer, "icon/button_icon.png");
+        glDeleteTextures(1, &texture);
+    });
+    MeasureCalls(json, "create_shader_program", 1, options.iterations, [&]() {
+        ShaderProgram program;
+        program.Create(triangleVertexShader, triangleFragmentShader);
+    });
+    json.EndArray();
+
+    MeasureTextureLoading(json, renderer, options.icons, std::max(1, options.iterations / 10));
+    MeasureStartup(json, options.width, options.height, std::max(3, options.iterations / 5));
+    MeasureStreaming(json, options.streamMegabytes, std::max(5, options.iterations / 2));
+    MeasureStreamRegrow(json, target, options.width, options.height);
+    MeasureRenderQueue(json, options.queueSizes, std::max(3, options.iterations / 10));
+    MeasureHitTesting(json, renderer, options.pickSizes, options.width, options.height);
+    MeasureGpuPicking(json, renderer, options.pickSizes, options.width, options.height, options.iterations);
+    MeasureToolbar(json, renderer, options.toolbar, options.iterations);
+    MeasureInputLatency(json, renderer, options.latencySizes, options.iterations);
+    MeasureTracing(json, std::max(3, options.iterations / 5));
+    MeasureCapture(json, options.captureWidth, options.captureHeight, options.captureFrames);
+    MeasureSoftwareRaster(json, options);
+    target.Bind();
+
+    json.EndObject();
+
+    if (out != stdout)
+        std::fclose(out);
+
+    return 0;
+}
@@ -0,0 +1,346 @@
+#include <GL/glew.h>
+#include "FrameCapture.h"
+#include "PixelConvert.h"
+#include "TextureLoader.h"
+#include "Trace.h"
+#include <wx/image.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+bool EndsWith(const std::string& text, const char* suffix)
+{
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+}
+
+FrameCapture::FrameCapture()
+    : m_nextReadback(0)
+    , m_active(false)
+    , m_dropWhenBehind(true)
+    , m_frameIndex(0)
+    , m_y4m(false)
+    , m_fps(60)
+    , m_video(nullptr)
+    , m_videoWidth(0), m_videoHeight(0)
+    , m_stopping(false)
+    , m_stats{ 0, 0, 0, 0, 0.0 }
+    , m_encodeTotalMs(0.0)
+{
+    for (Readback& readback : m_readbacks)
+        readback = Readback{ 0, 0, nullptr, 0, 0 };
+}
+
+FrameCapture::~FrameCapture()
+{
+    Stop();
+}
+
+bool FrameCapture::Start(const std::string& path, int fps, bool dropWhenBehind)
+{
+    Stop();
+
+    m_path = path;
+    m_y4m = EndsWith(path, ".y4m");
+    m_fps = std::max(1, fps);
+    m_dropWhenBehind = dropWhenBehind;
+    m_frameIndex = 0;
+    m_videoWidth = 0;
+    m_videoHeight = 0;
+    if (m_y4m)
+    {
+        m_video = std::fopen(path.c_str(), "wb");
+        if (!m_video)
+        {
+            wxLogError("Cannot open %s for capture", path);
+            return false;
+        }
+    }
+    else
+    {
+        TextureLoader::InitImageHandlers();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats = CaptureStats{ 0, 0, 0, 0, 0.0 };
+        m_encodeTotalMs = 0.0;
+        m_stopping = false;
+    }
+    m_encoder = std::thread(&FrameCapture::EncoderLoop, this);
+    m_active = true;
+    return true;
+}
+
+void FrameCapture::Capture(int width, int height)
+{
+    if (!m_active || width <= 0 || height <= 0)
+        return;
+    TRACE_SCOPE("FrameCapture::Capture");
+
+    // The GPU is kReadbackDepth frames behind: wait for the oldest readback
+    // rather than drop it, the ring is what keeps this from happening every frame
+    Readback& readback = m_readbacks[m_nextReadback];
+    if (readback.fence)
+    {
+        glClientWaitSync((GLsync)readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, ~0ull);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.readbackWaits;
+        }
+        Resolve(readback);
+    }
+    m_nextReadback = (m_nextReadback + 1) % kReadbackDepth;
+
+    size_t size = (size_t)width * height * 4;
+    if (!readback.buffer)
+        glGenBuffers(1, &readback.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    if (readback.size != size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_READ);
+        readback.size = size;
+    }
+    // RGBA rows are always 4-byte aligned, GL_PACK_ALIGNMENT does not matter
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.width = width;
+    readback.height = height;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.captured;
+}
+
+void FrameCapture::Collect()
+{
+    // Oldest first and in order: a frame still in flight holds back the newer ones
+    for (int i = 0; i < kReadbackDepth; ++i)
+    {
+        Readback& readback = m_readbacks[(m_nextReadback + i) % kReadbackDepth];
+        if (!readback.fence)
+            continue;
+
+        GLenum status = glClientWaitSync((GLsync)readback.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        Resolve(readback);
+    }
+}
+
+void FrameCapture::Resolve(Readback& readback)
+{
+    glDeleteSync((GLsync)readback.fence);
+    readback.fence = nullptr;
+
+    Frame frame;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_queue.size() >= kMaxQueuedFrames)
+        {
+            if (m_dropWhenBehind)
+            {
+                ++m_stats.dropped;
+                ++m_frameIndex;
+                return;
+            }
+            m_frameDone.wait(lock, [this]() { return m_queue.size() < kMaxQueuedFrames; });
+        }
+        if (!m_freeFrames.empty())
+        {
+            frame = std::move(m_freeFrames.back());
+            m_freeFrames.pop_back();
+        }
+    }
+
+    TRACE_SCOPE("FrameCapture::Map");
+    frame.width = readback.width;
+    frame.height = readback.height;
+    frame.index = m_frameIndex++;
+    frame.rgba.resize(readback.size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)readback.size, GL_MAP_READ_BIT);
+    if (pixels)
+    {
+        std::memcpy(frame.rgba.data(), pixels, readback.size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!pixels)
+    {
+        ++m_stats.dropped;
+        m_freeFrames.push_back(std::move(frame));
+        return;
+    }
+    m_queue.push_back(std::move(frame));
+    m_frameReady.notify_one();
+}
+
+bool FrameCapture::HasPending() const
+{
+    for (const Readback& readback : m_readbacks)
+    {
+        if (readback.fence)
+            return true;
+    }
+    return false;
+}
+
+void FrameCapture::Stop()
+{
+    if (!m_active)
+        return;
+
+    // Every readback in flight still belongs in the output
+    for (int i = 0; i < kReadbackDepth; ++i)
+    {
+        Readback& readback = m_readbacks[(m_nextReadback + i) % kReadbackDepth];
+        if (!readback.fence)
+            continue;
+        glClientWaitSync((GLsync)readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, ~0ull);
+        Resolve(readback);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_frameReady.notify_one();
+    m_encoder.join();
+
+    if (m_video)
+    {
+        std::fclose(m_video);
+        m_video = nullptr;
+    }
+    ReleaseBuffers();
+    m_active = false;
+}
+
+void FrameCapture::ReleaseBuffers()
+{
+    for (Readback& readback : m_readbacks)
+    {
+        if (readback.fence) glDeleteSync((GLsync)readback.fence);
+        if (readback.buffer) glDeleteBuffers(1, &readback.buffer);
+        readback = Readback{ 0, 0, nullptr, 0, 0 };
+    }
+    m_nextReadback = 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeFrames.clear();
+    m_planes.clear();
+    m_planes.shrink_to_fit();
+}
+
+CaptureStats FrameCapture::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CaptureStats stats = m_stats;
+    stats.encodeMs = stats.written ? m_encodeTotalMs / stats.written : 0.0;
+    return stats;
+}
+
+void FrameCapture::EncoderLoop()
+{
+    TRACE_THREAD_NAME("FrameCapture");
+    while (true)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_frameReady.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            // Stop() has resolved everything it is going to, drain the queue first
+            if (m_queue.empty())
+                return;
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        TRACE_SCOPE("FrameCapture::Encode");
+        auto start = std::chrono::steady_clock::now();
+        bool ok = m_y4m ? WriteY4m(frame) : WritePng(frame);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ok)
+        {
+            ++m_stats.written;
+            m_encodeTotalMs += ms;
+        }
+        else
+        {
+            ++m_stats.dropped;
+        }
+        m_freeFrames.push_back(std::move(frame));
+        m_frameDone.notify_one();
+    }
+}
+
+bool FrameCapture::WriteY4m(const Frame& frame)
+{
+    // A Y4M stream has one size; the first frame sets it
+    if (m_videoWidth == 0)
+    {
+        m_videoWidth = frame.width;
+        m_videoHeight = frame.height;
+        std::fprintf(m_video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n",
+                     m_videoWidth, m_videoHeight, m_fps);
+    }
+    if (frame.width != m_videoWidth || frame.height != m_videoHeight)
+        return false;
+
+    const int width = frame.width, height = frame.height;
+    const int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    const size_t lumaSize = (size_t)width * height;
+    const size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+    m_planes.resize(lumaSize + chromaSize * 2);
+    unsigned char* lumaPlane = m_planes.data();
+    unsigned char* uPlane = lumaPlane + lumaSize;
+    unsigned char* vPlane = uPlane + chromaSize;
+
+    // Two output rows at a time, flipping GL's bottom-up order
+    const size_t stride = (size_t)width * 4;
+    for (int y = 0; y < height; y += 2)
+    {
+        const unsigned char* row0 = frame.rgba.data() + (size_t)(height - 1 - y) * stride;
+        const unsigned char* row1 = y + 1 < height ? row0 - stride : row0;
+        unsigned char* luma0 = lumaPlane + (size_t)y * width;
+        unsigned char* luma1 = y + 1 < height ? luma0 + width : luma0;
+        PixelConvert::RgbaToYuv420(row0, row1, luma0, luma1,
+                                   uPlane + (size_t)(y / 2) * chromaWidth, vPlane + (size_t)(y / 2) * chromaWidth, width);
+    }
+
+    std::fputs("FRAME\n", m_video);
+    return std::fwrite(m_planes.data(), 1, m_planes.size(), m_video) == m_planes.size();
+}
+
+bool FrameCapture::WritePng(const Frame& frame)
+{
+    wxImage image(frame.width, frame.height, false);
+    unsigned char* rgb = image.GetData();
+    const size_t stride = (size_t)frame.width * 4;
+    for (int y = 0; y < frame.height; ++y)
+    {
+        const unsigned char* src = frame.rgba.data() + (size_t)(frame.height - 1 - y) * stride;
+        unsigned char* dst = rgb + (size_t)y * frame.width * 3;
+        for (int x = 0; x < frame.width; ++x)
+        {
+            dst[x * 3 + 0] = src[x * 4 + 0];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+
+    // out.png -> out_000042.png
+    std::string base = EndsWith(m_path, ".png") ? m_path.substr(0, m_path.size() - 4) : m_path;
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_%06zu.png", frame.index);
+    return image.SaveFile(base + suffix, wxBITMAP_TYPE_PNG);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CaptureStats
+{
+    size_t captured;      // Frames read back
+    size_t written;       // Encoded and on disk
+    size_t dropped;       // Encoder behind, or a size change in the middle of a video
+    size_t readbackWaits; // Capture() found its pixel buffer still in flight
+    double encodeMs;      // Average per written frame, conversion + file write
+};
+
+// Frame capture without stalling the pipeline. glReadPixels goes into a ring
+// of pixel buffers, so it returns at once; a fence goes in behind it and the
+// pixels are mapped once it has passed, normally two frames later. Encoding
+// and file writes run on a background thread. A .y4m path gives one raw
+// 4:2:0 video (full range BT.601), any other a numbered PNG sequence:
+// out.png -> out_000000.png, out_000001.png, ...
+class FrameCapture
+{
+public:
+    static const int kReadbackDepth = 3;
+    static const size_t kMaxQueuedFrames = 8;
+
+    FrameCapture();
+    ~FrameCapture();
+
+    // GL thread. dropWhenBehind = false makes Collect() wait for the encoder
+    // instead of dropping frames, for offline renders where every frame counts.
+    bool Start(const std::string& path, int fps, bool dropWhenBehind);
+    void Capture(int width, int height); // Reads the bound read framebuffer, call after the frame is drawn
+    void Collect();                      // Hands finished readbacks to the encoder
+    bool HasPending() const;
+    void Stop(); // Waits until every frame in flight is written
+
+    bool IsActive() const { return m_active; }
+    CaptureStats GetStats() const; // Any thread
+
+private:
+    struct Readback
+    {
+        unsigned int buffer;
+        size_t size;
+        void* fence; // GLsync, null when idle
+        int width, height;
+    };
+
+    struct Frame
+    {
+        int width, height;
+        size_t index;
+        std::vector<unsigned char> rgba; // Bottom row first, as GL reads it
+    };
+
+    void Resolve(Readback& readback);
+    void EncoderLoop();
+    bool WriteY4m(const Frame& frame);
+    bool WritePng(const Frame& frame);
+    void ReleaseBuffers();
+
+    Readback m_readbacks[kReadbackDepth];
+    int m_nextReadback;
+    bool m_active;
+    bool m_dropWhenBehind;
+    size_t m_frameIndex;
+
+    // Encoder side
+    std::string m_path;
+    bool m_y4m;
+    int m_fps;
+    std::FILE* m_video;
+    int m_videoWidth, m_videoHeight;
+    std::vector<unsigned char> m_planes; // Y, U, V of the frame being written
+    std::thread m_encoder;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_frameReady, m_frameDone;
+    std::deque<Frame> m_queue;
+    std::vector<Frame> m_freeFrames; // Recycled pixel storage
+    bool m_stopping;
+    CaptureStats m_stats;
+    double m_encodeTotalMs;
+};
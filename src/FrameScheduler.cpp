@@ -0,0 +1,69 @@
+#include "FrameScheduler.h"
+#include <algorithm>
+
+FrameScheduler::FrameScheduler(std::function<void()> redraw)
+    : m_redraw(redraw)
+    , m_lastFrame()
+    , m_targetFps(60)
+    , m_pending(false)
+    , m_framesStarted(0)
+    , m_requestsCoalesced(0)
+{
+}
+
+void FrameScheduler::SetTargetFrameRate(int fps)
+{
+    m_targetFps = std::max(0, fps);
+}
+
+int FrameScheduler::GetTargetFrameRate() const
+{
+    return m_targetFps;
+}
+
+void FrameScheduler::RequestFrame()
+{
+    // A frame is already on its way and will pick up this change too
+    if (m_pending)
+    {
+        ++m_requestsCoalesced;
+        return;
+    }
+    m_pending = true;
+
+    int delayMs = 0;
+    if (m_targetFps > 0)
+    {
+        auto interval = std::chrono::microseconds(1000000 / m_targetFps);
+        auto elapsed = std::chrono::steady_clock::now() - m_lastFrame;
+        delayMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(interval - elapsed).count();
+    }
+
+    // At least one tick, so events already queued in this burst get coalesced
+    StartOnce(std::max(1, delayMs));
+}
+
+void FrameScheduler::OnFrameStarted()
+{
+    Stop();
+    m_pending = false;
+    m_lastFrame = std::chrono::steady_clock::now();
+    ++m_framesStarted;
+}
+
+void FrameScheduler::Notify()
+{
+    // Stays pending until the paint actually happens
+    if (m_redraw)
+        m_redraw();
+}
+
+unsigned long FrameScheduler::GetFramesStarted() const
+{
+    return m_framesStarted;
+}
+
+unsigned long FrameScheduler::GetRequestsCoalesced() const
+{
+    return m_requestsCoalesced;
+}
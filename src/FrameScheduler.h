@@ -0,0 +1,34 @@
+#pragma once
+#include <wx/timer.h>
+#include <chrono>
+#include <functional>
+
+// Render-on-demand: state changes only mark the canvas dirty, and all requests
+// made before the next frame collapse into one redraw, issued no faster than the
+// target rate. With nothing dirty no frames are rendered at all.
+class FrameScheduler : public wxTimer
+{
+public:
+    explicit FrameScheduler(std::function<void()> redraw);
+
+    void SetTargetFrameRate(int fps); // 0 = no limit, redraw on the next event loop pass
+    int GetTargetFrameRate() const;
+
+    void RequestFrame();
+    void OnFrameStarted(); // Every paint, scheduled or not, satisfies pending requests
+
+    unsigned long GetFramesStarted() const;
+    unsigned long GetRequestsCoalesced() const;
+
+protected:
+    void Notify() override;
+
+private:
+    std::function<void()> m_redraw;
+    std::chrono::steady_clock::time_point m_lastFrame;
+    int m_targetFps;
+    bool m_pending;
+
+    unsigned long m_framesStarted;
+    unsigned long m_requestsCoalesced;
+};
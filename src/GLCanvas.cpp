@@ -1,5 +1,6 @@
 #include <GL/glew.h>
 #include "GLCanvas.h"
+#include "Trace.h"
 #include <wx/dcclient.h>
 
 wxBEGIN_EVENT_TABLE(GLCanvas, wxGLCanvas)
@@ -16,6 +17,11 @@ GLCanvas::GLCanvas(wxWindow* parent)
     , m_glInitialized(false)
     , m_width(0)
     , m_height(0)
+    , m_hoveredButton(-1)
+    , m_gpuPicking(false)
+    , m_measureLatency(false)
+    , m_recording(nullptr)
+    , m_scheduler([this]() { RedrawNow(); })
 {
     // OpenGL context
     wxGLContextAttrs ctxAttrs;
@@ -28,17 +34,26 @@ GLCanvas::GLCanvas(wxWindow* parent)
 
 GLCanvas::~GLCanvas()
 {
+    // The render thread deletes the renderer with its context current
+    m_renderThread.Stop();
     delete m_renderer;
     delete m_context;
 }
 
+void GLCanvas::PostCommand(const RenderCommand& command, uint64_t inputTime)
+{
+    RenderCommand stamped = command;
+    stamped.inputTime = inputTime;
+    m_renderThread.Post(stamped);
+    m_scheduler.RequestFrame();
+}
+
 void GLCanvas::SetUseCustomColor(bool useCustom)
 {
-    if (m_renderer)
-    {
-        m_renderer->SetUseCustomColor(useCustom);
-        Refresh();
-    }
+    RenderCommand command;
+    command.type = RenderCommand::SetUseCustomColor;
+    command.flag = useCustom;
+    PostCommand(command);
 }
 
 void GLCanvas::SetToggleTriangleCallback(std::function<void()> callback)
@@ -46,50 +61,140 @@ void GLCanvas::SetToggleTriangleCallback(std::function<void()> callback)
     m_toggleTriangleCallback = callback;
 }
 
-void GLCanvas::SetRotation(float rotation)
+void GLCanvas::SetRotation(float rotation, uint64_t inputTime)
 {
-    if (m_renderer)
-    {
-        m_renderer->SetRotation(rotation);
-        Refresh();
-    }
+    RenderCommand command;
+    command.type = RenderCommand::SetRotation;
+    command.rotation = rotation;
+    PostCommand(command, inputTime);
 }
 
 void GLCanvas::SetTriangleVisible(bool visible)
 {
-    if (m_renderer)
-    {
-        m_renderer->SetTriangleVisible(visible);
-        Refresh();
-    }
+    RenderCommand command;
+    command.type = RenderCommand::SetTriangleVisible;
+    command.flag = visible;
+    PostCommand(command);
 }
 
 void GLCanvas::SetVertexColor(int vertexIndex, float r, float g, float b)
+{
+    RenderCommand command;
+    command.type = RenderCommand::SetVertexColor;
+    command.color.index = vertexIndex;
+    command.color.r = r;
+    command.color.g = g;
+    command.color.b = b;
+    PostCommand(command);
+}
+
+PassTimingStats GLCanvas::GetPassTimings(RenderPass pass) const
 {
     if (m_renderer)
+        return m_renderer->GetPassTimings(pass);
+
+    PassTimingStats empty = { 0.0, 0.0, 0.0, 0 };
+    return empty;
+}
+
+void GLCanvas::SetGpuPicking(bool enabled)
+{
+    m_gpuPicking = enabled;
+
+    RenderCommand command;
+    command.type = RenderCommand::SetGpuPicking;
+    command.flag = enabled;
+    PostCommand(command);
+}
+
+void GLCanvas::SetLatencyMeasurement(bool enabled)
+{
+    if (enabled && !m_measureLatency)
+        m_renderThread.GetLatencyMonitor().Reset();
+    m_measureLatency = enabled;
+}
+
+bool GLCanvas::IsMeasuringLatency() const
+{
+    return m_measureLatency;
+}
+
+uint64_t GLCanvas::StampInput() const
+{
+    return m_measureLatency ? LatencyMonitor::Now() : 0;
+}
+
+LatencyStats GLCanvas::GetLatencyStats()
+{
+    return m_renderThread.GetLatencyMonitor().GetStats();
+}
+
+std::string GLCanvas::GetLatencyHistogram()
+{
+    return m_renderThread.GetLatencyMonitor().FormatHistogram();
+}
+
+void GLCanvas::SetInputRecording(InputRecording* recording)
+{
+    m_recording = recording;
+}
+
+wxSize GLCanvas::GetCanvasSize() const
+{
+    return wxSize(m_width, m_height);
+}
+
+PassTimingStats GLCanvas::GetFrameTimeStats() const
+{
+    return m_renderThread.GetFrameTimeStats();
+}
+
+unsigned long GLCanvas::GetFrameCount() const
+{
+    return m_renderThread.GetFrameCount();
+}
+
+void GLCanvas::ResetFrameTimeStats()
+{
+    m_renderThread.ResetFrameTimeStats();
+}
+
+void GLCanvas::SetTargetFrameRate(int fps)
+{
+    m_scheduler.SetTargetFrameRate(fps);
+}
+
+void GLCanvas::RedrawNow()
+{
+    TRACE_SCOPE("GLCanvas::RedrawNow");
+    if (!m_renderThread.IsRunning())
     {
-        m_renderer->SetVertexColor(vertexIndex, r, g, b);
-        Refresh();
+        // First frame goes through OnPaint, which starts the render thread
+        Refresh(false);
+        return;
     }
+
+    m_renderThread.RequestFrame();
+    m_scheduler.OnFrameStarted();
 }
 
 void GLCanvas::OnPaint(wxPaintEvent& event)
 {
+    TRACE_SCOPE("GLCanvas::OnPaint");
     wxPaintDC dc(this);
     
     if (!IsShownOnScreen())
         return;
 
-    SetCurrent(*m_context);
-    
     if (!m_glInitialized)
     {
-        InitGL();
+        StartRenderThread();
         m_glInitialized = true;
     }
 
-    Render();
-    SwapBuffers();
+    // Expose or scheduled frame, either way the render thread draws it
+    m_renderThread.RequestFrame();
+    m_scheduler.OnFrameStarted();
 }
 
 void GLCanvas::OnSize(wxSizeEvent& event)
@@ -97,69 +202,134 @@ void GLCanvas::OnSize(wxSizeEvent& event)
     wxSize size = event.GetSize();
     m_width = size.GetWidth();
     m_height = size.GetHeight();
+    if (m_recording)
+        m_recording->Add(InputEvent::Resize, 0, m_width, m_height);
 
-    if (m_renderer && m_glInitialized)
-    {
-        SetCurrent(*m_context);
-        m_renderer->SetViewport(m_width, m_height);
-    }
+    RenderCommand command;
+    command.type = RenderCommand::SetViewport;
+    command.viewport.width = m_width;
+    command.viewport.height = m_height;
+    m_renderThread.Post(command);
 
     event.Skip();
 }
 
 void GLCanvas::OnMouseDown(wxMouseEvent& event)
 {
-    if (!m_renderer)
+    HandleMouseDown(event.GetPosition());
+}
+
+void GLCanvas::OnMouseMove(wxMouseEvent& event)
+{
+    HandleMouseMove(event.GetPosition());
+}
+
+void GLCanvas::SimulateMouseDown(int x, int y)
+{
+    HandleMouseDown(wxPoint(x, y));
+}
+
+void GLCanvas::SimulateMouseMove(int x, int y)
+{
+    HandleMouseMove(wxPoint(x, y));
+}
+
+void GLCanvas::HandleMouseDown(const wxPoint& pos)
+{
+    TRACE_SCOPE("GLCanvas::OnMouseDown");
+    uint64_t inputTime = StampInput();
+    if (m_recording)
+        m_recording->Add(InputEvent::MouseDown, 0, pos.x, pos.y);
+    if (m_width <= 0 || m_height <= 0 || !m_renderer)
         return;
 
-    wxPoint pos = event.GetPosition();
-    
-    // Mouse position 
-    float x = (2.0f * pos.x) / m_width - 1.0f;
-    float y = 1.0f - (2.0f * pos.y) / m_height;
+    PickResult pick = m_renderer->Pick((float)pos.x, (float)pos.y);
 
-    // Button click listener
-    if (m_renderer->IsButtonClicked(x, y))
+    // Main button click listener
+    if (pick.kind == PickResult::Button && pick.index == 0)
     {
         if (m_toggleTriangleCallback)
         {
             m_toggleTriangleCallback();
         }
     }
+
+    // A click changes nothing the renderer draws, so it is timed to the next frame
+    if (inputTime)
+    {
+        RenderCommand command;
+        command.type = RenderCommand::MarkInput;
+        PostCommand(command, inputTime);
+    }
 }
 
-void GLCanvas::OnMouseMove(wxMouseEvent& event)
+void GLCanvas::HandleMouseMove(const wxPoint& pos)
 {
-    if (!m_renderer)
+    TRACE_SCOPE("GLCanvas::OnMouseMove");
+    uint64_t inputTime = StampInput();
+    if (m_recording)
+        m_recording->Add(InputEvent::MouseMove, 0, pos.x, pos.y);
+    if (m_width <= 0 || m_height <= 0 || !m_renderer)
         return;
 
-    wxPoint pos = event.GetPosition();
-    
-    // Mouse position
-    float x = (2.0f * pos.x) / m_width - 1.0f;
-    float y = 1.0f - (2.0f * pos.y) / m_height;
-
-    // Hover
-    bool wasHovered = m_renderer->IsButtonHovered();
-    m_renderer->UpdateButtonHover(x, y);
-    bool isHovered = m_renderer->IsButtonHovered();
-
-    if (wasHovered != isHovered)
+    // The id pass needs to know where to look; its answer arrives a frame later
+    if (m_gpuPicking)
     {
-        Refresh();
+        RenderCommand command;
+        command.type = RenderCommand::SetPickPoint;
+        command.point.x = pos.x;
+        command.point.y = pos.y;
+        PostCommand(command, inputTime);
     }
 
-    if (isHovered)
+    // Hover, from the renderer's spatial index
+    PickResult pick = m_renderer->Pick((float)pos.x, (float)pos.y);
+    int hovered = pick.kind == PickResult::Button ? (int)pick.index : -1;
+
+    // Only hover transitions need a frame or a new cursor
+    if (m_hoveredButton != hovered)
     {
-        SetCursor(wxCursor(wxCURSOR_HAND));
+        RenderCommand command;
+        command.type = RenderCommand::SetButtonHovered;
+        if (m_hoveredButton >= 0)
+        {
+            command.hover.index = m_hoveredButton;
+            command.hover.hovered = false;
+            PostCommand(command, inputTime);
+        }
+        if (hovered >= 0)
+        {
+            command.hover.index = hovered;
+            command.hover.hovered = true;
+            PostCommand(command, inputTime);
+        }
+        m_hoveredButton = hovered;
+
+        SetCursor(wxCursor(hovered >= 0 ? wxCURSOR_HAND : wxCURSOR_ARROW));
     }
-    else
+}
+
+bool GLCanvas::SetCaptureFile(const std::string& path)
+{
+    if (m_glInitialized)
     {
-        SetCursor(wxCursor(wxCURSOR_ARROW));
+        wxLogWarning("Capture has to be set up before the first frame");
+        return false;
     }
+    m_capturePath = path;
+    return true;
 }
 
-void GLCanvas::InitGL()
+void GLCanvas::StartRenderThread()
+{
+    RenderThread::Callbacks callbacks;
+    callbacks.initialize = [this]() { return InitGL(); };
+    callbacks.present = [this]() { Present(); };
+    callbacks.shutdown = [this]() { ShutdownGL(); };
+    m_renderThread.Start(m_renderer, callbacks);
+}
+
+bool GLCanvas::InitGL()
 {
     SetCurrent(*m_context);
     
@@ -167,22 +337,39 @@ void GLCanvas::InitGL()
     if (glewInit() != GLEW_OK)
     {
         wxLogError("Failed to initialize GLEW");
-        return;
+        return false;
     }
 
-    // Render
-    if (m_renderer)
-    {
-        m_renderer->Initialize();
-        m_renderer->SetViewport(m_width, m_height);
-    }
+    // Finished texture decodes need a frame to get uploaded
+    m_renderer->GetTextureLoader().SetReadyCallback([this]() { m_renderThread.Wake(); });
+
+    // Render (viewport arrives through the command queue)
+    if (!m_renderer->Initialize())
+        return false;
+
+    // Frames are dropped rather than the UI held up when the encoder falls behind
+    if (!m_capturePath.empty())
+        m_renderer->StartCapture(m_capturePath, 60, true);
+    return true;
 }
 
-void GLCanvas::Render()
+void GLCanvas::Present()
 {
-    if (m_renderer)
+    TRACE_SCOPE("GLCanvas::SwapBuffers");
+    m_renderer->GetProfiler().BeginPass(RenderPass::Swap);
+    SwapBuffers();
+    m_renderer->GetProfiler().EndPass(RenderPass::Swap);
+}
+
+void GLCanvas::ShutdownGL()
+{
+    if (m_renderer->IsCapturing())
     {
-        m_renderer->Render();
+        m_renderer->StopCapture();
+        CaptureStats stats = m_renderer->GetCaptureStats();
+        wxLogVerbose("Capture: %zu frames written to %s, %zu dropped, %.2f ms encode per frame",
+                     stats.written, m_capturePath, stats.dropped, stats.encodeMs);
     }
+    delete m_renderer;
+    m_renderer = nullptr;
 }
-
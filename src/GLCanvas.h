@@ -4,6 +4,9 @@
 #include <wx/glcanvas.h>
 #include <functional>
 #include "Renderer.h"
+#include "FrameScheduler.h"
+#include "InputRecording.h"
+#include "RenderThread.h"
 
 class GLCanvas : public wxGLCanvas
 {
@@ -12,25 +15,67 @@ public:
     ~GLCanvas();
 
     void SetToggleTriangleCallback(std::function<void()> callback);
-    void SetRotation(float rotation);
+    void SetRotation(float rotation, uint64_t inputTime = 0);
     void SetTriangleVisible(bool visible);
     void SetVertexColor(int vertexIndex, float r, float g, float b);
     void SetUseCustomColor(bool useCustom);
+    PassTimingStats GetPassTimings(RenderPass pass) const;
+    void SetTargetFrameRate(int fps);
+    void SetGpuPicking(bool enabled); // Triangles picked from an id pass instead of the CPU index
+
+    // Input-to-photon latency: handlers stamp their input on arrival, the stamp
+    // rides along with the commands it causes to the frame that shows them
+    void SetLatencyMeasurement(bool enabled); // Starts a fresh histogram
+    bool IsMeasuringLatency() const;
+    uint64_t StampInput() const; // Arrival time for commands posted by this handler, 0 while not measuring
+    LatencyStats GetLatencyStats();
+    std::string GetLatencyHistogram();
+
+    // Record/replay: mouse input is recorded while a recording is set, and
+    // replays go through the same handling as real events
+    void SetInputRecording(InputRecording* recording);
+    void SimulateMouseMove(int x, int y);
+    void SimulateMouseDown(int x, int y);
+    wxSize GetCanvasSize() const;
+    PassTimingStats GetFrameTimeStats() const;
+    unsigned long GetFrameCount() const;
+    void ResetFrameTimeStats();
+
+    // Captures every frame to a .y4m video or PNG sequence (see FrameCapture);
+    // has to be set before the canvas is first shown
+    bool SetCaptureFile(const std::string& path);
 
 private:
     void OnPaint(wxPaintEvent& event);
     void OnSize(wxSizeEvent& event);
     void OnMouseDown(wxMouseEvent& event);
     void OnMouseMove(wxMouseEvent& event);
-    void InitGL();
-    void Render();
+    void HandleMouseDown(const wxPoint& pos);
+    void HandleMouseMove(const wxPoint& pos);
+    // Render thread side
+    bool InitGL();
+    void Present();
+    void ShutdownGL();
+
+    void StartRenderThread();
+    void PostCommand(const RenderCommand& command, uint64_t inputTime = 0);
+    void RedrawNow();
 
     wxGLContext* m_context;
-    Renderer* m_renderer;
+    Renderer* m_renderer; // Owned by the render thread once it runs
     std::function<void()> m_toggleTriangleCallback;
     
     bool m_glInitialized;
     int m_width, m_height;
+    int m_hoveredButton; // -1 = none; UI-side copy, the renderer's is on the render thread
+    bool m_gpuPicking;
+    bool m_measureLatency;
+    InputRecording* m_recording; // Not owned
+    std::string m_capturePath;   // Read by the render thread once it starts
+
+    // Coalesces frame requests from setters and hover changes
+    FrameScheduler m_scheduler;
+    RenderThread m_renderThread;
 
     wxDECLARE_EVENT_TABLE();
 };
@@ -0,0 +1,148 @@
+#include <GL/glew.h>
+#include "GLStateCache.h"
+#include <cstring>
+
+namespace
+{
+// Never a valid GL name, forces the first call after Invalidate() through
+const unsigned int kUnknown = 0xFFFFFFFFu;
+}
+
+GLStateCache::GLStateCache()
+{
+    Invalidate();
+    ResetStats();
+}
+
+void GLStateCache::Invalidate()
+{
+    m_program = kUnknown;
+    m_vertexArray = kUnknown;
+    m_activeUnit = kUnknown;
+    m_depthTest = -1;
+    InvalidateTextures();
+    m_uniforms.clear();
+}
+
+void GLStateCache::InvalidateTextures()
+{
+    for (unsigned int& texture : m_textures)
+        texture = kUnknown;
+}
+
+void GLStateCache::ResetStats()
+{
+    m_stats.issued = 0;
+    m_stats.skipped = 0;
+}
+
+void GLStateCache::UseProgram(unsigned int program)
+{
+    if (m_program == program)
+    {
+        ++m_stats.skipped;
+        return;
+    }
+    glUseProgram(program);
+    m_program = program;
+    ++m_stats.issued;
+}
+
+void GLStateCache::BindVertexArray(unsigned int vertexArray)
+{
+    if (m_vertexArray == vertexArray)
+    {
+        ++m_stats.skipped;
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    m_vertexArray = vertexArray;
+    ++m_stats.issued;
+}
+
+void GLStateCache::ActiveTexture(unsigned int unit)
+{
+    unsigned int index = unit - GL_TEXTURE0;
+    if (m_activeUnit == index)
+    {
+        ++m_stats.skipped;
+        return;
+    }
+    glActiveTexture(unit);
+    m_activeUnit = index;
+    ++m_stats.issued;
+}
+
+void GLStateCache::BindTexture2D(unsigned int texture)
+{
+    // Unknown active unit: bind anyway, nothing can be recorded for it
+    bool tracked = m_activeUnit < (unsigned int)kTextureUnits;
+    if (tracked && m_textures[m_activeUnit] == texture)
+    {
+        ++m_stats.skipped;
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (tracked)
+        m_textures[m_activeUnit] = texture;
+    ++m_stats.issued;
+}
+
+void GLStateCache::SetDepthTest(bool enabled)
+{
+    if (m_depthTest == (int)enabled)
+    {
+        ++m_stats.skipped;
+        return;
+    }
+    if (enabled)
+        glEnable(GL_DEPTH_TEST);
+    else
+        glDisable(GL_DEPTH_TEST);
+    m_depthTest = (int)enabled;
+    ++m_stats.issued;
+}
+
+bool GLStateCache::UniformChanged(int location, const void* value, int components)
+{
+    // Location -1 is silently ignored by GL, skip it here as well
+    if (location < 0)
+        return false;
+    if (m_program == kUnknown)
+    {
+        ++m_stats.issued;
+        return true;
+    }
+
+    uint64_t key = ((uint64_t)m_program << 32) | (uint32_t)location;
+    UniformValue& cached = m_uniforms[key];
+    if (cached.components == components && std::memcmp(cached.bits, value, components * 4) == 0)
+    {
+        ++m_stats.skipped;
+        return false;
+    }
+
+    std::memcpy(cached.bits, value, components * 4);
+    cached.components = components;
+    ++m_stats.issued;
+    return true;
+}
+
+void GLStateCache::Uniform1i(int location, int value)
+{
+    if (UniformChanged(location, &value, 1))
+        glUniform1i(location, value);
+}
+
+void GLStateCache::Uniform1f(int location, float value)
+{
+    if (UniformChanged(location, &value, 1))
+        glUniform1f(location, value);
+}
+
+void GLStateCache::Uniform2f(int location, float x, float y)
+{
+    float value[2] = { x, y };
+    if (UniformChanged(location, value, 2))
+        glUniform2f(location, x, y);
+}
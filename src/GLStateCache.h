@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+
+struct StateCacheStats
+{
+    unsigned int issued;  // Calls that reached the driver
+    unsigned int skipped; // Redundant calls dropped
+};
+
+// Shadow copy of the bindings the Renderer changes every frame: program, vertex
+// array, active texture unit, 2D texture per unit, uniform values per program,
+// and whether depth testing is on.
+// Calls that would not change anything are dropped before they reach the driver.
+// Only valid while all of these go through the cache; call Invalidate() after
+// other code touched them in the same context.
+class GLStateCache
+{
+public:
+    static const int kTextureUnits = 16;
+
+    GLStateCache();
+
+    void Invalidate();
+    void InvalidateTextures();
+
+    void UseProgram(unsigned int program);
+    void BindVertexArray(unsigned int vertexArray);
+    void ActiveTexture(unsigned int unit); // GL_TEXTURE0 + n
+    void BindTexture2D(unsigned int texture);
+    void SetDepthTest(bool enabled);
+
+    // Uniforms of the program bound through UseProgram()
+    void Uniform1i(int location, int value);
+    void Uniform1f(int location, float value);
+    void Uniform2f(int location, float x, float y);
+
+    void ResetStats();
+    const StateCacheStats& GetStats() const { return m_stats; }
+
+private:
+    struct UniformValue
+    {
+        uint32_t bits[2];
+        int components;
+    };
+
+    bool UniformChanged(int location, const void* value, int components);
+
+    unsigned int m_program;
+    unsigned int m_vertexArray;
+    unsigned int m_activeUnit; // Index, not the GL_TEXTURE0 enum
+    unsigned int m_textures[kTextureUnits];
+    int m_depthTest; // -1 = unknown
+
+    // Key: program << 32 | location
+    std::unordered_map<uint64_t, UniformValue> m_uniforms;
+
+    StateCacheStats m_stats;
+};
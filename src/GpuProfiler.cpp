@@ -0,0 +1,200 @@
+#include <GL/glew.h>
+#include "GpuProfiler.h"
+#include <algorithm>
+
+GpuProfiler::GpuProfiler()
+    : m_currentFrame(0)
+    , m_enabled(false)
+    , m_droppedFrames(0)
+{
+    for (FrameQueries& frame : m_frames)
+    {
+        for (int pass = 0; pass < kPassCount; ++pass)
+        {
+            frame.begin[pass] = 0;
+            frame.end[pass] = 0;
+            frame.issued[pass] = false;
+        }
+        frame.pending = false;
+    }
+
+    for (int pass = 0; pass < kPassCount; ++pass)
+    {
+        m_history[pass].reserve(kHistorySize);
+        m_historyNext[pass] = 0;
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (!m_enabled)
+        return;
+
+    for (FrameQueries& frame : m_frames)
+    {
+        glDeleteQueries(kPassCount, frame.begin);
+        glDeleteQueries(kPassCount, frame.end);
+    }
+}
+
+bool GpuProfiler::Initialize()
+{
+    // Timer queries are core in 3.3, but some drivers still lack them
+    if (!GLEW_ARB_timer_query && !GLEW_VERSION_3_3)
+        return false;
+
+    for (FrameQueries& frame : m_frames)
+    {
+        glGenQueries(kPassCount, frame.begin);
+        glGenQueries(kPassCount, frame.end);
+    }
+
+    m_enabled = true;
+    return true;
+}
+
+bool GpuProfiler::IsEnabled() const
+{
+    return m_enabled;
+}
+
+void GpuProfiler::BeginFrame()
+{
+    if (!m_enabled)
+        return;
+
+    // Older frames first, whatever has finished by now
+    for (int i = 1; i < kFramesInFlight; ++i)
+    {
+        FrameQueries& frame = m_frames[(m_currentFrame + i) % kFramesInFlight];
+        if (frame.pending)
+            Collect(frame, false);
+    }
+
+    m_currentFrame = (m_currentFrame + 1) % kFramesInFlight;
+
+    // Reusing the oldest slot: give up on it rather than wait
+    FrameQueries& frame = m_frames[m_currentFrame];
+    if (frame.pending)
+        Collect(frame, true);
+
+    for (int pass = 0; pass < kPassCount; ++pass)
+        frame.issued[pass] = false;
+    frame.pending = true;
+}
+
+void GpuProfiler::BeginPass(RenderPass pass)
+{
+    if (!m_enabled)
+        return;
+
+    glQueryCounter(m_frames[m_currentFrame].begin[(int)pass], GL_TIMESTAMP);
+}
+
+void GpuProfiler::EndPass(RenderPass pass)
+{
+    if (!m_enabled)
+        return;
+
+    FrameQueries& frame = m_frames[m_currentFrame];
+    glQueryCounter(frame.end[(int)pass], GL_TIMESTAMP);
+    frame.issued[(int)pass] = true;
+}
+
+void GpuProfiler::Collect(FrameQueries& frame, bool discardIfBusy)
+{
+    // Only read a frame once every pass in it has completed
+    for (int pass = 0; pass < kPassCount; ++pass)
+    {
+        if (!frame.issued[pass])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(frame.end[pass], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            if (discardIfBusy)
+            {
+                ++m_droppedFrames;
+                frame.pending = false;
+            }
+            return;
+        }
+    }
+
+    for (int pass = 0; pass < kPassCount; ++pass)
+    {
+        if (!frame.issued[pass])
+            continue;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame.begin[pass], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.end[pass], GL_QUERY_RESULT, &end);
+        if (end >= begin)
+            AddSample(pass, (end - begin) / 1.0e6);
+    }
+    frame.pending = false;
+}
+
+void GpuProfiler::AddSample(int pass, double ms)
+{
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    std::vector<double>& history = m_history[pass];
+    if (history.size() < kHistorySize)
+        history.push_back(ms);
+    else
+        history[m_historyNext[pass]] = ms;
+    m_historyNext[pass] = (m_historyNext[pass] + 1) % kHistorySize;
+}
+
+PassTimingStats GpuProfiler::GetStats(RenderPass pass) const
+{
+    PassTimingStats stats = { 0.0, 0.0, 0.0, 0 };
+    std::vector<double> sorted;
+    {
+        std::lock_guard<std::mutex> lock(m_historyMutex);
+        sorted = m_history[(int)pass];
+    }
+    if (sorted.empty())
+        return stats;
+
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0.0;
+    for (double ms : sorted)
+        total += ms;
+
+    size_t p99Index = std::min(sorted.size() - 1, (size_t)(0.99 * (sorted.size() - 1) + 0.5));
+    stats.minMs = sorted.front();
+    stats.avgMs = total / sorted.size();
+    stats.p99Ms = sorted[p99Index];
+    stats.samples = sorted.size();
+    return stats;
+}
+
+void GpuProfiler::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    for (int pass = 0; pass < kPassCount; ++pass)
+    {
+        m_history[pass].clear();
+        m_historyNext[pass] = 0;
+    }
+    m_droppedFrames = 0;
+}
+
+size_t GpuProfiler::GetDroppedFrames() const
+{
+    return m_droppedFrames;
+}
+
+const char* GpuProfiler::GetPassName(RenderPass pass)
+{
+    switch (pass)
+    {
+        case RenderPass::Triangle: return "triangle";
+        case RenderPass::Button: return "button";
+        case RenderPass::Swap: return "swap";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+enum class RenderPass
+{
+    Triangle,
+    Button,
+    Swap,
+    Count
+};
+
+struct PassTimingStats
+{
+    double minMs, avgMs, p99Ms;
+    size_t samples; // 0 until the first results come back
+};
+
+// GL_TIMESTAMP queries around each render pass, kept in a ring a few frames deep.
+// Results are collected only once the driver reports them available, so reading
+// them never stalls the pipeline; a slot that is still busy when reused is dropped.
+class GpuProfiler
+{
+public:
+    static const int kFramesInFlight = 4;
+    static const size_t kHistorySize = 240;
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    bool Initialize();
+    bool IsEnabled() const;
+
+    void BeginFrame();
+    void BeginPass(RenderPass pass);
+    void EndPass(RenderPass pass);
+
+    PassTimingStats GetStats(RenderPass pass) const;
+    void ResetStats();
+    size_t GetDroppedFrames() const;
+    static const char* GetPassName(RenderPass pass);
+
+private:
+    static const int kPassCount = (int)RenderPass::Count;
+
+    struct FrameQueries
+    {
+        unsigned int begin[kPassCount];
+        unsigned int end[kPassCount];
+        bool issued[kPassCount];
+        bool pending;
+    };
+
+    void Collect(FrameQueries& frame, bool discardIfBusy);
+    void AddSample(int pass, double ms);
+
+    FrameQueries m_frames[kFramesInFlight];
+    int m_currentFrame;
+    bool m_enabled;
+
+    // Rolling window per pass; stats may be read from another thread than the GL one
+    mutable std::mutex m_historyMutex;
+    std::vector<double> m_history[kPassCount];
+    size_t m_historyNext[kPassCount];
+    size_t m_droppedFrames;
+};
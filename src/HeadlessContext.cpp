@@ -0,0 +1,185 @@
+#include <GL/glew.h>
+#include "HeadlessContext.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <wx/log.h>
+#include <cstring>
+#include <mutex>
+
+namespace
+{
+bool HasExtension(const char* extensions, const char* name)
+{
+    if (!extensions)
+        return false;
+
+    size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name))
+    {
+        bool startOk = (p == extensions) || (p[-1] == ' ');
+        bool endOk = (p[length] == ' ') || (p[length] == '\0');
+        if (startOk && endOk)
+            return true;
+    }
+    return false;
+}
+
+EGLDisplay OpenDisplay()
+{
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if (getPlatformDisplay)
+    {
+        // Mesa: llvmpipe or a render node, no display server needed
+        if (HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY)
+                return display;
+        }
+
+        // NVIDIA and others: first enumerated device
+        auto queryDevices = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+        if (queryDevices && HasExtension(clientExtensions, "EGL_EXT_platform_device"))
+        {
+            EGLDeviceEXT device;
+            EGLint deviceCount = 0;
+            if (queryDevices(1, &device, &deviceCount) && deviceCount > 0)
+            {
+                EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+                if (display != EGL_NO_DISPLAY)
+                    return display;
+            }
+        }
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+}
+
+HeadlessContext::HeadlessContext()
+    : m_display(EGL_NO_DISPLAY)
+    , m_context(EGL_NO_CONTEXT)
+    , m_surface(EGL_NO_SURFACE)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (m_display == EGL_NO_DISPLAY)
+        return;
+
+    if (eglGetCurrentContext() == m_context)
+        ReleaseCurrent();
+    if (m_surface != EGL_NO_SURFACE) eglDestroySurface(m_display, m_surface);
+    if (m_context != EGL_NO_CONTEXT) eglDestroyContext(m_display, m_context);
+
+    // The display is shared by every context in the process, so it is not terminated here
+}
+
+bool HeadlessContext::Create(int majorVersion, int minorVersion)
+{
+    // Batch tools create contexts from several threads at once; display setup
+    // and GLEW's process-wide entry points are not safe to race on
+    static std::mutex createMutex;
+    std::lock_guard<std::mutex> lock(createMutex);
+
+    m_display = OpenDisplay();
+    if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, nullptr, nullptr))
+    {
+        wxLogError("Failed to open an EGL display");
+        m_display = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        wxLogError("EGL display does not support desktop OpenGL");
+        return false;
+    }
+
+    const char* extensions = eglQueryString(m_display, EGL_EXTENSIONS);
+    bool surfaceless = HasExtension(extensions, "EGL_KHR_surfaceless_context");
+
+    EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(m_display, configAttribs, &config, 1, &configCount) || configCount == 0)
+    {
+        if (!HasExtension(extensions, "EGL_KHR_no_config_context"))
+        {
+            wxLogError("No suitable EGL config");
+            return false;
+        }
+        config = EGL_NO_CONFIG_KHR;
+    }
+
+    EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (m_context == EGL_NO_CONTEXT)
+    {
+        wxLogError("Failed to create EGL context (OpenGL %d.%d core)", majorVersion, minorVersion);
+        return false;
+    }
+
+    if (!surfaceless)
+    {
+        EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        m_surface = eglCreatePbufferSurface(m_display, config, pbufferAttribs);
+        if (m_surface == EGL_NO_SURFACE)
+        {
+            wxLogError("Failed to create EGL pbuffer surface");
+            return false;
+        }
+    }
+
+    if (!MakeCurrent())
+        return false;
+
+    // GLEW
+    glewExperimental = GL_TRUE;
+    GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLX builds of GLEW load the GL entry points, then fail to find an X display
+    if (glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)
+        glewStatus = GLEW_OK;
+#endif
+    if (glewStatus != GLEW_OK)
+    {
+        wxLogError("Failed to initialize GLEW");
+        return false;
+    }
+
+    return true;
+}
+
+bool HeadlessContext::MakeCurrent()
+{
+    if (!eglMakeCurrent(m_display, m_surface, m_surface, m_context))
+    {
+        wxLogError("Failed to make EGL context current");
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::ReleaseCurrent()
+{
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+bool HeadlessContext::IsValid() const
+{
+    return m_context != EGL_NO_CONTEXT;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// OpenGL 3.3 core context without a window (EGL surfaceless).
+// Lets Renderer run in CI and batch jobs on machines with no display.
+// Each thread can own one; Create() may be called from several at once.
+class HeadlessContext
+{
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    bool Create(int majorVersion = 3, int minorVersion = 3);
+    bool MakeCurrent();
+    void ReleaseCurrent();
+    bool IsValid() const;
+
+private:
+    // EGL handles kept opaque so the header doesn't drag in EGL
+    void* m_display;
+    void* m_context;
+    void* m_surface; // 1x1 pbuffer, only when surfaceless contexts are unsupported
+};
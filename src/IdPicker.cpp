@@ -0,0 +1,171 @@
+#include <GL/glew.h>
+#include "IdPicker.h"
+#include <wx/log.h>
+
+IdPicker::IdPicker()
+    : m_framebuffer(0), m_idRenderbuffer(0)
+    , m_width(0), m_height(0)
+    , m_nextReadback(0)
+    , m_passX(0), m_passY(0)
+    , m_previousFramebuffer(0)
+    , m_result(kNoResult)
+{
+    for (Readback& readback : m_readbacks)
+        readback = Readback{ 0, nullptr, 0, 0 };
+}
+
+IdPicker::~IdPicker()
+{
+    Release();
+}
+
+void IdPicker::Release()
+{
+    for (Readback& readback : m_readbacks)
+    {
+        if (readback.fence) glDeleteSync((GLsync)readback.fence);
+        if (readback.buffer) glDeleteBuffers(1, &readback.buffer);
+        readback = Readback{ 0, nullptr, 0, 0 };
+    }
+    if (m_framebuffer) glDeleteFramebuffers(1, &m_framebuffer);
+    if (m_idRenderbuffer) glDeleteRenderbuffers(1, &m_idRenderbuffer);
+    m_framebuffer = 0;
+    m_idRenderbuffer = 0;
+    m_width = 0;
+    m_height = 0;
+}
+
+bool IdPicker::Resize(int width, int height)
+{
+    if (width == m_width && height == m_height && m_framebuffer)
+        return true;
+
+    Release();
+    if (width <= 0 || height <= 0)
+        return false;
+    m_width = width;
+    m_height = height;
+
+    glGenRenderbuffers(1, &m_idRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_idRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLint previous = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous);
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_idRenderbuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, previous);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        wxLogError("Picking framebuffer incomplete: 0x%x", status);
+        Release();
+        return false;
+    }
+
+    // One pixel per readback
+    for (Readback& readback : m_readbacks)
+    {
+        glGenBuffers(1, &readback.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return true;
+}
+
+bool IdPicker::BeginPass(int x, int y)
+{
+    if (!m_framebuffer || x < 0 || y < 0 || x >= m_width || y >= m_height)
+        return false;
+
+    m_passX = x;
+    m_passY = y;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+    // Only the pixel under the pointer is ever read
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x, m_height - 1 - y, 1, 1);
+    const GLuint background[4] = { 0, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, background);
+    return true;
+}
+
+void IdPicker::EndPass()
+{
+    glDisable(GL_SCISSOR_TEST);
+
+    // A slot still in flight after kReadbackDepth passes is dropped
+    Readback& readback = m_readbacks[m_nextReadback];
+    m_nextReadback = (m_nextReadback + 1) % kReadbackDepth;
+    if (readback.fence)
+        glDeleteSync((GLsync)readback.fence);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glReadPixels(m_passX, m_height - 1 - m_passY, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.x = m_passX;
+    readback.y = m_passY;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_previousFramebuffer);
+}
+
+void IdPicker::Collect()
+{
+    // Oldest first, so the newest finished pick wins
+    for (int i = 0; i < kReadbackDepth; ++i)
+    {
+        Readback& readback = m_readbacks[(m_nextReadback + i) % kReadbackDepth];
+        if (!readback.fence)
+            continue;
+
+        GLenum status = glClientWaitSync((GLsync)readback.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+        glDeleteSync((GLsync)readback.fence);
+        readback.fence = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        const GLuint* id = (const GLuint*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT);
+        if (id)
+        {
+            uint64_t packed = ((uint64_t)(readback.x & 0xFFFF) << 48) | ((uint64_t)(readback.y & 0xFFFF) << 32) | *id;
+            m_result.store(packed, std::memory_order_release);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
+
+bool IdPicker::HasPending() const
+{
+    for (const Readback& readback : m_readbacks)
+    {
+        if (readback.fence)
+            return true;
+    }
+    return false;
+}
+
+bool IdPicker::GetResult(int& x, int& y, unsigned int& id) const
+{
+    uint64_t packed = m_result.load(std::memory_order_acquire);
+    if (packed == kNoResult)
+        return false;
+
+    x = (int)((packed >> 48) & 0xFFFF);
+    y = (int)((packed >> 32) & 0xFFFF);
+    id = (unsigned int)(packed & 0xFFFFFFFF);
+    return true;
+}
+
+void IdPicker::ClearResult()
+{
+    m_result.store(kNoResult, std::memory_order_release);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// GPU picking: object ids are drawn into an R32UI attachment, scissored to the
+// one pixel under the pointer, and read back through a small ring of pixel
+// buffers. Results are collected once their fence has passed (normally on the
+// next frame), so a pick never stalls the pipeline and its CPU cost does not
+// depend on how much geometry is on screen. Id 0 means nothing was hit.
+class IdPicker
+{
+public:
+    static const int kReadbackDepth = 3;
+
+    IdPicker();
+    ~IdPicker();
+
+    // GL thread
+    bool Resize(int width, int height);
+    void Release();
+    // Binds the id target and clears the pixel at (x, y), top-left origin; false if outside
+    bool BeginPass(int x, int y);
+    void EndPass(); // Queues the readback and restores the previous framebuffer
+    void Collect(); // Resolves readbacks whose fence has passed, never waits
+    bool HasPending() const;
+
+    // Any thread: latest resolved pick
+    bool GetResult(int& x, int& y, unsigned int& id) const;
+    void ClearResult();
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+private:
+    struct Readback
+    {
+        unsigned int buffer;
+        void* fence; // GLsync, null when idle
+        int x, y;
+    };
+
+    static const uint64_t kNoResult = ~0ull;
+
+    unsigned int m_framebuffer;
+    unsigned int m_idRenderbuffer;
+    int m_width, m_height;
+
+    Readback m_readbacks[kReadbackDepth];
+    int m_nextReadback;
+    int m_passX, m_passY;
+    int m_previousFramebuffer;
+
+    std::atomic<uint64_t> m_result; // x:16 | y:16 | id:32
+};
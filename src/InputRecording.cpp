@@ -0,0 +1,273 @@
+#include "InputRecording.h"
+#include "Renderer.h"
+#include <wx/log.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+const char kMagic[4] = { 'I', 'N', 'R', 'C' };
+const uint32_t kFormatVersion = 1;
+
+void PutVarint(std::vector<unsigned char>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((unsigned char)value);
+}
+
+void PutSigned(std::vector<unsigned char>& out, int32_t value)
+{
+    // Zigzag, so small negative numbers stay small
+    PutVarint(out, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+void PutUint32(std::vector<unsigned char>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push_back((unsigned char)(value >> (i * 8)));
+}
+
+class Reader
+{
+public:
+    Reader(const std::vector<unsigned char>& data) : m_data(data), m_offset(0), m_ok(true) {}
+
+    bool IsOk() const { return m_ok; }
+    bool AtEnd() const { return m_offset >= m_data.size(); }
+
+    unsigned char Byte()
+    {
+        if (m_offset >= m_data.size())
+        {
+            m_ok = false;
+            return 0;
+        }
+        return m_data[m_offset++];
+    }
+
+    uint32_t Uint32()
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i)
+            value |= (uint32_t)Byte() << (i * 8);
+        return value;
+    }
+
+    uint64_t Varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            unsigned char byte = Byte();
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        m_ok = false;
+        return 0;
+    }
+
+    int32_t Signed()
+    {
+        uint32_t value = (uint32_t)Varint();
+        return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    }
+
+private:
+    const std::vector<unsigned char>& m_data;
+    size_t m_offset;
+    bool m_ok;
+};
+}
+
+InputRecording::InputRecording()
+    : m_start(std::chrono::steady_clock::now())
+{
+}
+
+void InputRecording::Start()
+{
+    m_events.clear();
+    m_start = std::chrono::steady_clock::now();
+}
+
+void InputRecording::Add(InputEvent::Type type, int target, int x, int y)
+{
+    InputEvent event;
+    event.timeUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_start).count();
+    event.type = type;
+    event.target = (uint8_t)target;
+    event.x = x;
+    event.y = y;
+    m_events.push_back(event);
+}
+
+void InputRecording::Add(const InputEvent& event)
+{
+    m_events.push_back(event);
+}
+
+void InputRecording::Clear()
+{
+    m_events.clear();
+}
+
+const std::vector<InputEvent>& InputRecording::GetEvents() const
+{
+    return m_events;
+}
+
+uint64_t InputRecording::GetDurationUs() const
+{
+    return m_events.empty() ? 0 : m_events.back().timeUs;
+}
+
+bool InputRecording::Save(const std::string& path) const
+{
+    std::vector<unsigned char> data(kMagic, kMagic + 4);
+    PutUint32(data, kFormatVersion);
+    PutUint32(data, (uint32_t)m_events.size());
+
+    uint64_t previous = 0;
+    for (const InputEvent& event : m_events)
+    {
+        PutVarint(data, event.timeUs - previous);
+        data.push_back(event.type);
+        data.push_back(event.target);
+        PutSigned(data, event.x);
+        PutSigned(data, event.y);
+        previous = event.timeUs;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)data.data(), (std::streamsize)data.size());
+    if (!file)
+    {
+        wxLogError("Failed to write input recording %s", path);
+        return false;
+    }
+    return true;
+}
+
+bool InputRecording::Load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        wxLogError("Cannot open input recording %s", path);
+        return false;
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Reader reader(data);
+    bool magicOk = true;
+    for (char c : kMagic)
+        magicOk = reader.Byte() == (unsigned char)c && magicOk;
+    uint32_t version = reader.Uint32();
+    uint32_t count = reader.Uint32();
+    if (!reader.IsOk() || !magicOk || version != kFormatVersion)
+    {
+        wxLogError("%s is not an input recording this build can read", path);
+        return false;
+    }
+
+    // Each event takes at least 5 bytes, so a corrupt count cannot reserve more than the file holds
+    std::vector<InputEvent> events;
+    events.reserve(std::min<size_t>(count, data.size() / 5));
+    uint64_t time = 0;
+    for (uint32_t i = 0; i < count && reader.IsOk(); ++i)
+    {
+        InputEvent event;
+        time += reader.Varint();
+        event.timeUs = time;
+        unsigned char type = reader.Byte();
+        event.type = (InputEvent::Type)type;
+        event.target = reader.Byte();
+        event.x = reader.Signed();
+        event.y = reader.Signed();
+        if (type > InputEvent::Color)
+        {
+            wxLogError("Unknown event type %d in %s", (int)type, path);
+            return false;
+        }
+        events.push_back(event);
+    }
+    if (!reader.IsOk() || !reader.AtEnd())
+    {
+        wxLogError("Input recording %s is truncated or corrupt", path);
+        return false;
+    }
+
+    m_events.swap(events);
+    return true;
+}
+
+InputReplayer::InputReplayer()
+    : m_hoveredButton(-1)
+    , m_gpuPicking(false)
+{
+}
+
+void InputReplayer::Apply(const InputEvent& event, Renderer& renderer)
+{
+    switch (event.type)
+    {
+        case InputEvent::Resize:
+            renderer.SetViewport(event.x, event.y);
+            break;
+        case InputEvent::MouseMove:
+        {
+            if (m_gpuPicking)
+                renderer.SetPickPoint(event.x, event.y);
+
+            // Hover transitions, as GLCanvas::OnMouseMove
+            PickResult pick = renderer.Pick((float)event.x, (float)event.y);
+            int hovered = pick.kind == PickResult::Button ? (int)pick.index : -1;
+            if (hovered != m_hoveredButton)
+            {
+                if (m_hoveredButton >= 0)
+                    renderer.SetButtonHovered((size_t)m_hoveredButton, false);
+                if (hovered >= 0)
+                    renderer.SetButtonHovered((size_t)hovered, true);
+                m_hoveredButton = hovered;
+            }
+            break;
+        }
+        case InputEvent::MouseDown:
+            // The button only toggles the side panel, nothing the renderer draws
+            break;
+        case InputEvent::Slider:
+            renderer.SetRotation((float)event.x);
+            break;
+        case InputEvent::Checkbox:
+            if (event.target == InputEvent::ShowTriangle)
+                renderer.SetTriangleVisible(event.x != 0);
+            else if (event.target == InputEvent::CustomColors)
+                renderer.SetUseCustomColor(event.x != 0);
+            else if (event.target == InputEvent::GpuPicking)
+            {
+                m_gpuPicking = event.x != 0;
+                renderer.SetGpuPicking(m_gpuPicking);
+            }
+            break;
+        case InputEvent::Color:
+            renderer.SetVertexColor(event.target,
+                                    ((event.x >> 16) & 0xFF) / 255.0f,
+                                    ((event.x >> 8) & 0xFF) / 255.0f,
+                                    (event.x & 0xFF) / 255.0f);
+            break;
+    }
+}
+
+size_t InputReplayer::FrameEnd(const std::vector<InputEvent>& events, size_t index, uint64_t frameEndUs)
+{
+    while (index < events.size() && events[index].timeUs < frameEndUs)
+        ++index;
+    return index;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Renderer;
+
+// One UI input, as GLCanvas and MainFrame received it
+struct InputEvent
+{
+    enum Type : uint8_t
+    {
+        Resize,    // x, y = canvas size
+        MouseMove, // x, y = canvas pixels
+        MouseDown,
+        Slider,    // x = rotation slider value
+        Checkbox,  // target = Checkbox id, x = 0/1
+        Color      // target = vertex, x = 0xRRGGBB
+    };
+
+    enum Checkbox : uint8_t { ShowTriangle, CustomColors, GpuPicking };
+
+    uint64_t timeUs; // Since the recording started
+    Type type;
+    uint8_t target;
+    int32_t x, y;
+};
+
+// Input stream with timestamps, saved as a compact binary file: a header,
+// then per event a varint time delta, type, target and zigzag varint x/y
+// (a mouse move is usually 5-7 bytes).
+class InputRecording
+{
+public:
+    InputRecording();
+
+    void Start(); // Event times count from here
+    void Add(InputEvent::Type type, int target, int x, int y = 0);
+    void Add(const InputEvent& event); // Already timestamped, e.g. a scripted session
+    void Clear();
+
+    const std::vector<InputEvent>& GetEvents() const;
+    uint64_t GetDurationUs() const;
+
+    bool Save(const std::string& path) const;
+    bool Load(const std::string& path);
+
+private:
+    std::vector<InputEvent> m_events;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Headless side of a replay: does to a Renderer what GLCanvas and MainFrame
+// do for each event, without any UI
+class InputReplayer
+{
+public:
+    InputReplayer();
+
+    void Apply(const InputEvent& event, Renderer& renderer);
+
+    // Index of the first event at or after frameEndUs, searching from index;
+    // the events in between are the ones one frame applies
+    static size_t FrameEnd(const std::vector<InputEvent>& events, size_t index, uint64_t frameEndUs);
+
+private:
+    int m_hoveredButton; // -1 = none
+    bool m_gpuPicking;
+};
@@ -0,0 +1,240 @@
+#include "JobSystem.h"
+#include "Trace.h"
+#include <algorithm>
+
+struct JobSystem::Job
+{
+    std::function<void()> work;
+    std::atomic<int> pending; // Unfinished dependencies, plus one until scheduled
+    std::mutex mutex;         // Guards done and dependents
+    bool done;
+    std::vector<JobHandle> dependents;
+};
+
+namespace
+{
+// Which deque the current thread owns, if it is a worker of that system
+thread_local const JobSystem* t_system = nullptr;
+thread_local int t_queue = 0;
+}
+
+JobSystem::JobSystem(int threads)
+    : m_queued(0)
+    , m_executed(0), m_stolen(0)
+    , m_sleeping(0)
+    , m_stopping(false)
+{
+    if (threads <= 0)
+        threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    m_queues.reset(new Queue[threads]);
+    for (int queue = 1; queue < threads; ++queue)
+        m_threads.emplace_back(&JobSystem::WorkerLoop, this, queue);
+}
+
+JobSystem::~JobSystem()
+{
+    while (RunOne())
+        ;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+JobSystem& JobSystem::GetShared()
+{
+    static JobSystem shared;
+    return shared;
+}
+
+JobSystem::JobHandle JobSystem::Create(std::function<void()> work)
+{
+    JobHandle job = std::make_shared<Job>();
+    job->work = std::move(work);
+    job->pending = 1;
+    job->done = false;
+    return job;
+}
+
+JobSystem::JobHandle JobSystem::Schedule(std::function<void()> work, std::initializer_list<JobHandle> dependencies)
+{
+    JobHandle job = Create(std::move(work));
+    for (const JobHandle& dependency : dependencies)
+        AddDependency(job, dependency);
+    Release(job);
+    return job;
+}
+
+JobSystem::JobHandle JobSystem::Schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies)
+{
+    JobHandle job = Create(std::move(work));
+    for (const JobHandle& dependency : dependencies)
+        AddDependency(job, dependency);
+    Release(job);
+    return job;
+}
+
+void JobSystem::AddDependency(const JobHandle& job, const JobHandle& dependency)
+{
+    if (!dependency)
+        return;
+    std::lock_guard<std::mutex> lock(dependency->mutex);
+    if (dependency->done)
+        return;
+    job->pending.fetch_add(1, std::memory_order_relaxed);
+    dependency->dependents.push_back(job);
+}
+
+void JobSystem::Release(const JobHandle& job)
+{
+    if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        Push(job);
+}
+
+void JobSystem::Push(JobHandle job)
+{
+    Queue& queue = m_queues[GetQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    m_queued.fetch_add(1, std::memory_order_seq_cst);
+
+    // Taking the lock orders this against a worker checking m_queued before it sleeps
+    if (m_sleeping.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wake.notify_one();
+    }
+}
+
+int JobSystem::GetQueueIndex() const
+{
+    return t_system == this ? t_queue : 0;
+}
+
+bool JobSystem::RunOne()
+{
+    const int queues = GetThreadCount();
+    const int own = GetQueueIndex();
+    JobHandle job;
+    {
+        Queue& queue = m_queues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+    }
+    for (int i = 1; !job && i < queues; ++i)
+    {
+        Queue& queue = m_queues[(own + i) % queues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            m_stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!job)
+        return false;
+
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    Execute(job);
+    return true;
+}
+
+void JobSystem::Execute(const JobHandle& job)
+{
+    job->work();
+    job->work = nullptr; // Captures go now, not when the last handle does
+    m_executed.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<JobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done = true;
+        dependents.swap(job->dependents);
+    }
+    for (const JobHandle& dependent : dependents)
+        Release(dependent);
+}
+
+void JobSystem::Wait(const JobHandle& job)
+{
+    while (!IsDone(job))
+    {
+        if (!RunOne())
+            std::this_thread::yield();
+    }
+}
+
+bool JobSystem::IsDone(const JobHandle& job) const
+{
+    if (!job)
+        return true;
+    std::lock_guard<std::mutex> lock(job->mutex);
+    return job->done;
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body)
+{
+    grain = std::max<size_t>(1, grain);
+    if (count <= grain || m_threads.empty())
+    {
+        if (count > 0)
+            body(0, count);
+        return;
+    }
+
+    // Everything the jobs touch lives on this stack until remaining reaches zero
+    std::atomic<size_t> remaining(count);
+    std::function<void(size_t, size_t)> split = [&](size_t begin, size_t end)
+    {
+        while (end - begin > grain)
+        {
+            size_t middle = begin + (end - begin) / 2;
+            JobHandle right = Create([&split, middle, end]() { split(middle, end); });
+            Release(right);
+            end = middle;
+        }
+        body(begin, end);
+        remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+    };
+    split(0, count);
+
+    while (remaining.load(std::memory_order_acquire) != 0)
+    {
+        if (!RunOne())
+            std::this_thread::yield();
+    }
+}
+
+JobStats JobSystem::GetStats() const
+{
+    return JobStats{ m_executed.load(std::memory_order_relaxed), m_stolen.load(std::memory_order_relaxed) };
+}
+
+void JobSystem::WorkerLoop(int queue)
+{
+    TRACE_THREAD_NAME("JobSystem");
+    t_system = this;
+    t_queue = queue;
+    while (true)
+    {
+        if (RunOne())
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        m_wake.wait(lock, [this]() { return m_stopping || m_queued.load(std::memory_order_seq_cst) > 0; });
+        m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+        if (m_stopping && m_queued.load(std::memory_order_seq_cst) == 0)
+            return;
+    }
+}
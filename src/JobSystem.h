@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct JobStats
+{
+    size_t executed;
+    size_t stolen; // Taken from the front of another thread's deque
+};
+
+// Work-stealing scheduler for CPU-side frame work. Every worker has its own
+// deque: it pushes and pops at the back (newest first, still warm in cache)
+// while idle workers steal from the front, which holds the oldest and, for a
+// recursive ParallelFor, the biggest pieces. Threads that are not workers
+// share one more deque. Waiting threads run jobs instead of blocking, so
+// Wait() and ParallelFor() may be called from inside a job.
+class JobSystem
+{
+public:
+    struct Job;
+    typedef std::shared_ptr<Job> JobHandle;
+
+    explicit JobSystem(int threads = 0); // Total threads including the caller; 0 = one per hardware thread
+    ~JobSystem();                        // Runs every job that is ready before returning
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Queued once every dependency has finished. Any thread.
+    JobHandle Schedule(std::function<void()> work, std::initializer_list<JobHandle> dependencies = {});
+    JobHandle Schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies);
+    void Wait(const JobHandle& job);
+    bool IsDone(const JobHandle& job) const;
+
+    // body(begin, end) over [0, count), split in halves down to grain items;
+    // the caller keeps the left half and leaves the right one to be stolen
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body);
+
+    int GetThreadCount() const { return (int)m_threads.size() + 1; }
+    JobStats GetStats() const;
+
+    // Sized to the machine, for code that does not need its own
+    static JobSystem& GetShared();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    JobHandle Create(std::function<void()> work);
+    void AddDependency(const JobHandle& job, const JobHandle& dependency);
+    void Release(const JobHandle& job); // Drops one pending count, queues the job at zero
+    void Push(JobHandle job);
+    bool RunOne(); // One job from this thread's deque or stolen; false if there was none
+    void Execute(const JobHandle& job);
+    int GetQueueIndex() const;
+    void WorkerLoop(int queue);
+
+    std::vector<std::thread> m_threads;
+    std::unique_ptr<Queue[]> m_queues; // [0] for other threads, then one per worker
+    std::atomic<size_t> m_queued;      // Jobs sitting in any deque
+    std::atomic<size_t> m_executed, m_stolen;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<int> m_sleeping;
+    bool m_stopping;
+};
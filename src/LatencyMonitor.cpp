@@ -0,0 +1,209 @@
+#include <GL/glew.h>
+#include "LatencyMonitor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+// Upper bucket edges in ms; at 60 Hz one frame is 16.7 ms
+const double kBucketLimitsMs[LatencyMonitor::kBucketCount - 1] = { 2, 4, 8, 12, 16, 24, 33, 50, 67, 100, 200 };
+
+double Percentile(const std::vector<double>& sorted, double fraction)
+{
+    size_t index = std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+}
+
+LatencyMonitor::LatencyMonitor()
+    : m_nextFrame(0)
+    , m_historyNext(0)
+    , m_droppedFrames(0)
+{
+    for (Frame& frame : m_frames)
+    {
+        frame.fence = nullptr;
+        frame.swapTime = 0;
+    }
+    for (size_t& count : m_histogram)
+        count = 0;
+    m_history.reserve(kHistorySize);
+    m_swapHistory.reserve(kHistorySize);
+}
+
+LatencyMonitor::~LatencyMonitor()
+{
+    Release();
+}
+
+uint64_t LatencyMonitor::Now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LatencyMonitor::FramePresented(const std::vector<uint64_t>& inputTimes)
+{
+    if (inputTimes.empty())
+        return;
+
+    // A slot still in flight after kFramesInFlight frames is dropped, not waited on
+    Frame& frame = m_frames[m_nextFrame];
+    m_nextFrame = (m_nextFrame + 1) % kFramesInFlight;
+    if (frame.fence)
+    {
+        glDeleteSync((GLsync)frame.fence);
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        ++m_droppedFrames;
+    }
+
+    frame.swapTime = Now();
+    frame.inputTimes = inputTimes;
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush(); // The fence has to reach the GPU for it to ever signal
+}
+
+void LatencyMonitor::Collect()
+{
+    for (int i = 0; i < kFramesInFlight; ++i)
+    {
+        Frame& frame = m_frames[(m_nextFrame + i) % kFramesInFlight];
+        if (!frame.fence)
+            continue;
+
+        GLenum status = glClientWaitSync((GLsync)frame.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+        Resolve(frame, Now());
+    }
+}
+
+void LatencyMonitor::Resolve(Frame& frame, uint64_t completeTime)
+{
+    glDeleteSync((GLsync)frame.fence);
+    frame.fence = nullptr;
+
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    for (uint64_t inputTime : frame.inputTimes)
+    {
+        double ms = (completeTime - inputTime) / 1.0e6;
+        double swapMs = (frame.swapTime - inputTime) / 1.0e6;
+        if (m_history.size() < kHistorySize)
+        {
+            m_history.push_back(ms);
+            m_swapHistory.push_back(swapMs);
+        }
+        else
+        {
+            m_history[m_historyNext] = ms;
+            m_swapHistory[m_historyNext] = swapMs;
+        }
+        m_historyNext = (m_historyNext + 1) % kHistorySize;
+
+        int bucket = 0;
+        while (bucket < kBucketCount - 1 && ms > kBucketLimitsMs[bucket])
+            ++bucket;
+        ++m_histogram[bucket];
+    }
+}
+
+bool LatencyMonitor::HasPending() const
+{
+    for (const Frame& frame : m_frames)
+    {
+        if (frame.fence)
+            return true;
+    }
+    return false;
+}
+
+void LatencyMonitor::Release()
+{
+    for (Frame& frame : m_frames)
+    {
+        if (frame.fence)
+            glDeleteSync((GLsync)frame.fence);
+        frame.fence = nullptr;
+    }
+}
+
+LatencyStats LatencyMonitor::GetStats() const
+{
+    LatencyStats stats = { 0.0, 0.0, 0.0, 0.0, 0.0, 0 };
+    std::vector<double> sorted, swapSorted;
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        sorted = m_history;
+        swapSorted = m_swapHistory;
+    }
+    if (sorted.empty())
+        return stats;
+
+    std::sort(sorted.begin(), sorted.end());
+    std::sort(swapSorted.begin(), swapSorted.end());
+    stats.p50Ms = Percentile(sorted, 0.50);
+    stats.p95Ms = Percentile(sorted, 0.95);
+    stats.p99Ms = Percentile(sorted, 0.99);
+    stats.maxMs = sorted.back();
+    stats.swapP50Ms = Percentile(swapSorted, 0.50);
+    stats.samples = sorted.size();
+    return stats;
+}
+
+std::vector<size_t> LatencyMonitor::GetHistogram() const
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return std::vector<size_t>(m_histogram, m_histogram + kBucketCount);
+}
+
+double LatencyMonitor::GetBucketLimitMs(int bucket)
+{
+    return bucket >= 0 && bucket < kBucketCount - 1 ? kBucketLimitsMs[bucket] : 0.0;
+}
+
+std::string LatencyMonitor::FormatHistogram() const
+{
+    std::vector<size_t> histogram = GetHistogram();
+    size_t total = 0, largest = 0;
+    for (size_t count : histogram)
+    {
+        total += count;
+        largest = std::max(largest, count);
+    }
+
+    // One line per bucket, bar scaled to the fullest one
+    std::string text;
+    char line[96];
+    for (int bucket = 0; bucket < kBucketCount; ++bucket)
+    {
+        if (bucket < kBucketCount - 1)
+            std::snprintf(line, sizeof(line), "<= %3.0f ms %6zu ", kBucketLimitsMs[bucket], histogram[bucket]);
+        else
+            std::snprintf(line, sizeof(line), " > %3.0f ms %6zu ", kBucketLimitsMs[bucket - 1], histogram[bucket]);
+        text += line;
+        if (largest > 0)
+            text.append(histogram[bucket] * 40 / largest, '#');
+        text += '\n';
+    }
+    std::snprintf(line, sizeof(line), "%zu inputs", total);
+    text += line;
+    return text;
+}
+
+size_t LatencyMonitor::GetDroppedFrames() const
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_droppedFrames;
+}
+
+void LatencyMonitor::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_history.clear();
+    m_swapHistory.clear();
+    m_historyNext = 0;
+    for (size_t& count : m_histogram)
+        count = 0;
+    m_droppedFrames = 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct LatencyStats
+{
+    double p50Ms, p95Ms, p99Ms, maxMs; // Input to the GPU finishing the frame that showed it
+    double swapP50Ms;                  // Input to SwapBuffers returning
+    size_t samples;                    // 0 until the first fence signals
+};
+
+// Input-to-photon latency. Input events carry the time they reached the UI
+// thread; the frame that applied them puts a fence behind its SwapBuffers and
+// the latency is taken once the fence has signalled. Fences are polled, never
+// waited on, so measuring does not change what is measured.
+class LatencyMonitor
+{
+public:
+    static const int kFramesInFlight = 4;
+    static const size_t kHistorySize = 1000;
+    static const int kBucketCount = 12;
+
+    LatencyMonitor();
+    ~LatencyMonitor();
+
+    static uint64_t Now(); // Steady clock, nanoseconds; what input timestamps are taken with
+
+    // Render thread, context current
+    void FramePresented(const std::vector<uint64_t>& inputTimes); // Right after SwapBuffers
+    void Collect();
+    bool HasPending() const;
+    void Release();
+
+    // Any thread
+    LatencyStats GetStats() const;
+    std::vector<size_t> GetHistogram() const; // Counts since Reset(), buckets as in GetBucketLimitMs()
+    static double GetBucketLimitMs(int bucket); // Upper edge; the last bucket has none
+    std::string FormatHistogram() const;
+    size_t GetDroppedFrames() const;
+    void Reset();
+
+private:
+    struct Frame
+    {
+        void* fence; // GLsync
+        uint64_t swapTime;
+        std::vector<uint64_t> inputTimes;
+    };
+
+    void Resolve(Frame& frame, uint64_t completeTime);
+
+    Frame m_frames[kFramesInFlight];
+    int m_nextFrame;
+
+    mutable std::mutex m_statsMutex;
+    std::vector<double> m_history, m_swapHistory; // Rolling, for percentiles
+    size_t m_historyNext;
+    size_t m_histogram[kBucketCount];
+    size_t m_droppedFrames;
+};
@@ -1,32 +1,51 @@
 #include "MainFrame.h"
+#include "Trace.h"
 #include <wx/menu.h>
 #include <wx/msgdlg.h>
 #include <wx/statline.h>
+#include <algorithm>
+#include <cstdio>
 
 wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
     EVT_MENU(wxID_EXIT, MainFrame::OnExit)
+    EVT_MENU(ID_SAVE_TRACE, MainFrame::OnSaveTrace)
     EVT_SLIDER(ID_SLIDER, MainFrame::OnSliderChange)
     EVT_CHECKBOX(ID_CHECKBOX, MainFrame::OnCheckboxToggle)
     EVT_COLOURPICKER_CHANGED(ID_COLOR_PICKER_1, MainFrame::OnColorChanged1)
     EVT_COLOURPICKER_CHANGED(ID_COLOR_PICKER_2, MainFrame::OnColorChanged2)
     EVT_COLOURPICKER_CHANGED(ID_COLOR_PICKER_3, MainFrame::OnColorChanged3)
+    EVT_TIMER(ID_STATS_TIMER, MainFrame::OnStatsTimer)
+    EVT_TIMER(ID_REPLAY_TIMER, MainFrame::OnReplayTimer)
 wxEND_EVENT_TABLE()
 
 MainFrame::MainFrame()
     : wxFrame(nullptr, wxID_ANY, "OpenGL Application", wxDefaultPosition, wxSize(1000, 800)),
-      m_sidePanelVisible(false)
+      m_sidePanelVisible(false),
+      m_statsTimer(this, ID_STATS_TIMER),
+      m_rotationStatusPending(false),
+      m_replayIndex(0),
+      m_replayFrame(0),
+      m_replayRealtime(false),
+      m_replaySizeWarned(false),
+      m_replayTimer(this, ID_REPLAY_TIMER)
 {
     // Создать меню
     wxMenu* menuFile = new wxMenu;
     menuFile->Append(ID_Hello, "&Just click on triangle\t", "");
     menuFile->AppendSeparator();
+#ifdef ENABLE_TRACING
+    menuFile->Append(ID_SAVE_TRACE, "Save &Trace\tCtrl+T", "Write the CPU trace as Chrome trace JSON");
+    menuFile->AppendSeparator();
+#endif
     menuFile->Append(wxID_EXIT);
 
     wxMenuBar* menuBar = new wxMenuBar;
     menuBar->Append(menuFile, "&File");
     SetMenuBar(menuBar);
 
-    CreateStatusBar();
+    CreateStatusBar(2);
+    const int statusWidths[] = { -1, -2 };
+    SetStatusWidths(2, statusWidths);
     SetStatusText("Click the button to show/hide control panel");
 
     // Main panel
@@ -52,6 +71,18 @@ MainFrame::MainFrame()
     CreateSidePanel();
     
     m_mainPanel->Bind(wxEVT_SIZE, &MainFrame::OnMainPanelResize, this);
+    
+    m_statsTimer.Start(500);
+}
+
+MainFrame::~MainFrame()
+{
+    m_replayTimer.Stop();
+    if (m_recording)
+    {
+        m_glCanvas->SetInputRecording(nullptr);
+        m_recording->Save(m_recordingPath);
+    }
 }
 
 void MainFrame::CreateSidePanel()
@@ -128,35 +159,45 @@ void MainFrame::CreateSidePanel()
     panelSizer->Add(m_colorPicker3, 0, wxALL | wxEXPAND, 15);
 
     // Checkbox to apply user's colors
-    wxCheckBox* customColorCheckbox = new wxCheckBox(m_sidePanel, wxID_ANY, "Use Custom Colors");
-    customColorCheckbox->SetValue(false);
-    customColorCheckbox->SetForegroundColour(wxColour(255, 255, 255));
-    customColorCheckbox->Bind(wxEVT_COMMAND_CHECKBOX_CLICKED, 
-        [this, customColorCheckbox](wxCommandEvent& event) {
+    m_customColorCheckbox = new wxCheckBox(m_sidePanel, wxID_ANY, "Use Custom Colors");
+    m_customColorCheckbox->SetValue(false);
+    m_customColorCheckbox->SetForegroundColour(wxColour(255, 255, 255));
+    m_customColorCheckbox->Bind(wxEVT_COMMAND_CHECKBOX_CLICKED, &MainFrame::OnCustomColorToggle, this);
+
+    panelSizer->Add(m_customColorCheckbox, 0, wxALL, 15);
+
+    // Pick triangles on the GPU instead of through the CPU index
+    m_gpuPickingCheckbox = new wxCheckBox(m_sidePanel, wxID_ANY, "GPU Picking");
+    m_gpuPickingCheckbox->SetValue(false);
+    m_gpuPickingCheckbox->SetForegroundColour(wxColour(255, 255, 255));
+    m_gpuPickingCheckbox->Bind(wxEVT_COMMAND_CHECKBOX_CLICKED, &MainFrame::OnGpuPickingToggle, this);
+
+    panelSizer->Add(m_gpuPickingCheckbox, 0, wxALL, 15);
+
+    // Input-to-photon latency in the status bar; the histogram shows when it is turned off
+    wxCheckBox* latencyCheckbox = new wxCheckBox(m_sidePanel, wxID_ANY, "Measure Latency");
+    latencyCheckbox->SetValue(false);
+    latencyCheckbox->SetForegroundColour(wxColour(255, 255, 255));
+    latencyCheckbox->Bind(wxEVT_COMMAND_CHECKBOX_CLICKED,
+        [this, latencyCheckbox](wxCommandEvent& event) {
             if (m_glCanvas)
             {
-                bool useCustom = customColorCheckbox->GetValue();
-                m_glCanvas->SetUseCustomColor(useCustom);
-                
-                if (useCustom)
+                bool enabled = latencyCheckbox->GetValue();
+                m_glCanvas->SetLatencyMeasurement(enabled);
+                if (enabled)
+                {
+                    SetStatusText("Measuring input latency: move the slider or hover the button");
+                }
+                else
                 {
-                    for(int i = 0; i < 3; i++)
-                    {
-                        wxColourPickerCtrl* picker = (i == 0) ? m_colorPicker1 : 
-                                                   (i == 1) ? m_colorPicker2 : m_colorPicker3;
-                        wxColour color = picker->GetColour();
-                        float r = color.Red() / 255.0f;
-                        float g = color.Green() / 255.0f;
-                        float b = color.Blue() / 255.0f;
-                        m_glCanvas->SetVertexColor(i, r, g, b);
-                    }
+                    SetStatusText("Latency measurement stopped");
+                    wxMessageBox(m_glCanvas->GetLatencyHistogram(), "Input to photon latency",
+                                 wxOK | wxICON_INFORMATION, this);
                 }
-                
-                SetStatusText(useCustom ? "Using custom vertex colors" : "Using default vertex colors");
             }
         });
 
-    panelSizer->Add(customColorCheckbox, 0, wxALL, 15);
+    panelSizer->Add(latencyCheckbox, 0, wxALL, 15);
     
     m_sidePanel->SetSizer(panelSizer);
     m_sidePanel->Hide();
@@ -165,9 +206,11 @@ void MainFrame::CreateSidePanel()
 
 void MainFrame::OnColorChanged1(wxColourPickerEvent& event)
 {
+    TRACE_SCOPE("MainFrame::OnColorChanged1");
     if (m_glCanvas)
     {
         wxColour color = m_colorPicker1->GetColour();
+        RecordColor(0, color);
         float r = color.Red() / 255.0f;
         float g = color.Green() / 255.0f;
         float b = color.Blue() / 255.0f;
@@ -179,9 +222,11 @@ void MainFrame::OnColorChanged1(wxColourPickerEvent& event)
 
 void MainFrame::OnColorChanged2(wxColourPickerEvent& event)
 {
+    TRACE_SCOPE("MainFrame::OnColorChanged2");
     if (m_glCanvas)
     {
         wxColour color = m_colorPicker2->GetColour();
+        RecordColor(1, color);
         float r = color.Red() / 255.0f;
         float g = color.Green() / 255.0f;
         float b = color.Blue() / 255.0f;
@@ -193,9 +238,11 @@ void MainFrame::OnColorChanged2(wxColourPickerEvent& event)
 
 void MainFrame::OnColorChanged3(wxColourPickerEvent& event)
 {
+    TRACE_SCOPE("MainFrame::OnColorChanged3");
     if (m_glCanvas)
     {
         wxColour color = m_colorPicker3->GetColour();
+        RecordColor(2, color);
         float r = color.Red() / 255.0f;
         float g = color.Green() / 255.0f;
         float b = color.Blue() / 255.0f;
@@ -210,30 +257,245 @@ void MainFrame::OnExit(wxCommandEvent& event)
     Close(true);
 }
 
+void MainFrame::OnSaveTrace(wxCommandEvent& event)
+{
+    std::string path = Trace::GetDefaultPath();
+    if (Trace::WriteJson(path))
+        SetStatusText(wxString::Format("Trace with %zu spans written to %s", Trace::GetEventCount(), path));
+}
+
 void MainFrame::OnSliderChange(wxCommandEvent& event)
 {
+    TRACE_SCOPE("MainFrame::OnSliderChange");
     if (m_glCanvas)
     {
+        uint64_t inputTime = m_glCanvas->StampInput();
+        if (m_recording)
+            m_recording->Add(InputEvent::Slider, 0, m_rotationSlider->GetValue());
         float rotation = m_rotationSlider->GetValue();
-        m_glCanvas->SetRotation(rotation);
+        m_glCanvas->SetRotation(rotation, inputTime);
         
-        SetStatusText(wxString::Format("Triangle rotation: %.0f degrees", rotation));
+        if (!m_rotationStatusPending)
+        {
+            m_rotationStatusPending = true;
+            CallAfter(&MainFrame::UpdateRotationStatus);
+        }
     }
 }
 
+void MainFrame::UpdateRotationStatus()
+{
+    m_rotationStatusPending = false;
+    SetStatusText(wxString::Format("Triangle rotation: %d degrees", m_rotationSlider->GetValue()));
+}
+
 void MainFrame::OnCheckboxToggle(wxCommandEvent& event)
 {
+    TRACE_SCOPE("MainFrame::OnCheckboxToggle");
     if (m_glCanvas)
     {
         bool visible = m_visibilityCheckbox->GetValue();
+        if (m_recording)
+            m_recording->Add(InputEvent::Checkbox, InputEvent::ShowTriangle, visible ? 1 : 0);
         m_glCanvas->SetTriangleVisible(visible);
         
         SetStatusText(visible ? "Triangle is visible" : "Triangle is hidden");
     }
 }
 
+void MainFrame::OnCustomColorToggle(wxCommandEvent& event)
+{
+    TRACE_SCOPE("MainFrame::OnCustomColorToggle");
+    if (m_glCanvas)
+    {
+        bool useCustom = m_customColorCheckbox->GetValue();
+        if (m_recording)
+            m_recording->Add(InputEvent::Checkbox, InputEvent::CustomColors, useCustom ? 1 : 0);
+        m_glCanvas->SetUseCustomColor(useCustom);
+        
+        if (useCustom)
+        {
+            for(int i = 0; i < 3; i++)
+            {
+                wxColourPickerCtrl* picker = (i == 0) ? m_colorPicker1 : 
+                                           (i == 1) ? m_colorPicker2 : m_colorPicker3;
+                wxColour color = picker->GetColour();
+                float r = color.Red() / 255.0f;
+                float g = color.Green() / 255.0f;
+                float b = color.Blue() / 255.0f;
+                m_glCanvas->SetVertexColor(i, r, g, b);
+            }
+        }
+        
+        SetStatusText(useCustom ? "Using custom vertex colors" : "Using default vertex colors");
+    }
+}
+
+void MainFrame::OnGpuPickingToggle(wxCommandEvent& event)
+{
+    TRACE_SCOPE("MainFrame::OnGpuPickingToggle");
+    if (m_glCanvas)
+    {
+        bool enabled = m_gpuPickingCheckbox->GetValue();
+        if (m_recording)
+            m_recording->Add(InputEvent::Checkbox, InputEvent::GpuPicking, enabled ? 1 : 0);
+        m_glCanvas->SetGpuPicking(enabled);
+        SetStatusText(enabled ? "Picking triangles on the GPU" : "Picking triangles on the CPU");
+    }
+}
+
+void MainFrame::RecordColor(int vertex, const wxColour& color)
+{
+    if (m_recording)
+        m_recording->Add(InputEvent::Color, vertex, (color.Red() << 16) | (color.Green() << 8) | color.Blue());
+}
+
+bool MainFrame::StartRecording(const std::string& path)
+{
+    m_recording.reset(new InputRecording());
+    m_recordingPath = path;
+    m_recording->Start();
+    m_glCanvas->SetInputRecording(m_recording.get());
+    SetStatusText(wxString::Format("Recording input to %s", path));
+    return true;
+}
+
+bool MainFrame::StartCapture(const std::string& path)
+{
+    return m_glCanvas->SetCaptureFile(path);
+}
+
+bool MainFrame::StartReplay(const std::string& path, bool realtime)
+{
+    if (!m_replay.Load(path))
+        return false;
+
+    m_replayIndex = 0;
+    m_replayFrame = 0;
+    m_replayRealtime = realtime;
+    m_replaySizeWarned = false;
+
+    // Let the first frame and the icon atlas settle before the clock starts
+    m_replayTimer.StartOnce(500);
+    SetStatusText(wxString::Format("Replaying %zu events from %s", m_replay.GetEvents().size(), path));
+    return true;
+}
+
+void MainFrame::OnReplayTimer(wxTimerEvent& event)
+{
+    const uint64_t kFrameUs = 1000000 / 60;
+    const std::vector<InputEvent>& events = m_replay.GetEvents();
+    if (m_replayFrame == 0)
+    {
+        m_glCanvas->ResetFrameTimeStats();
+        m_replayStart = std::chrono::steady_clock::now();
+    }
+
+    // One recorded frame's worth of events per tick, so both modes hand the
+    // renderer the same batches
+    ++m_replayFrame;
+    size_t end = InputReplayer::FrameEnd(events, m_replayIndex, m_replayFrame * kFrameUs);
+    for (; m_replayIndex < end; ++m_replayIndex)
+        ApplyInput(events[m_replayIndex]);
+
+    if (m_replayIndex >= events.size())
+    {
+        FinishReplay();
+        return;
+    }
+
+    int delayMs = 1;
+    if (m_replayRealtime)
+    {
+        auto due = m_replayStart + std::chrono::microseconds(m_replayFrame * kFrameUs);
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now());
+        delayMs = std::max(1, (int)wait.count());
+    }
+    m_replayTimer.StartOnce(delayMs);
+}
+
+void MainFrame::ApplyInput(const InputEvent& event)
+{
+    // Widgets are updated too, so the panel shows what the replay did
+    wxCommandEvent command;
+    switch (event.type)
+    {
+        case InputEvent::Resize:
+            if (!m_replaySizeWarned && m_glCanvas->GetCanvasSize().GetWidth() != event.x)
+            {
+                wxLogWarning("Recorded with a %dx%d canvas, replaying on %dx%d; pointer positions will not match",
+                             event.x, event.y, m_glCanvas->GetCanvasSize().GetWidth(), m_glCanvas->GetCanvasSize().GetHeight());
+                m_replaySizeWarned = true;
+            }
+            break;
+        case InputEvent::MouseMove:
+            m_glCanvas->SimulateMouseMove(event.x, event.y);
+            break;
+        case InputEvent::MouseDown:
+            m_glCanvas->SimulateMouseDown(event.x, event.y);
+            break;
+        case InputEvent::Slider:
+            m_rotationSlider->SetValue(event.x);
+            OnSliderChange(command);
+            break;
+        case InputEvent::Checkbox:
+            if (event.target == InputEvent::ShowTriangle)
+            {
+                m_visibilityCheckbox->SetValue(event.x != 0);
+                OnCheckboxToggle(command);
+            }
+            else if (event.target == InputEvent::CustomColors)
+            {
+                m_customColorCheckbox->SetValue(event.x != 0);
+                OnCustomColorToggle(command);
+            }
+            else if (event.target == InputEvent::GpuPicking)
+            {
+                m_gpuPickingCheckbox->SetValue(event.x != 0);
+                OnGpuPickingToggle(command);
+            }
+            break;
+        case InputEvent::Color:
+        {
+            wxColour color((event.x >> 16) & 0xFF, (event.x >> 8) & 0xFF, event.x & 0xFF);
+            wxColourPickerEvent colorEvent;
+            if (event.target == 0)
+            {
+                m_colorPicker1->SetColour(color);
+                OnColorChanged1(colorEvent);
+            }
+            else if (event.target == 1)
+            {
+                m_colorPicker2->SetColour(color);
+                OnColorChanged2(colorEvent);
+            }
+            else if (event.target == 2)
+            {
+                m_colorPicker3->SetColour(color);
+                OnColorChanged3(colorEvent);
+            }
+            break;
+        }
+    }
+}
+
+void MainFrame::FinishReplay()
+{
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_replayStart).count();
+    PassTimingStats stats = m_glCanvas->GetFrameTimeStats();
+    unsigned long frames = m_glCanvas->GetFrameCount();
+
+    // stdout too, for scripted runs
+    std::printf("replay: %zu events, %lu frames in %.2f s, frame ms min/avg/p99 %.2f/%.2f/%.2f\n",
+                m_replay.GetEvents().size(), frames, seconds, stats.minMs, stats.avgMs, stats.p99Ms);
+    std::fflush(stdout);
+    SetStatusText(wxString::Format("Replay done: %lu frames in %.2f s, frame ms min/avg/p99 %.2f/%.2f/%.2f",
+                                   frames, seconds, stats.minMs, stats.avgMs, stats.p99Ms));
+}
+
 void MainFrame::OnToggleSidePanel()
 {
+    TRACE_SCOPE("MainFrame::OnToggleSidePanel");
     m_sidePanelVisible = !m_sidePanelVisible;
     
     if (m_sidePanelVisible)
@@ -252,6 +514,7 @@ void MainFrame::OnToggleSidePanel()
 
 void MainFrame::OnMainPanelResize(wxSizeEvent& event)
 {
+    TRACE_SCOPE("MainFrame::OnMainPanelResize");
     if (m_sidePanelVisible)
     {
         PositionSidePanel();
@@ -259,6 +522,35 @@ void MainFrame::OnMainPanelResize(wxSizeEvent& event)
     event.Skip();
 }
 
+void MainFrame::OnStatsTimer(wxTimerEvent& event)
+{
+    TRACE_SCOPE("MainFrame::OnStatsTimer");
+    if (!m_glCanvas)
+        return;
+
+    if (m_glCanvas->IsMeasuringLatency())
+    {
+        LatencyStats stats = m_glCanvas->GetLatencyStats();
+        SetStatusText(wxString::Format("Input latency ms (p50/p95/p99/max) %.1f/%.1f/%.1f/%.1f, to swap %.1f, %zu inputs",
+                                       stats.p50Ms, stats.p95Ms, stats.p99Ms, stats.maxMs,
+                                       stats.swapP50Ms, stats.samples), 1);
+        return;
+    }
+
+    // min/avg/p99 over the rolling window, in ms
+    wxString text = "GPU ms (min/avg/p99)";
+    const RenderPass passes[] = { RenderPass::Triangle, RenderPass::Button, RenderPass::Swap };
+    for (RenderPass pass : passes)
+    {
+        PassTimingStats stats = m_glCanvas->GetPassTimings(pass);
+        if (stats.samples == 0)
+            continue;
+        text += wxString::Format("  %s %.2f/%.2f/%.2f", GpuProfiler::GetPassName(pass),
+                                 stats.minMs, stats.avgMs, stats.p99Ms);
+    }
+    SetStatusText(text, 1);
+}
+
 void MainFrame::PositionSidePanel()
 {
     if (!m_sidePanel) return;
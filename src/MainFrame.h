@@ -4,7 +4,12 @@
 #include <wx/slider.h>
 #include <wx/checkbox.h>
 #include <wx/clrpicker.h>
+#include <wx/timer.h>
+#include <chrono>
+#include <memory>
+#include <string>
 #include "GLCanvas.h"
+#include "InputRecording.h"
 
 enum
 {
@@ -13,19 +18,32 @@ enum
     ID_CHECKBOX = 3,
     ID_COLOR_PICKER_1 = 4,
     ID_COLOR_PICKER_2 = 5,
-    ID_COLOR_PICKER_3 = 6
+    ID_COLOR_PICKER_3 = 6,
+    ID_STATS_TIMER = 7,
+    ID_SAVE_TRACE = 8,
+    ID_REPLAY_TIMER = 9
 };
 
 class MainFrame : public wxFrame
 {
 public:
     MainFrame();
+    ~MainFrame();
+
+    // Input record/replay for repeatable performance runs; the recording is
+    // written when the window closes, a replay reports frame times at its end
+    bool StartRecording(const std::string& path);
+    bool StartReplay(const std::string& path, bool realtime);
+    bool StartCapture(const std::string& path); // Before Show()
 
 private:
     void OnExit(wxCommandEvent& event);
+    void OnSaveTrace(wxCommandEvent& event);
     void OnAbout(wxCommandEvent& event);
     void OnSliderChange(wxCommandEvent& event);
     void OnCheckboxToggle(wxCommandEvent& event);
+    void OnCustomColorToggle(wxCommandEvent& event);
+    void OnGpuPickingToggle(wxCommandEvent& event);
     void OnColorChanged1(wxColourPickerEvent& event);
     void OnColorChanged2(wxColourPickerEvent& event);
     void OnColorChanged3(wxColourPickerEvent& event);
@@ -33,6 +51,12 @@ private:
     void OnToggleSidePanel();
     void OnMainPanelResize(wxSizeEvent& event);
     void PositionSidePanel();
+    void OnStatsTimer(wxTimerEvent& event);
+    void UpdateRotationStatus();
+    void RecordColor(int vertex, const wxColour& color);
+    void OnReplayTimer(wxTimerEvent& event);
+    void ApplyInput(const InputEvent& event);
+    void FinishReplay();
 
     // UI
     wxPanel* m_mainPanel;
@@ -43,11 +67,30 @@ private:
     // Side panel
     wxSlider* m_rotationSlider;
     wxCheckBox* m_visibilityCheckbox;
+    wxCheckBox* m_customColorCheckbox;
+    wxCheckBox* m_gpuPickingCheckbox;
     wxColourPickerCtrl* m_colorPicker1;
     wxColourPickerCtrl* m_colorPicker2;
     wxColourPickerCtrl* m_colorPicker3;
     bool m_sidePanelVisible;
 
+    // GPU pass timings in the status bar
+    wxTimer m_statsTimer;
+
+    // Slider ticks arrive in bursts; the status text is formatted once per burst
+    bool m_rotationStatusPending;
+
+    // Record/replay
+    std::unique_ptr<InputRecording> m_recording;
+    std::string m_recordingPath;
+    InputRecording m_replay;
+    size_t m_replayIndex;
+    unsigned long m_replayFrame; // Recorded events are applied in 60 Hz frame batches
+    bool m_replayRealtime;
+    bool m_replaySizeWarned;
+    std::chrono::steady_clock::time_point m_replayStart;
+    wxTimer m_replayTimer;
+
     wxDECLARE_EVENT_TABLE();
 };
 
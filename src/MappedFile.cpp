@@ -0,0 +1,132 @@
+#include "MappedFile.h"
+#include <wx/log.h>
+#include <algorithm>
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPEDFILE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef MAPPEDFILE_MMAP
+// madvise wants page-aligned starts; widen the range down to the page
+void Advise(const unsigned char* data, size_t fileSize, size_t offset, size_t size, int advice)
+{
+    if (offset >= fileSize)
+        return;
+    size = std::min(size, fileSize - offset);
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = offset / page * page;
+    madvise((void*)(data + begin), size + (offset - begin), advice);
+}
+#endif
+}
+
+MappedFile::MappedFile()
+    : m_data(nullptr), m_size(0), m_mapped(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+#ifdef MAPPEDFILE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        wxLogError("Cannot open %s", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        wxLogError("Cannot read %s", path);
+        return false;
+    }
+
+    m_size = (size_t)info.st_size;
+    if (m_size == 0)
+    {
+        // mmap refuses empty files; an empty buffer still counts as open
+        close(fd);
+        m_buffer.assign(1, 0);
+        m_data = m_buffer.data();
+        return true;
+    }
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (data == MAP_FAILED)
+    {
+        m_size = 0;
+        wxLogError("Cannot map %s", path);
+        return false;
+    }
+    m_data = (const unsigned char*)data;
+    m_mapped = true;
+    return true;
+#else
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        wxLogError("Cannot open %s", path);
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    m_buffer.resize(size > 0 ? (size_t)size : 1);
+    bool ok = size >= 0 && std::fread(m_buffer.data(), 1, (size_t)size, file) == (size_t)size;
+    std::fclose(file);
+    if (!ok)
+    {
+        m_buffer.clear();
+        wxLogError("Cannot read %s", path);
+        return false;
+    }
+    m_size = (size_t)size;
+    m_data = m_buffer.data();
+    return true;
+#endif
+}
+
+void MappedFile::Close()
+{
+#ifdef MAPPEDFILE_MMAP
+    if (m_mapped)
+        munmap((void*)m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+}
+
+void MappedFile::AdviseSequential(size_t offset, size_t size) const
+{
+#ifdef MAPPEDFILE_MMAP
+    if (m_mapped)
+        Advise(m_data, m_size, offset, size, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::Release(size_t offset, size_t size) const
+{
+#ifdef MAPPEDFILE_MMAP
+    if (m_mapped)
+        Advise(m_data, m_size, offset, size, MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Memory-mapped where the platform allows, so
+// pages are read in on first touch and belong to the page cache rather than
+// the heap; elsewhere the file is read into memory once.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+    const unsigned char* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+    bool IsMapped() const { return m_mapped; }
+
+    // Access hints for [offset, offset + size); no-ops without a mapping.
+    // Sequential: read ahead aggressively. Release: the range will not be read
+    // again, drop its pages from this process (they stay in the page cache).
+    void AdviseSequential(size_t offset, size_t size) const;
+    void Release(size_t offset, size_t size) const;
+
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+    bool m_mapped;
+    std::vector<unsigned char> m_buffer; // Fallback when the file is not mapped
+};
@@ -0,0 +1,1203 @@
+#include "MeshLoader.h"
+#include "JobSystem.h"
+#include "Trace.h"
+#include <wx/log.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+
+namespace
+{
+// Text is cut into about four chunks per thread, none smaller than this
+const size_t kMinChunkBytes = 1 << 20;
+// Binary PLY records per ParallelFor piece
+const size_t kRecordGrain = 1 << 16;
+
+struct TextRange
+{
+    const char* begin;
+    const char* end;
+};
+
+struct BoundsAccumulator
+{
+    float min[3], max[3];
+
+    BoundsAccumulator()
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::numeric_limits<float>::max();
+            max[axis] = -std::numeric_limits<float>::max();
+        }
+    }
+
+    void Add(const float* position)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(min[axis], position[axis]);
+            max[axis] = std::max(max[axis], position[axis]);
+        }
+    }
+
+    bool IsEmpty() const { return min[0] > max[0]; }
+
+    void Add(const BoundsAccumulator& other)
+    {
+        if (other.IsEmpty())
+            return;
+        Add(other.min);
+        Add(other.max);
+    }
+
+    // An empty mesh gets zero bounds rather than inverted ones
+    void Store(float* boundsMin, float* boundsMax) const
+    {
+        bool empty = IsEmpty();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            boundsMin[axis] = empty ? 0.0f : min[axis];
+            boundsMax[axis] = empty ? 0.0f : max[axis];
+        }
+    }
+};
+
+size_t ChunkCount(size_t bytes, JobSystem* jobs)
+{
+    size_t threads = jobs ? (size_t)jobs->GetThreadCount() : 1;
+    return std::max<size_t>(1, std::min(threads * 4, bytes / kMinChunkBytes));
+}
+
+// About count pieces of [begin, end), each one ending just after a newline
+std::vector<TextRange> SplitLines(const char* begin, const char* end, size_t count)
+{
+    std::vector<TextRange> ranges;
+    const size_t step = std::max<size_t>(1, (size_t)(end - begin) / count);
+    const char* start = begin;
+    while (start < end)
+    {
+        const char* cut = (size_t)(end - start) > step ? start + step : end;
+        if (cut < end)
+        {
+            const char* newline = (const char*)std::memchr(cut, '\n', end - cut);
+            cut = newline ? newline + 1 : end;
+        }
+        ranges.push_back(TextRange{ start, cut });
+        start = cut;
+    }
+    return ranges;
+}
+
+void ForEachChunk(size_t count, JobSystem* jobs, const std::function<void(size_t)>& body)
+{
+    if (!jobs)
+    {
+        for (size_t i = 0; i < count; ++i)
+            body(i);
+        return;
+    }
+    jobs->ParallelFor(count, 1, [&body](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            body(i);
+    });
+}
+
+inline bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && IsSpace(*p))
+        ++p;
+    return p;
+}
+
+inline const char* SkipToken(const char* p, const char* end)
+{
+    while (p < end && !IsSpace(*p))
+        ++p;
+    return p;
+}
+
+// Line starting at p: returns its end (without the newline) and where the next one starts
+inline const char* LineEnd(const char* p, const char* end, const char*& next)
+{
+    const char* newline = (const char*)std::memchr(p, '\n', end - p);
+    next = newline ? newline + 1 : end;
+    return newline ? newline : end;
+}
+
+inline bool ParseFloat(const char*& p, const char* end, float& value)
+{
+    p = SkipSpaces(p, end);
+    if (p < end && *p == '+')
+        ++p;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec == std::errc::result_out_of_range)
+        value = 0.0f; // Denormal or huge; nothing a vertex can use either way
+    else if (result.ec != std::errc())
+        return false;
+    p = result.ptr;
+    return true;
+}
+
+inline bool ParseInt(const char*& p, const char* end, int64_t& value)
+{
+    p = SkipSpaces(p, end);
+    if (p < end && *p == '+')
+        ++p;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc())
+        return false;
+    p = result.ptr;
+    return true;
+}
+
+size_t LineNumber(const char* data, const char* at)
+{
+    return (size_t)std::count(data, at, '\n') + 1;
+}
+
+// ---- OBJ ----
+
+struct ObjChunk
+{
+    TextRange range;
+    size_t vertices, triangles;
+    size_t vertexBase, triangleBase;
+    BoundsAccumulator bounds;
+    const char* error; // Line that failed to parse
+};
+
+inline bool IsObjStatement(const char* p, const char* lineEnd, char kind)
+{
+    return lineEnd - p >= 2 && p[0] == kind && IsSpace(p[1]);
+}
+
+void CountObj(ObjChunk& chunk)
+{
+    const char* next;
+    for (const char* p = chunk.range.begin; p < chunk.range.end; p = next)
+    {
+        const char* lineEnd = LineEnd(p, chunk.range.end, next);
+        p = SkipSpaces(p, lineEnd);
+        if (IsObjStatement(p, lineEnd, 'v'))
+        {
+            ++chunk.vertices;
+        }
+        else if (IsObjStatement(p, lineEnd, 'f'))
+        {
+            size_t corners = 0;
+            for (const char* q = SkipSpaces(p + 1, lineEnd); q < lineEnd; q = SkipSpaces(SkipToken(q, lineEnd), lineEnd))
+                ++corners;
+            if (corners >= 3)
+                chunk.triangles += corners - 2;
+        }
+    }
+}
+
+void ParseObj(ObjChunk& chunk, size_t totalVertices, float* positions, uint32_t* indices)
+{
+    float* position = positions + chunk.vertexBase * 3;
+    uint32_t* index = indices + chunk.triangleBase * 3;
+    size_t vertex = chunk.vertexBase; // Vertices declared before the current line, for negative indices
+
+    const char* next;
+    for (const char* p = chunk.range.begin; p < chunk.range.end; p = next)
+    {
+        const char* line = p;
+        const char* lineEnd = LineEnd(p, chunk.range.end, next);
+        p = SkipSpaces(p, lineEnd);
+        if (IsObjStatement(p, lineEnd, 'v'))
+        {
+            p += 1;
+            if (!ParseFloat(p, lineEnd, position[0]) || !ParseFloat(p, lineEnd, position[1]) || !ParseFloat(p, lineEnd, position[2]))
+            {
+                chunk.error = line;
+                return;
+            }
+            chunk.bounds.Add(position);
+            position += 3;
+            ++vertex;
+        }
+        else if (IsObjStatement(p, lineEnd, 'f'))
+        {
+            // Polygons as fans around the first corner
+            uint32_t first = 0, previous = 0;
+            size_t corner = 0;
+            for (p = SkipSpaces(p + 1, lineEnd); p < lineEnd; p = SkipSpaces(p, lineEnd), ++corner)
+            {
+                int64_t value;
+                if (!ParseInt(p, lineEnd, value))
+                {
+                    chunk.error = line;
+                    return;
+                }
+                p = SkipToken(p, lineEnd); // Texture and normal indices are not used
+                int64_t absolute = value > 0 ? value - 1 : (int64_t)vertex + value;
+                if (value == 0 || absolute < 0 || absolute >= (int64_t)totalVertices)
+                {
+                    chunk.error = line;
+                    return;
+                }
+                uint32_t current = (uint32_t)absolute;
+                if (corner == 0)
+                    first = current;
+                if (corner >= 2)
+                {
+                    index[0] = first;
+                    index[1] = previous;
+                    index[2] = current;
+                    index += 3;
+                }
+                previous = current;
+            }
+        }
+    }
+}
+
+// ---- PLY ----
+
+enum class PlyType { Int8, Uint8, Int16, Uint16, Int32, Uint32, Float32, Float64 };
+enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type;      // Of the items, for a list
+    bool isList;
+    PlyType countType;
+    size_t offset;     // Within the record; only up to the first list
+};
+
+struct PlyElement
+{
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+    size_t recordSize; // 0 when the element has lists
+};
+
+struct PlyHeader
+{
+    PlyFormat format;
+    std::vector<PlyElement> elements;
+    size_t bodyOffset;
+};
+
+size_t PlyTypeSize(PlyType type)
+{
+    switch (type)
+    {
+        case PlyType::Int8: case PlyType::Uint8: return 1;
+        case PlyType::Int16: case PlyType::Uint16: return 2;
+        case PlyType::Int32: case PlyType::Uint32: case PlyType::Float32: return 4;
+        case PlyType::Float64: return 8;
+    }
+    return 0;
+}
+
+bool ParsePlyType(const std::string& name, PlyType& type)
+{
+    static const struct { const char* name; PlyType type; } names[] = {
+        { "char", PlyType::Int8 }, { "int8", PlyType::Int8 },
+        { "uchar", PlyType::Uint8 }, { "uint8", PlyType::Uint8 },
+        { "short", PlyType::Int16 }, { "int16", PlyType::Int16 },
+        { "ushort", PlyType::Uint16 }, { "uint16", PlyType::Uint16 },
+        { "int", PlyType::Int32 }, { "int32", PlyType::Int32 },
+        { "uint", PlyType::Uint32 }, { "uint32", PlyType::Uint32 },
+        { "float", PlyType::Float32 }, { "float32", PlyType::Float32 },
+        { "double", PlyType::Float64 }, { "float64", PlyType::Float64 },
+    };
+    for (const auto& entry : names)
+    {
+        if (name == entry.name)
+        {
+            type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParsePlyHeader(const char* data, size_t size, PlyHeader& header, std::string& error)
+{
+    const char* end = data + size;
+    const char* next;
+    const char* p = data;
+    size_t lineNumber = 0;
+    bool sawFormat = false;
+    while (p < end)
+    {
+        const char* lineEnd = LineEnd(p, end, next);
+        std::vector<std::string> tokens;
+        for (const char* q = SkipSpaces(p, lineEnd); q < lineEnd; q = SkipSpaces(q, lineEnd))
+        {
+            const char* tokenEnd = SkipToken(q, lineEnd);
+            tokens.emplace_back(q, tokenEnd);
+            q = tokenEnd;
+        }
+        p = next;
+        ++lineNumber;
+
+        if (lineNumber == 1)
+        {
+            if (tokens.size() != 1 || tokens[0] != "ply")
+            {
+                error = "not a PLY file";
+                return false;
+            }
+            continue;
+        }
+        if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info")
+            continue;
+
+        if (tokens[0] == "end_header")
+        {
+            header.bodyOffset = (size_t)(p - data);
+            if (!sawFormat)
+            {
+                error = "no format line";
+                return false;
+            }
+            return true;
+        }
+        if (tokens[0] == "format" && tokens.size() >= 2)
+        {
+            if (tokens[1] == "ascii") header.format = PlyFormat::Ascii;
+            else if (tokens[1] == "binary_little_endian") header.format = PlyFormat::BinaryLittleEndian;
+            else if (tokens[1] == "binary_big_endian") header.format = PlyFormat::BinaryBigEndian;
+            else
+            {
+                error = "unknown format " + tokens[1];
+                return false;
+            }
+            sawFormat = true;
+        }
+        else if (tokens[0] == "element" && tokens.size() == 3)
+        {
+            PlyElement element;
+            element.name = tokens[1];
+            element.count = (size_t)std::strtoull(tokens[2].c_str(), nullptr, 10);
+            element.recordSize = 0;
+            header.elements.push_back(element);
+        }
+        else if (tokens[0] == "property" && !header.elements.empty())
+        {
+            PlyProperty property = {};
+            bool ok;
+            if (tokens.size() == 5 && tokens[1] == "list")
+            {
+                property.isList = true;
+                property.name = tokens[4];
+                ok = ParsePlyType(tokens[2], property.countType) && ParsePlyType(tokens[3], property.type);
+            }
+            else
+            {
+                property.name = tokens.size() == 3 ? tokens[2] : std::string();
+                ok = tokens.size() == 3 && ParsePlyType(tokens[1], property.type);
+            }
+            if (!ok)
+            {
+                error = "bad property on line " + std::to_string(lineNumber);
+                return false;
+            }
+            header.elements.back().properties.push_back(property);
+        }
+        else
+        {
+            error = "unexpected header line " + std::to_string(lineNumber);
+            return false;
+        }
+    }
+    error = "no end_header";
+    return false;
+}
+
+// Offsets of the fixed-size properties up to the first list; recordSize when there is no list
+void LayoutPlyElement(PlyElement& element)
+{
+    size_t offset = 0;
+    for (PlyProperty& property : element.properties)
+    {
+        property.offset = offset;
+        if (property.isList)
+        {
+            element.recordSize = 0;
+            return;
+        }
+        offset += PlyTypeSize(property.type);
+    }
+    element.recordSize = offset;
+}
+
+int FindPlyProperty(const PlyElement& element, const char* name)
+{
+    for (size_t i = 0; i < element.properties.size(); ++i)
+    {
+        if (element.properties[i].name == name)
+            return (int)i;
+    }
+    return -1;
+}
+
+template <typename T>
+inline T ReadRaw(const unsigned char* p, bool swap)
+{
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if (swap)
+        std::reverse(bytes, bytes + sizeof(T));
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+inline double ReadPlyValue(const unsigned char* p, PlyType type, bool swap)
+{
+    switch (type)
+    {
+        case PlyType::Int8: return (double)(int8_t)*p;
+        case PlyType::Uint8: return (double)*p;
+        case PlyType::Int16: return (double)ReadRaw<int16_t>(p, swap);
+        case PlyType::Uint16: return (double)ReadRaw<uint16_t>(p, swap);
+        case PlyType::Int32: return (double)ReadRaw<int32_t>(p, swap);
+        case PlyType::Uint32: return (double)ReadRaw<uint32_t>(p, swap);
+        case PlyType::Float32: return (double)ReadRaw<float>(p, swap);
+        case PlyType::Float64: return ReadRaw<double>(p, swap);
+    }
+    return 0.0;
+}
+
+inline int64_t ReadPlyInt(const unsigned char* p, PlyType type, bool swap)
+{
+    switch (type)
+    {
+        case PlyType::Int8: return (int8_t)*p;
+        case PlyType::Uint8: return *p;
+        case PlyType::Int16: return ReadRaw<int16_t>(p, swap);
+        case PlyType::Uint16: return ReadRaw<uint16_t>(p, swap);
+        case PlyType::Int32: return ReadRaw<int32_t>(p, swap);
+        case PlyType::Uint32: return ReadRaw<uint32_t>(p, swap);
+        case PlyType::Float32: return (int64_t)ReadRaw<float>(p, swap);
+        case PlyType::Float64: return (int64_t)ReadRaw<double>(p, swap);
+    }
+    return 0;
+}
+
+// Size of one record with lists at p, 0 if it runs past end
+size_t PlyRecordSize(const PlyElement& element, const unsigned char* p, const unsigned char* end, bool swap)
+{
+    const unsigned char* start = p;
+    for (const PlyProperty& property : element.properties)
+    {
+        if (property.isList)
+        {
+            size_t countSize = PlyTypeSize(property.countType);
+            if ((size_t)(end - p) < countSize)
+                return 0;
+            int64_t count = ReadPlyInt(p, property.countType, swap);
+            p += countSize;
+            if (count < 0 || (size_t)(end - p) / PlyTypeSize(property.type) < (size_t)count)
+                return 0;
+            p += (size_t)count * PlyTypeSize(property.type);
+        }
+        else
+        {
+            size_t size = PlyTypeSize(property.type);
+            if ((size_t)(end - p) < size)
+                return 0;
+            p += size;
+        }
+    }
+    return (size_t)(p - start);
+}
+
+class PlyReader
+{
+public:
+    PlyReader(const MappedFile& file, PlyHeader& header, MeshData& mesh, JobSystem* jobs)
+        : m_data((const char*)file.GetData()), m_size(file.GetSize())
+        , m_header(header), m_mesh(mesh), m_jobs(jobs)
+        , m_swap(header.format == PlyFormat::BinaryBigEndian)
+        , m_vertices(nullptr), m_faces(nullptr)
+        , m_xyz{ -1, -1, -1 }, m_faceList(-1)
+    {
+    }
+
+    bool Read(std::string& error);
+
+private:
+    bool ReadBinary(std::string& error);
+    bool ReadAscii(std::string& error);
+    void ReadBinaryVertices(const unsigned char* records);
+    bool ReadBinaryFaces(const unsigned char* records, const unsigned char* end, size_t& size, std::string& error);
+    bool SkipAsciiProperty(const char*& p, const char* lineEnd, const PlyProperty& property) const;
+
+    const char* m_data;
+    size_t m_size;
+    PlyHeader& m_header;
+    MeshData& m_mesh;
+    JobSystem* m_jobs;
+    bool m_swap;
+    const PlyElement* m_vertices;
+    const PlyElement* m_faces;
+    int m_xyz[3];
+    int m_faceList;
+    BoundsAccumulator m_bounds;
+    std::mutex m_boundsMutex;
+};
+
+bool PlyReader::Read(std::string& error)
+{
+    for (PlyElement& element : m_header.elements)
+    {
+        LayoutPlyElement(element);
+        if (element.name == "vertex")
+            m_vertices = &element;
+        else if (element.name == "face")
+            m_faces = &element;
+    }
+    if (!m_vertices)
+    {
+        error = "no vertex element";
+        return false;
+    }
+
+    const char* axes[3] = { "x", "y", "z" };
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_xyz[axis] = FindPlyProperty(*m_vertices, axes[axis]);
+        if (m_xyz[axis] < 0 || m_vertices->properties[m_xyz[axis]].isList)
+        {
+            error = std::string("vertex has no ") + axes[axis];
+            return false;
+        }
+    }
+    if (m_faces)
+    {
+        m_faceList = FindPlyProperty(*m_faces, "vertex_indices");
+        if (m_faceList < 0)
+            m_faceList = FindPlyProperty(*m_faces, "vertex_index");
+        if (m_faceList < 0 || !m_faces->properties[m_faceList].isList)
+        {
+            error = "face has no vertex_indices list";
+            return false;
+        }
+    }
+    if (m_vertices->count > std::numeric_limits<uint32_t>::max())
+    {
+        error = "more vertices than 32-bit indices can address";
+        return false;
+    }
+
+    m_mesh.positions.resize(m_vertices->count * 3);
+    bool ok = m_header.format == PlyFormat::Ascii ? ReadAscii(error) : ReadBinary(error);
+    if (ok)
+        m_bounds.Store(m_mesh.boundsMin, m_mesh.boundsMax);
+    return ok;
+}
+
+bool PlyReader::ReadBinary(std::string& error)
+{
+    const unsigned char* p = (const unsigned char*)m_data + m_header.bodyOffset;
+    const unsigned char* end = (const unsigned char*)m_data + m_size;
+    for (const PlyElement& element : m_header.elements)
+    {
+        size_t size = 0;
+        if (&element == m_faces)
+        {
+            if (!ReadBinaryFaces(p, end, size, error))
+                return false;
+        }
+        else if (element.recordSize > 0)
+        {
+            if ((size_t)(end - p) / element.recordSize < element.count)
+            {
+                error = "file ends inside element " + element.name;
+                return false;
+            }
+            size = element.count * element.recordSize;
+            if (&element == m_vertices)
+                ReadBinaryVertices(p);
+        }
+        else
+        {
+            // Some other element with lists, walked only to find its end
+            if (&element == m_vertices)
+            {
+                error = "vertex element with lists";
+                return false;
+            }
+            for (size_t i = 0; i < element.count; ++i)
+            {
+                size_t recordSize = PlyRecordSize(element, p + size, end, m_swap);
+                if (recordSize == 0)
+                {
+                    error = "file ends inside element " + element.name;
+                    return false;
+                }
+                size += recordSize;
+            }
+        }
+        p += size;
+    }
+    return true;
+}
+
+void PlyReader::ReadBinaryVertices(const unsigned char* records)
+{
+    const PlyElement& element = *m_vertices;
+    const PlyProperty* axes[3] = { &element.properties[m_xyz[0]], &element.properties[m_xyz[1]], &element.properties[m_xyz[2]] };
+    float* positions = m_mesh.positions.data();
+
+    auto body = [&](size_t begin, size_t end) {
+        BoundsAccumulator bounds;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const unsigned char* record = records + i * element.recordSize;
+            float* position = positions + i * 3;
+            for (int axis = 0; axis < 3; ++axis)
+                position[axis] = (float)ReadPlyValue(record + axes[axis]->offset, axes[axis]->type, m_swap);
+            bounds.Add(position);
+        }
+        std::lock_guard<std::mutex> lock(m_boundsMutex);
+        m_bounds.Add(bounds);
+    };
+    if (m_jobs)
+        m_jobs->ParallelFor(element.count, kRecordGrain, body);
+    else
+        body(0, element.count);
+}
+
+bool PlyReader::ReadBinaryFaces(const unsigned char* records, const unsigned char* end, size_t& size, std::string& error)
+{
+    const PlyElement& element = *m_faces;
+    const PlyProperty& list = element.properties[m_faceList];
+    const size_t countSize = PlyTypeSize(list.countType);
+    const size_t itemSize = PlyTypeSize(list.type);
+    const uint32_t vertexCount = (uint32_t)m_vertices->count;
+
+    // Fast path: the list is the only variable part and every face a triangle,
+    // so records have one size and split anywhere. Checked while reading.
+    bool fixedAround = true;
+    size_t before = 0, after = 0;
+    for (size_t i = 0; i < element.properties.size(); ++i)
+    {
+        const PlyProperty& property = element.properties[i];
+        if ((int)i == m_faceList)
+            continue;
+        if (property.isList)
+            fixedAround = false;
+        ((int)i < m_faceList ? before : after) += PlyTypeSize(property.type);
+    }
+    const size_t stride = before + countSize + 3 * itemSize + after;
+    if (fixedAround && (size_t)(end - records) / stride >= element.count)
+    {
+        m_mesh.indices.resize(element.count * 3);
+        uint32_t* indices = m_mesh.indices.data();
+        std::atomic<bool> allTriangles(true), inRange(true);
+        auto body = [&](size_t begin, size_t last) {
+            for (size_t i = begin; i < last; ++i)
+            {
+                const unsigned char* record = records + i * stride + before;
+                if (ReadPlyInt(record, list.countType, m_swap) != 3)
+                {
+                    allTriangles = false;
+                    return;
+                }
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    int64_t index = ReadPlyInt(record + countSize + corner * itemSize, list.type, m_swap);
+                    if (index < 0 || index >= (int64_t)vertexCount)
+                        inRange = false;
+                    indices[i * 3 + corner] = (uint32_t)index;
+                }
+            }
+        };
+        if (m_jobs)
+            m_jobs->ParallelFor(element.count, kRecordGrain, body);
+        else
+            body(0, element.count);
+
+        if (allTriangles)
+        {
+            if (!inRange)
+            {
+                error = "face refers to a missing vertex";
+                return false;
+            }
+            size = element.count * stride;
+            return true;
+        }
+    }
+
+    // General case: walk the faces and fan the polygons
+    m_mesh.indices.clear();
+    size = 0;
+    for (size_t i = 0; i < element.count; ++i)
+    {
+        const unsigned char* record = records + size;
+        size_t recordSize = PlyRecordSize(element, record, end, m_swap);
+        if (recordSize == 0)
+        {
+            error = "file ends inside element face";
+            return false;
+        }
+        size += recordSize;
+
+        const unsigned char* p = record;
+        for (int property = 0; property < m_faceList; ++property)
+        {
+            const PlyProperty& skipped = element.properties[property];
+            if (skipped.isList)
+                p += PlyTypeSize(skipped.countType) +(size_t)ReadPlyInt(p, skipped.countType, m_swap) * PlyTypeSize(skipped.type);
+            else
+                p += PlyTypeSize(skipped.type);
+        }
+        int64_t corners = ReadPlyInt(p, list.countType, m_swap);
+        p += countSize;
+        uint32_t first = 0, previous = 0;
+        for (int64_t corner = 0; corner < corners; ++corner)
+        {
+            int64_t index = ReadPlyInt(p + corner * itemSize, list.type, m_swap);
+            if (index < 0 || index >= (int64_t)vertexCount)
+            {
+                error = "face refers to a missing vertex";
+                return false;
+            }
+            uint32_t current = (uint32_t)index;
+            if (corner == 0)
+                first = current;
+            if (corner >= 2)
+            {
+                m_mesh.indices.push_back(first);
+                m_mesh.indices.push_back(previous);
+                m_mesh.indices.push_back(current);
+            }
+            previous = current;
+        }
+    }
+    return true;
+}
+
+bool PlyReader::SkipAsciiProperty(const char*& p, const char* lineEnd, const PlyProperty& property) const
+{
+    if (!property.isList)
+    {
+        p = SkipToken(SkipSpaces(p, lineEnd), lineEnd);
+        return true;
+    }
+    int64_t count;
+    if (!ParseInt(p, lineEnd, count) || count < 0)
+        return false;
+    for (int64_t i = 0; i < count; ++i)
+        p = SkipToken(SkipSpaces(p, lineEnd), lineEnd);
+    return true;
+}
+
+// Three passes over line chunks: lines per chunk, then triangles in the face
+// lines of each chunk (which lines those are is only known after the first
+// pass), then the values straight into the output
+bool PlyReader::ReadAscii(std::string& error)
+{
+    struct Chunk
+    {
+        TextRange range;
+        size_t lines, firstLine;
+        size_t triangles, triangleBase;
+        BoundsAccumulator bounds;
+        const char* error;
+    };
+
+    const char* body = m_data + m_header.bodyOffset;
+    const char* end = m_data + m_size;
+    std::vector<TextRange> ranges = SplitLines(body, end, ChunkCount((size_t)(end - body), m_jobs));
+    std::vector<Chunk> chunks(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        chunks[i].range = ranges[i];
+        chunks[i].lines = chunks[i].triangles = 0;
+        chunks[i].error = nullptr;
+    }
+
+    ForEachChunk(chunks.size(), m_jobs, [&](size_t i) {
+        Chunk& chunk = chunks[i];
+        const char* next;
+        for (const char* p = chunk.range.begin; p < chunk.range.end; p = next)
+        {
+            LineEnd(p, chunk.range.end, next);
+            ++chunk.lines;
+        }
+    });
+    size_t line = 0;
+    for (Chunk& chunk : chunks)
+    {
+        chunk.firstLine = line;
+        line += chunk.lines;
+    }
+
+    // Line ranges of the two elements that matter
+    size_t vertexFirst = 0, faceFirst = 0, first = 0;
+    for (const PlyElement& element : m_header.elements)
+    {
+        if (&element == m_vertices) vertexFirst = first;
+        if (&element == m_faces) faceFirst = first;
+        first += element.count;
+    }
+    if (line < first)
+    {
+        error = "file ends before the last element";
+        return false;
+    }
+    const size_t vertexEnd = vertexFirst + m_vertices->count;
+    const size_t faceEnd = m_faces ? faceFirst + m_faces->count : faceFirst;
+
+    // Moves p to the face list's count; false if a property before it is malformed
+    auto seekFaceList = [this](const char*& p, const char* lineEnd) {
+        for (int property = 0; property < m_faceList; ++property)
+        {
+            if (!SkipAsciiProperty(p, lineEnd, m_faces->properties[property]))
+                return false;
+        }
+        return true;
+    };
+
+    ForEachChunk(chunks.size(), m_jobs, [&](size_t i) {
+        Chunk& chunk = chunks[i];
+        size_t lineIndex = chunk.firstLine;
+        const char* next;
+        for (const char* p = chunk.range.begin; p < chunk.range.end; p = next, ++lineIndex)
+        {
+            const char* lineEnd = LineEnd(p, chunk.range.end, next);
+            if (lineIndex < faceFirst || lineIndex >= faceEnd)
+                continue;
+            int64_t corners;
+            if (!seekFaceList(p, lineEnd) || !ParseInt(p, lineEnd, corners) || corners < 0)
+            {
+                chunk.error = p;
+                return;
+            }
+            if (corners >= 3)
+                chunk.triangles += (size_t)corners - 2;
+        }
+    });
+    size_t triangles = 0;
+    for (Chunk& chunk : chunks)
+    {
+        chunk.triangleBase = triangles;
+        triangles += chunk.triangles;
+    }
+    m_mesh.indices.resize(triangles * 3);
+
+    const uint32_t vertexCount = (uint32_t)m_vertices->count;
+    ForEachChunk(chunks.size(), m_jobs, [&](size_t i) {
+        Chunk& chunk = chunks[i];
+        if (chunk.error)
+            return;
+        uint32_t* index = m_mesh.indices.data() + chunk.triangleBase * 3;
+        size_t lineIndex = chunk.firstLine;
+        const char* next;
+        for (const char* p = chunk.range.begin; p < chunk.range.end; p = next, ++lineIndex)
+        {
+            const char* line = p;
+            const char* lineEnd = LineEnd(p, chunk.range.end, next);
+            if (lineIndex >= vertexFirst && lineIndex < vertexEnd)
+            {
+                float* position = m_mesh.positions.data() + (lineIndex - vertexFirst) * 3;
+                for (size_t property = 0; property < m_vertices->properties.size(); ++property)
+                {
+                    int axis = (int)property == m_xyz[0] ? 0 : (int)property == m_xyz[1] ? 1 : (int)property == m_xyz[2] ? 2 : -1;
+                    bool ok = axis >= 0 ? ParseFloat(p, lineEnd, position[axis])
+                                        : SkipAsciiProperty(p, lineEnd, m_vertices->properties[property]);
+                    if (!ok)
+                    {
+                        chunk.error = line;
+                        return;
+                    }
+                }
+                chunk.bounds.Add(position);
+            }
+            else if (lineIndex >= faceFirst && lineIndex < faceEnd)
+            {
+                int64_t corners = 0;
+                seekFaceList(p, lineEnd); // Both checked by the counting pass
+                ParseInt(p, lineEnd, corners);
+                uint32_t first = 0, previous = 0;
+                for (int64_t corner = 0; corner < corners; ++corner)
+                {
+                    int64_t value;
+                    if (!ParseInt(p, lineEnd, value) || value < 0 || value >= (int64_t)vertexCount)
+                    {
+                        chunk.error = line;
+                        return;
+                    }
+                    uint32_t current = (uint32_t)value;
+                    if (corner == 0)
+                        first = current;
+                    if (corner >= 2)
+                    {
+                        index[0] = first;
+                        index[1] = previous;
+                        index[2] = current;
+                        index += 3;
+                    }
+                    previous = current;
+                }
+            }
+        }
+    });
+
+    for (const Chunk& chunk : chunks)
+    {
+        if (chunk.error)
+        {
+            error = "bad element on line " + std::to_string(LineNumber(m_data, chunk.error));
+            return false;
+        }
+        m_bounds.Add(chunk.bounds);
+    }
+    return true;
+}
+
+std::string Extension(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return std::string();
+    std::string extension = path.substr(dot + 1);
+    for (char& c : extension)
+        c = (char)std::tolower((unsigned char)c);
+    return extension;
+}
+
+size_t AlignUp(size_t value)
+{
+    return (value + kMeshFileAlignment - 1) / kMeshFileAlignment * kMeshFileAlignment;
+}
+}
+
+bool MeshLoader::LoadObj(const std::string& path, MeshData& mesh, JobSystem* jobs)
+{
+    TRACE_SCOPE("MeshLoader::LoadObj");
+    MappedFile file;
+    if (!file.Open(path))
+        return false;
+    file.AdviseSequential(0, file.GetSize());
+
+    const char* data = (const char*)file.GetData();
+    std::vector<TextRange> ranges = SplitLines(data, data + file.GetSize(), ChunkCount(file.GetSize(), jobs));
+    std::vector<ObjChunk> chunks(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        chunks[i].range = ranges[i];
+        chunks[i].vertices = chunks[i].triangles = 0;
+        chunks[i].error = nullptr;
+    }
+
+    ForEachChunk(chunks.size(), jobs, [&chunks](size_t i) { CountObj(chunks[i]); });
+
+    size_t vertices = 0, triangles = 0;
+    for (ObjChunk& chunk : chunks)
+    {
+        chunk.vertexBase = vertices;
+        chunk.triangleBase = triangles;
+        vertices += chunk.vertices;
+        triangles += chunk.triangles;
+    }
+    if (vertices > std::numeric_limits<uint32_t>::max())
+    {
+        wxLogError("%s: more vertices than 32-bit indices can address", path);
+        return false;
+    }
+
+    mesh.positions.resize(vertices * 3);
+    mesh.indices.resize(triangles * 3);
+    ForEachChunk(chunks.size(), jobs, [&](size_t i) {
+        ParseObj(chunks[i], vertices, mesh.positions.data(), mesh.indices.data());
+    });
+
+    BoundsAccumulator bounds;
+    for (const ObjChunk& chunk : chunks)
+    {
+        if (chunk.error)
+        {
+            wxLogError("%s:%zu: cannot parse the line", path, LineNumber(data, chunk.error));
+            return false;
+        }
+        bounds.Add(chunk.bounds);
+    }
+    bounds.Store(mesh.boundsMin, mesh.boundsMax);
+    return true;
+}
+
+bool MeshLoader::LoadPly(const std::string& path, MeshData& mesh, JobSystem* jobs)
+{
+    TRACE_SCOPE("MeshLoader::LoadPly");
+    MappedFile file;
+    if (!file.Open(path))
+        return false;
+    file.AdviseSequential(0, file.GetSize());
+
+    PlyHeader header = {};
+    std::string error;
+    if (!ParsePlyHeader((const char*)file.GetData(), file.GetSize(), header, error))
+    {
+        wxLogError("%s: %s", path, error);
+        return false;
+    }
+
+    mesh.positions.clear();
+    mesh.indices.clear();
+    PlyReader reader(file, header, mesh, jobs);
+    if (!reader.Read(error))
+    {
+        wxLogError("%s: %s", path, error);
+        return false;
+    }
+    return true;
+}
+
+bool MeshLoader::Load(const std::string& path, MeshData& mesh, JobSystem* jobs)
+{
+    std::string extension = Extension(path);
+    if (extension == "obj")
+        return LoadObj(path, mesh, jobs);
+    if (extension == "ply")
+        return LoadPly(path, mesh, jobs);
+    if (extension == "rmesh")
+    {
+        MeshFile file;
+        if (!file.Open(path))
+            return false;
+        if (!IndicesInRange(file.GetIndices(), file.GetIndexCount(), file.GetVertexCount(), jobs))
+        {
+            wxLogError("%s: face refers to a missing vertex", path);
+            return false;
+        }
+        mesh.positions.assign(file.GetPositions(), file.GetPositions() + file.GetVertexCount() * 3);
+        mesh.indices.assign(file.GetIndices(), file.GetIndices() + file.GetIndexCount());
+        std::copy(file.GetHeader().boundsMin, file.GetHeader().boundsMin + 3, mesh.boundsMin);
+        std::copy(file.GetHeader().boundsMax, file.GetHeader().boundsMax + 3, mesh.boundsMax);
+        return true;
+    }
+    wxLogError("%s: unknown mesh format", path);
+    return false;
+}
+
+void MeshLoader::ComputeBounds(MeshData& mesh)
+{
+    BoundsAccumulator bounds;
+    for (size_t i = 0; i < mesh.positions.size(); i += 3)
+        bounds.Add(&mesh.positions[i]);
+    bounds.Store(mesh.boundsMin, mesh.boundsMax);
+}
+
+bool MeshLoader::IndicesInRange(const uint32_t* indices, size_t count, size_t vertexCount, JobSystem* jobs)
+{
+    std::atomic<bool> inRange(true);
+    auto body = [&](size_t begin, size_t end) {
+        uint32_t largest = 0;
+        for (size_t i = begin; i < end; ++i)
+            largest = std::max(largest, indices[i]);
+        if (begin < end && largest >= vertexCount)
+            inRange = false;
+    };
+    if (jobs)
+        jobs->ParallelFor(count, kRecordGrain, body);
+    else
+        body(0, count);
+    return inRange;
+}
+
+bool MeshFile::Open(const std::string& path)
+{
+    Close();
+    if (!m_file.Open(path))
+        return false;
+
+    const size_t size = m_file.GetSize();
+    bool valid = size >= sizeof(MeshFileHeader);
+    if (valid)
+    {
+        std::memcpy(&m_header, m_file.GetData(), sizeof(m_header));
+        const uint64_t positionsBytes = m_header.vertexCount * 3 * sizeof(float);
+        const uint64_t indicesBytes = m_header.indexCount * sizeof(uint32_t);
+        valid = std::memcmp(m_header.magic, "RMSH", 4) == 0 && m_header.version == kMeshFileVersion
+            && m_header.indexCount % 3 == 0 && m_header.vertexCount <= std::numeric_limits<uint32_t>::max()
+            && m_header.indexCount <= size / sizeof(uint32_t)
+            && m_header.positionsOffset % kMeshFileAlignment == 0 && m_header.indicesOffset % kMeshFileAlignment == 0
+            && m_header.positionsOffset <= size && positionsBytes <= size - m_header.positionsOffset
+            && m_header.indicesOffset <= size && indicesBytes <= size - m_header.indicesOffset;
+    }
+    if (!valid)
+    {
+        wxLogError("%s is not a version %u mesh file", path, kMeshFileVersion);
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MeshFile::Close()
+{
+    m_file.Close();
+    m_header = MeshFileHeader();
+}
+
+const float* MeshFile::GetPositions() const
+{
+    return (const float*)(m_file.GetData() + m_header.positionsOffset);
+}
+
+const uint32_t* MeshFile::GetIndices() const
+{
+    return (const uint32_t*)(m_file.GetData() + m_header.indicesOffset);
+}
+
+bool MeshFile::Write(const std::string& path, const MeshData& mesh)
+{
+    MeshFileHeader header = {};
+    std::memcpy(header.magic, "RMSH", 4);
+    header.version = kMeshFileVersion;
+    header.vertexCount = mesh.GetVertexCount();
+    header.indexCount = mesh.indices.size();
+    header.positionsOffset = AlignUp(sizeof(header));
+    header.indicesOffset = AlignUp((size_t)header.positionsOffset + mesh.positions.size() * sizeof(float));
+    std::copy(mesh.boundsMin, mesh.boundsMin + 3, header.boundsMin);
+    std::copy(mesh.boundsMax, mesh.boundsMax + 3, header.boundsMax);
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        wxLogError("Cannot create %s", path);
+        return false;
+    }
+
+    const std::vector<char> padding(kMeshFileAlignment, 0);
+    size_t positionsEnd = (size_t)header.positionsOffset + mesh.positions.size() * sizeof(float);
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(padding.data(), 1, (size_t)header.positionsOffset - sizeof(header), file) == (size_t)header.positionsOffset - sizeof(header)
+        && std::fwrite(mesh.positions.data(), sizeof(float), mesh.positions.size(), file) == mesh.positions.size()
+        && std::fwrite(padding.data(), 1, (size_t)header.indicesOffset - positionsEnd, file) == (size_t)header.indicesOffset - positionsEnd
+        && std::fwrite(mesh.indices.data(), sizeof(uint32_t), mesh.indices.size(), file) == mesh.indices.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+        wxLogError("Failed to write %s", path);
+    return ok;
+}
+
+bool MeshFile::IsMeshFile(const std::string& path)
+{
+    return Extension(path) == "rmesh";
+}
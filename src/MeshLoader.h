@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+class JobSystem;
+
+// Indexed triangle mesh as it is uploaded: positions only, the mesh shader
+// derives face normals from screen-space derivatives
+struct MeshData
+{
+    std::vector<float> positions;  // x y z per vertex
+    std::vector<uint32_t> indices; // Three per triangle, counter-clockwise
+    float boundsMin[3], boundsMax[3];
+
+    size_t GetVertexCount() const { return positions.size() / 3; }
+    size_t GetTriangleCount() const { return indices.size() / 3; }
+};
+
+// Native mesh file (.rmesh): this header, then the positions and the indices
+// exactly as MeshData holds them, each section at a multiple of
+// kMeshFileAlignment so that a mapping of the file can be handed to
+// glBufferData as it is. Little-endian, like every host this builds for.
+struct MeshFileHeader
+{
+    char magic[4];    // "RMSH"
+    uint32_t version; // kMeshFileVersion
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t positionsOffset; // Bytes from the start of the file
+    uint64_t indicesOffset;
+    float boundsMin[3], boundsMax[3];
+};
+
+const uint32_t kMeshFileVersion = 1;
+const size_t kMeshFileAlignment = 4096;
+
+// A .rmesh file opened in place: nothing is parsed or copied, the arrays
+// point into the mapping and stay valid until Close()
+class MeshFile
+{
+public:
+    bool Open(const std::string& path);
+    void Close();
+
+    const MeshFileHeader& GetHeader() const { return m_header; }
+    const float* GetPositions() const;
+    const uint32_t* GetIndices() const;
+    size_t GetVertexCount() const { return (size_t)m_header.vertexCount; }
+    size_t GetIndexCount() const { return (size_t)m_header.indexCount; }
+    size_t GetFileSize() const { return m_file.GetSize(); }
+    const MappedFile& GetMapping() const { return m_file; }
+
+    static bool Write(const std::string& path, const MeshData& mesh);
+    static bool IsMeshFile(const std::string& path); // By extension
+
+private:
+    MappedFile m_file;
+    MeshFileHeader m_header = {};
+};
+
+// Text and binary mesh formats into MeshData. Files are mapped, cut into
+// chunks at line (or record) boundaries and the chunks parsed in parallel on
+// the given JobSystem: one pass counts vertices and triangles per chunk, a
+// prefix sum gives every chunk its place in the output, a second pass parses
+// straight into it. Without a JobSystem the same passes run on the caller.
+namespace MeshLoader
+{
+// v and f lines; faces may be polygons (fanned) and use v/vt/vn or negative indices
+bool LoadObj(const std::string& path, MeshData& mesh, JobSystem* jobs = nullptr);
+// ascii, binary_little_endian and binary_big_endian; vertex x/y/z and face vertex_indices
+bool LoadPly(const std::string& path, MeshData& mesh, JobSystem* jobs = nullptr);
+// By extension: .obj, .ply or .rmesh (copied out of the mapping)
+bool Load(const std::string& path, MeshData& mesh, JobSystem* jobs = nullptr);
+
+void ComputeBounds(MeshData& mesh);
+// Every index below vertexCount; for .rmesh files, whose indices are not parsed
+bool IndicesInRange(const uint32_t* indices, size_t count, size_t vertexCount, JobSystem* jobs = nullptr);
+}
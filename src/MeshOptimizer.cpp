@@ -0,0 +1,393 @@
+#include "MeshOptimizer.h"
+#include "MeshLoader.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+const uint32_t kUnused = 0xFFFFFFFFu;
+const size_t kFetchLineBytes = 64;
+
+struct PositionKey
+{
+    uint32_t bits[3];
+
+    bool operator==(const PositionKey& other) const
+    {
+        return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+    }
+};
+
+struct PositionHash
+{
+    size_t operator()(const PositionKey& key) const
+    {
+        uint64_t hash = 1469598103934665603ull;
+        for (uint32_t bits : key.bits)
+            hash = (hash ^ bits) * 1099511628211ull;
+        return (size_t)(hash ^ (hash >> 32));
+    }
+};
+
+// Triangles around each vertex, as offsets into one flat list
+struct Adjacency
+{
+    std::vector<uint32_t> offsets; // vertexCount + 1
+    std::vector<uint32_t> triangles;
+};
+
+void BuildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount, Adjacency& adjacency)
+{
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (uint32_t index : indices)
+        ++adjacency.offsets[index + 1];
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+    adjacency.triangles.resize(indices.size());
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency.triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+}
+
+// FIFO cache as timestamps: a vertex is cached while fewer than cacheSize
+// misses have happened since its own. Flush() empties it in O(1). Stamps are
+// 64-bit: misses plus flushes on a very large mesh can pass 2^32, and a
+// wrapped clock would turn stale stamps into hits.
+class FifoCache
+{
+public:
+    FifoCache(size_t entries, int cacheSize)
+        : m_stamps(entries, 0), m_time((uint64_t)cacheSize + 1), m_cacheSize((uint64_t)cacheSize)
+    {
+    }
+
+    // True on a miss, which also caches the entry
+    bool Touch(uint32_t entry)
+    {
+        if (m_time - m_stamps[entry] <= m_cacheSize)
+            return false;
+        m_stamps[entry] = m_time++;
+        return true;
+    }
+
+    void Flush() { m_time += m_cacheSize + 1; }
+
+    uint64_t GetTime() const { return m_time; }
+    uint64_t GetStamp(uint32_t entry) const { return m_stamps[entry]; }
+
+private:
+    std::vector<uint64_t> m_stamps;
+    uint64_t m_time;
+    uint64_t m_cacheSize;
+};
+
+// Tipsify: fan around one vertex at a time, then continue from the vertex
+// that will still be cached once all of its own triangles are out. Returns
+// the triangle order; hardBoundaries gets the positions where it had to jump
+// to an unrelated part of the mesh.
+std::vector<uint32_t> TipsifyOrder(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize,
+                                   std::vector<size_t>& hardBoundaries)
+{
+    const size_t triangleCount = indices.size() / 3;
+    Adjacency adjacency;
+    BuildAdjacency(indices, vertexCount, adjacency);
+
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnds; // Recently used vertices, most recent on top
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+
+    size_t cursor = 0;
+    auto nextLive = [&]() -> int64_t {
+        while (cursor < vertexCount && live[cursor] == 0)
+            ++cursor;
+        return cursor < vertexCount ? (int64_t)cursor : -1;
+    };
+
+    int64_t fan = nextLive();
+    bool jumped = true;
+    while (fan >= 0)
+    {
+        if (jumped)
+            hardBoundaries.push_back(order.size());
+
+        candidates.clear();
+        for (uint32_t k = adjacency.offsets[fan]; k < adjacency.offsets[fan + 1]; ++k)
+        {
+            uint32_t triangle = adjacency.triangles[k];
+            if (emitted[triangle])
+                continue;
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                uint32_t v = indices[triangle * 3 + corner];
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                cache.Touch(v);
+            }
+            emitted[triangle] = 1;
+            order.push_back(triangle);
+        }
+
+        // Oldest candidate that survives emitting its remaining triangles
+        // (at most two misses each), any live one otherwise
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (live[v] == 0)
+                continue;
+            int64_t age = (int64_t)(cache.GetTime() - cache.GetStamp(v));
+            int64_t priority = age + 2 * (int64_t)live[v] <= cacheSize ? age : 0;
+            if (priority > bestPriority)
+            {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+
+        jumped = false;
+        while (best < 0 && !deadEnds.empty())
+        {
+            uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if (live[v] > 0)
+                best = v;
+        }
+        if (best < 0)
+        {
+            best = nextLive();
+            jumped = true;
+        }
+        fan = best;
+    }
+    return order;
+}
+
+// Area-weighted centroid and normal sum of triangles, for the overdraw sort
+void AccumulateTriangle(const float* positions, const uint32_t* triangle, double centroid[3], double normal[3], double& area)
+{
+    const float* a = positions + triangle[0] * 3;
+    const float* b = positions + triangle[1] * 3;
+    const float* c = positions + triangle[2] * 3;
+    double ab[3] = { (double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2] };
+    double ac[3] = { (double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2] };
+    double cross[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+    double twiceArea = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        centroid[axis] += twiceArea * ((double)a[axis] + b[axis] + c[axis]) / 3.0;
+        normal[axis] += cross[axis];
+    }
+    area += twiceArea;
+}
+}
+
+size_t MeshOptimizer::DeduplicateVertices(MeshData& mesh)
+{
+    TRACE_SCOPE("MeshOptimizer::DeduplicateVertices");
+    const size_t vertexCount = mesh.GetVertexCount();
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<float> positions;
+    positions.reserve(mesh.positions.size());
+    std::unordered_map<PositionKey, uint32_t, PositionHash> unique;
+    unique.reserve(vertexCount);
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        PositionKey key;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float value = mesh.positions[v * 3 + axis];
+            value = value == 0.0f ? 0.0f : value; // -0 and +0 are the same point
+            std::memcpy(&key.bits[axis], &value, sizeof(value));
+        }
+        auto inserted = unique.emplace(key, (uint32_t)(positions.size() / 3));
+        if (inserted.second)
+            positions.insert(positions.end(), &mesh.positions[v * 3], &mesh.positions[v * 3] + 3);
+        remap[v] = inserted.first->second;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        uint32_t a = remap[mesh.indices[i]], b = remap[mesh.indices[i + 1]], c = remap[mesh.indices[i + 2]];
+        if (a == b || b == c || a == c)
+            continue;
+        mesh.indices[kept++] = a;
+        mesh.indices[kept++] = b;
+        mesh.indices[kept++] = c;
+    }
+    mesh.indices.resize(kept);
+
+    size_t removed = vertexCount - positions.size() / 3;
+    mesh.positions.swap(positions);
+    return removed;
+}
+
+void MeshOptimizer::OptimizeVertexCache(MeshData& mesh, int cacheSize, double overdrawThreshold)
+{
+    TRACE_SCOPE("MeshOptimizer::OptimizeVertexCache");
+    const size_t vertexCount = mesh.GetVertexCount();
+    const size_t triangleCount = mesh.GetTriangleCount();
+    if (triangleCount == 0)
+        return;
+
+    std::vector<size_t> hardBoundaries;
+    std::vector<uint32_t> order = TipsifyOrder(mesh.indices, vertexCount, cacheSize, hardBoundaries);
+    hardBoundaries.push_back(order.size());
+
+    // Cut the runs between jumps further wherever the cluster so far, drawn
+    // from a cold cache, is within the threshold of the run's own ACMR, so
+    // clusters can move around without costing much more than that
+    std::vector<size_t> clusters;
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+    {
+        const size_t runBegin = hardBoundaries[h], runEnd = hardBoundaries[h + 1];
+        size_t misses = 0;
+        cache.Flush();
+        for (size_t i = runBegin; i < runEnd; ++i)
+        {
+            const uint32_t* triangle = &mesh.indices[order[i] * 3];
+            for (int corner = 0; corner < 3; ++corner)
+                misses += cache.Touch(triangle[corner]) ? 1 : 0;
+        }
+        const double limit = overdrawThreshold * (double)misses / (double)(runEnd - runBegin);
+
+        size_t start = runBegin;
+        misses = 0;
+        cache.Flush();
+        clusters.push_back(start);
+        for (size_t i = runBegin; i + 1 < runEnd; ++i)
+        {
+            const uint32_t* triangle = &mesh.indices[order[i] * 3];
+            for (int corner = 0; corner < 3; ++corner)
+                misses += cache.Touch(triangle[corner]) ? 1 : 0;
+            if ((double)misses <= limit * (double)(i + 1 - start))
+            {
+                start = i + 1;
+                misses = 0;
+                cache.Flush();
+                clusters.push_back(start);
+            }
+        }
+    }
+    clusters.push_back(order.size());
+
+    // Clusters facing away from the middle of the mesh are outer surface and
+    // more likely to hide others, so they are drawn first
+    struct Cluster
+    {
+        size_t begin, end;
+        double measure;
+    };
+    std::vector<Cluster> sorted(clusters.size() - 1);
+    double meshCentroid[3] = { 0.0, 0.0, 0.0 }, meshArea = 0.0;
+    std::vector<double> centroids(sorted.size() * 3, 0.0), normals(sorted.size() * 3, 0.0);
+    for (size_t c = 0; c < sorted.size(); ++c)
+    {
+        double area = 0.0;
+        for (size_t i = clusters[c]; i < clusters[c + 1]; ++i)
+            AccumulateTriangle(mesh.positions.data(), &mesh.indices[order[i] * 3], &centroids[c * 3], &normals[c * 3], area);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            meshCentroid[axis] += centroids[c * 3 + axis];
+            centroids[c * 3 + axis] /= area > 0.0 ? area : 1.0;
+        }
+        meshArea += area;
+        sorted[c] = Cluster{ clusters[c], clusters[c + 1], 0.0 };
+    }
+    for (int axis = 0; axis < 3; ++axis)
+        meshCentroid[axis] /= meshArea > 0.0 ? meshArea : 1.0;
+
+    for (size_t c = 0; c < sorted.size(); ++c)
+    {
+        const double* n = &normals[c * 3];
+        double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0)
+            continue;
+        double measure = 0.0;
+        for (int axis = 0; axis < 3; ++axis)
+            measure += (centroids[c * 3 + axis] - meshCentroid[axis]) * n[axis];
+        sorted[c].measure = measure / length;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.measure > b.measure; });
+
+    std::vector<uint32_t> indices;
+    indices.reserve(mesh.indices.size());
+    for (const Cluster& cluster : sorted)
+    {
+        for (size_t i = cluster.begin; i < cluster.end; ++i)
+            indices.insert(indices.end(), &mesh.indices[order[i] * 3], &mesh.indices[order[i] * 3] + 3);
+    }
+    mesh.indices.swap(indices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(MeshData& mesh)
+{
+    TRACE_SCOPE("MeshOptimizer::OptimizeVertexFetch");
+    const size_t vertexCount = mesh.GetVertexCount();
+    std::vector<uint32_t> remap(vertexCount, kUnused);
+    uint32_t next = 0;
+    for (uint32_t& index : mesh.indices)
+    {
+        if (remap[index] == kUnused)
+            remap[index] = next++;
+        index = remap[index];
+    }
+
+    std::vector<float> positions((size_t)next * 3);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (remap[v] != kUnused)
+            std::copy(&mesh.positions[v * 3], &mesh.positions[v * 3] + 3, &positions[(size_t)remap[v] * 3]);
+    }
+    mesh.positions.swap(positions);
+    return vertexCount - next;
+}
+
+void MeshOptimizer::Optimize(MeshData& mesh, int cacheSize)
+{
+    DeduplicateVertices(mesh);
+    OptimizeVertexCache(mesh, cacheSize);
+    OptimizeVertexFetch(mesh);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                                    int cacheSize, size_t vertexSize)
+{
+    VertexCacheStats stats = { 0.0, 0.0, 0.0 };
+    if (indexCount < 3 || vertexCount == 0)
+        return stats;
+
+    const size_t lineCount = (vertexCount * vertexSize + kFetchLineBytes - 1) / kFetchLineBytes;
+    FifoCache vertices(vertexCount, cacheSize);
+    FifoCache lines(lineCount, kFetchCacheLines);
+    size_t misses = 0, fetchedLines = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        if (!vertices.Touch(indices[i]))
+            continue;
+        ++misses;
+        size_t first = indices[i] * vertexSize / kFetchLineBytes;
+        size_t last = (indices[i] * vertexSize + vertexSize - 1) / kFetchLineBytes;
+        for (size_t line = first; line <= last; ++line)
+            fetchedLines += lines.Touch((uint32_t)line) ? 1 : 0;
+    }
+
+    stats.acmr = (double)misses / (double)(indexCount / 3);
+    stats.atvr = (double)misses / (double)vertexCount;
+    stats.overfetch = (double)(fetchedLines * kFetchLineBytes) / (double)(vertexCount * vertexSize);
+    return stats;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshData;
+
+// Post-transform cache behaviour of an index buffer under a FIFO cache
+struct VertexCacheStats
+{
+    double acmr;      // Average cache miss ratio: vertex shader runs per triangle (0.5 ideal, 3 worst)
+    double atvr;      // Average transformed vertex ratio: runs per vertex (1 ideal)
+    double overfetch; // Bytes read from the vertex buffer over its size (1 ideal)
+};
+
+// Offline or load-time reordering for indexed triangle meshes, in the order
+// Optimize() runs them: weld duplicate vertices, order triangles for the
+// post-transform vertex cache (Tipsify, Sander et al. 2007), sort the
+// resulting clusters so outer surfaces tend to come first and hide what is
+// behind them, then store vertices in the order the triangles first use them.
+// Every step keeps the set of triangles and their winding.
+namespace MeshOptimizer
+{
+// FIFO size the triangle order is tuned for; hardware has 16 to 32 entries
+const int kDefaultCacheSize = 16;
+// Clusters for the overdraw sort are cut where their own ACMR is within this
+// factor of the vertex cache order's; higher gives more, shorter clusters
+// (more freedom against overdraw, more cache misses)
+const double kDefaultOverdrawThreshold = 1.05;
+
+// Merges bit-identical positions and drops triangles that collapse; returns the vertices removed
+size_t DeduplicateVertices(MeshData& mesh);
+
+void OptimizeVertexCache(MeshData& mesh, int cacheSize = kDefaultCacheSize,
+                         double overdrawThreshold = kDefaultOverdrawThreshold);
+
+// Renumbers vertices by first use, dropping unused ones; returns the vertices removed
+size_t OptimizeVertexFetch(MeshData& mesh);
+
+// All of the above
+void Optimize(MeshData& mesh, int cacheSize = kDefaultCacheSize);
+
+// Simulates a FIFO post-transform cache and 64-byte vertex fetches (a FIFO of
+// kFetchCacheLines lines) over the triangles in order
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                    int cacheSize = kDefaultCacheSize, size_t vertexSize = 3 * sizeof(float));
+const int kFetchCacheLines = 64;
+}
@@ -0,0 +1,89 @@
+#include <GL/glew.h>
+#include "OffscreenTarget.h"
+#include <wx/log.h>
+#include <cstring>
+
+OffscreenTarget::OffscreenTarget()
+    : m_framebuffer(0), m_colorRenderbuffer(0), m_depthRenderbuffer(0)
+    , m_width(0), m_height(0)
+{
+}
+
+OffscreenTarget::~OffscreenTarget()
+{
+    Release();
+}
+
+void OffscreenTarget::Release()
+{
+    if (m_framebuffer) glDeleteFramebuffers(1, &m_framebuffer);
+    if (m_colorRenderbuffer) glDeleteRenderbuffers(1, &m_colorRenderbuffer);
+    if (m_depthRenderbuffer) glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+    m_framebuffer = 0;
+    m_colorRenderbuffer = 0;
+    m_depthRenderbuffer = 0;
+}
+
+bool OffscreenTarget::Create(int width, int height)
+{
+    Release();
+    m_width = width;
+    m_height = height;
+
+    glGenRenderbuffers(1, &m_colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    // Only loaded meshes test against it
+    glGenRenderbuffers(1, &m_depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        wxLogError("Offscreen framebuffer incomplete: 0x%x", status);
+        Release();
+        return false;
+    }
+
+    return true;
+}
+
+void OffscreenTarget::Bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
+
+void OffscreenTarget::Unbind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OffscreenTarget::ReadPixels(std::vector<unsigned char>& rgba) const
+{
+    const size_t rowSize = (size_t)m_width * 4;
+    rgba.resize(rowSize * m_height);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+    // GL rows are bottom-up
+    std::vector<unsigned char> row(rowSize);
+    for (int y = 0; y < m_height / 2; ++y)
+    {
+        unsigned char* top = rgba.data() + y * rowSize;
+        unsigned char* bottom = rgba.data() + (m_height - 1 - y) * rowSize;
+        std::memcpy(row.data(), top, rowSize);
+        std::memcpy(top, bottom, rowSize);
+        std::memcpy(bottom, row.data(), rowSize);
+    }
+}
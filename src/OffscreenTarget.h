@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+
+// Framebuffer object with an RGBA8 color and a 24-bit depth attachment.
+// Render target for the headless backend; works in any context.
+class OffscreenTarget
+{
+public:
+    OffscreenTarget();
+    ~OffscreenTarget();
+
+    bool Create(int width, int height);
+    void Bind() const;
+    void Unbind() const;
+
+    // Top-down RGBA rows, ready to be written as an image
+    void ReadPixels(std::vector<unsigned char>& rgba) const;
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+private:
+    void Release();
+
+    unsigned int m_framebuffer;
+    unsigned int m_colorRenderbuffer;
+    unsigned int m_depthRenderbuffer;
+    int m_width, m_height;
+};
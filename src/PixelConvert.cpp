@@ -0,0 +1,568 @@
+#include "PixelConvert.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PIXELCONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace PixelConvert
+{
+namespace
+{
+// [0, 255] sRGB -> linear, [256, 511] plain v / 255 for alpha
+struct LinearTable
+{
+    float values[512];
+
+    LinearTable()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            float c = i / 255.0f;
+            values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            values[256 + i] = c;
+        }
+    }
+};
+
+const float* GetLinearTable()
+{
+    static const LinearTable table;
+    return table.values;
+}
+
+// round(c * a / 255) without a division
+inline unsigned char MulDiv255(unsigned int c, unsigned int a)
+{
+    unsigned int t = c * a + 128;
+    return (unsigned char)((t + (t >> 8)) >> 8);
+}
+
+// Scalar
+
+void RgbAlphaToRgbaScalar(const unsigned char* rgb, const unsigned char* alpha, unsigned char* rgba, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = alpha[i];
+    }
+}
+
+void RgbToRgbaScalar(const unsigned char* rgb, unsigned char alpha, unsigned char* rgba, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = alpha;
+    }
+}
+
+void PremultiplyAlphaScalar(unsigned char* rgba, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        unsigned char* px = rgba + i * 4;
+        px[0] = MulDiv255(px[0], px[3]);
+        px[1] = MulDiv255(px[1], px[3]);
+        px[2] = MulDiv255(px[2], px[3]);
+    }
+}
+
+void SrgbToLinearScalar(const unsigned char* rgba, float* linear, size_t pixels)
+{
+    const float* table = GetLinearTable();
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        linear[i * 4 + 0] = table[rgba[i * 4 + 0]];
+        linear[i * 4 + 1] = table[rgba[i * 4 + 1]];
+        linear[i * 4 + 2] = table[rgba[i * 4 + 2]];
+        linear[i * 4 + 3] = table[256 + rgba[i * 4 + 3]];
+    }
+}
+
+// 8-bit fixed point BT.601; chroma inputs are 2x2 sums, hence 2 more bits of shift
+inline unsigned char LumaOf(unsigned int r, unsigned int g, unsigned int b)
+{
+    return (unsigned char)((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+inline unsigned char ChromaU(int r, int g, int b)
+{
+    return (unsigned char)std::min(255, (-43 * r - 85 * g + 128 * b + (128 << 10) + 512) >> 10);
+}
+
+inline unsigned char ChromaV(int r, int g, int b)
+{
+    return (unsigned char)std::min(255, (128 * r - 107 * g - 21 * b + (128 << 10) + 512) >> 10);
+}
+
+void RgbaToYuv420Scalar(const unsigned char* rgba0, const unsigned char* rgba1, unsigned char* luma0, unsigned char* luma1,
+                        unsigned char* u, unsigned char* v, size_t width)
+{
+    for (size_t x = 0; x < width; x += 2)
+    {
+        size_t x1 = x + 1 < width ? x + 1 : x;
+        const unsigned char* p00 = rgba0 + x * 4;
+        const unsigned char* p01 = rgba0 + x1 * 4;
+        const unsigned char* p10 = rgba1 + x * 4;
+        const unsigned char* p11 = rgba1 + x1 * 4;
+        luma0[x] = LumaOf(p00[0], p00[1], p00[2]);
+        luma0[x1] = LumaOf(p01[0], p01[1], p01[2]);
+        luma1[x] = LumaOf(p10[0], p10[1], p10[2]);
+        luma1[x1] = LumaOf(p11[0], p11[1], p11[2]);
+
+        int r = p00[0] + p01[0] + p10[0] + p11[0];
+        int g = p00[1] + p01[1] + p10[1] + p11[1];
+        int b = p00[2] + p01[2] + p10[2] + p11[2];
+        u[x / 2] = ChromaU(r, g, b);
+        v[x / 2] = ChromaV(r, g, b);
+    }
+}
+
+#ifdef PIXELCONVERT_X86
+
+inline int Load32(const unsigned char* p)
+{
+    int value;
+    std::memcpy(&value, p, 4);
+    return value;
+}
+
+// SSE2 has no byte shuffle: each pixel is an unaligned 32-bit load whose
+// fourth byte (the next pixel's red) gets masked off
+
+__attribute__((target("sse2")))
+inline __m128i LoadRgb4Sse2(const unsigned char* rgb)
+{
+    __m128i px = _mm_setr_epi32(Load32(rgb), Load32(rgb + 3), Load32(rgb + 6), Load32(rgb + 9));
+    return _mm_and_si128(px, _mm_set1_epi32(0x00FFFFFF));
+}
+
+__attribute__((target("sse2")))
+void RgbAlphaToRgbaSse2(const unsigned char* rgb, const unsigned char* alpha, unsigned char* rgba, size_t pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    // The last 32-bit load reads one byte past pixel i + 15
+    for (; i + 17 <= pixels; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(alpha + i));
+        __m128i aLo = _mm_unpacklo_epi8(zero, a); // a << 8 per 16-bit lane
+        __m128i aHi = _mm_unpackhi_epi8(zero, a);
+        __m128i a32[4] = {
+            _mm_unpacklo_epi16(zero, aLo), // a << 24 per 32-bit lane
+            _mm_unpackhi_epi16(zero, aLo),
+            _mm_unpacklo_epi16(zero, aHi),
+            _mm_unpackhi_epi16(zero, aHi)
+        };
+
+        for (int k = 0; k < 4; ++k)
+        {
+            __m128i px = _mm_or_si128(LoadRgb4Sse2(rgb + (i + k * 4) * 3), a32[k]);
+            _mm_storeu_si128((__m128i*)(rgba + (i + k * 4) * 4), px);
+        }
+    }
+    RgbAlphaToRgbaScalar(rgb + i * 3, alpha + i, rgba + i * 4, pixels - i);
+}
+
+__attribute__((target("sse2")))
+void RgbToRgbaSse2(const unsigned char* rgb, unsigned char alpha, unsigned char* rgba, size_t pixels)
+{
+    const __m128i a = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+    size_t i = 0;
+    for (; i + 5 <= pixels; i += 4)
+        _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_or_si128(LoadRgb4Sse2(rgb + i * 3), a));
+    RgbToRgbaScalar(rgb + i * 3, alpha, rgba + i * 4, pixels - i);
+}
+
+// Two pixels widened to 16-bit lanes
+__attribute__((target("sse2")))
+inline __m128i PremultiplyPairSse2(__m128i px)
+{
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(px, alpha), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("sse2")))
+void PremultiplyAlphaSse2(unsigned char* rgba, size_t pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4)
+    {
+        __m128i px = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+        __m128i lo = PremultiplyPairSse2(_mm_unpacklo_epi8(px, zero));
+        __m128i hi = PremultiplyPairSse2(_mm_unpackhi_epi8(px, zero));
+        __m128i result = _mm_packus_epi16(lo, hi);
+        // alpha * alpha / 255 is wrong for the alpha channel itself, keep the original
+        result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, px));
+        _mm_storeu_si128((__m128i*)(rgba + i * 4), result);
+    }
+    PremultiplyAlphaScalar(rgba + i * 4, pixels - i);
+}
+
+// 8 RGBA pixels -> R, G, B in 16-bit lanes
+__attribute__((target("sse2")))
+inline void SplitRgba8Sse2(const unsigned char* rgba, __m128i& r, __m128i& g, __m128i& b)
+{
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    __m128i lo = _mm_loadu_si128((const __m128i*)rgba);
+    __m128i hi = _mm_loadu_si128((const __m128i*)(rgba + 16));
+    r = _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+    g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask), _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+    b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask), _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+}
+
+// The sum is at most 255 * 256 + 128, so wrapping 16-bit math is exact
+__attribute__((target("sse2")))
+inline __m128i LumaSse2(__m128i r, __m128i g, __m128i b)
+{
+    __m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(77)), _mm_mullo_epi16(g, _mm_set1_epi16(150)));
+    y = _mm_add_epi16(y, _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(29)), _mm_set1_epi16(128)));
+    return _mm_srli_epi16(y, 8);
+}
+
+// 2x2 sums (16-bit, low 4 lanes) -> 32-bit chroma; madd pairs the channels up
+__attribute__((target("sse2")))
+inline __m128i ChromaSse2(__m128i rg, __m128i b0, __m128i rgWeights, __m128i bWeights)
+{
+    __m128i c = _mm_add_epi32(_mm_madd_epi16(rg, rgWeights), _mm_madd_epi16(b0, bWeights));
+    return _mm_srai_epi32(_mm_add_epi32(c, _mm_set1_epi32((128 << 10) + 512)), 10);
+}
+
+__attribute__((target("sse2")))
+void RgbaToYuv420Sse2(const unsigned char* rgba0, const unsigned char* rgba1, unsigned char* luma0, unsigned char* luma1,
+                      unsigned char* u, unsigned char* v, size_t width)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i uRg = _mm_set1_epi32((int)(((unsigned int)(unsigned short)-85 << 16) | (unsigned short)-43));
+    const __m128i uB = _mm_set1_epi32(128);
+    const __m128i vRg = _mm_set1_epi32((int)(((unsigned int)(unsigned short)-107 << 16) | 128));
+    const __m128i vB = _mm_set1_epi32((unsigned short)-21);
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i r0, g0, b0, r1, g1, b1;
+        SplitRgba8Sse2(rgba0 + x * 4, r0, g0, b0);
+        SplitRgba8Sse2(rgba1 + x * 4, r1, g1, b1);
+
+        __m128i luma = _mm_packus_epi16(LumaSse2(r0, g0, b0), LumaSse2(r1, g1, b1));
+        _mm_storel_epi64((__m128i*)(luma0 + x), luma);
+        _mm_storel_epi64((__m128i*)(luma1 + x), _mm_srli_si128(luma, 8));
+
+        // Horizontal pairs, then the two rows
+        __m128i r = _mm_add_epi32(_mm_madd_epi16(r0, ones), _mm_madd_epi16(r1, ones));
+        __m128i g = _mm_add_epi32(_mm_madd_epi16(g0, ones), _mm_madd_epi16(g1, ones));
+        __m128i b = _mm_add_epi32(_mm_madd_epi16(b0, ones), _mm_madd_epi16(b1, ones));
+        __m128i rg = _mm_unpacklo_epi16(_mm_packs_epi32(r, r), _mm_packs_epi32(g, g));
+        __m128i bz = _mm_unpacklo_epi16(_mm_packs_epi32(b, b), zero);
+
+        __m128i uv = _mm_packs_epi32(ChromaSse2(rg, bz, uRg, uB), ChromaSse2(rg, bz, vRg, vB));
+        uv = _mm_packus_epi16(uv, uv);
+        int uBytes = _mm_cvtsi128_si32(uv);
+        int vBytes = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+        std::memcpy(u + x / 2, &uBytes, 4);
+        std::memcpy(v + x / 2, &vBytes, 4);
+    }
+    RgbaToYuv420Scalar(rgba0 + x * 4, rgba1 + x * 4, luma0 + x, luma1 + x, u + x / 2, v + x / 2, width - x);
+}
+
+// AVX2: vpshufb spreads 4 RGB pixels per 128-bit lane into RGBA slots
+
+__attribute__((target("avx2")))
+inline __m256i LoadRgb8Avx2(const unsigned char* rgb)
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m256i px = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)rgb)),
+        _mm_loadu_si128((const __m128i*)(rgb + 12)), 1);
+    return _mm256_shuffle_epi8(px, shuffle);
+}
+
+__attribute__((target("avx2")))
+void RgbAlphaToRgbaAvx2(const unsigned char* rgb, const unsigned char* alpha, unsigned char* rgba, size_t pixels)
+{
+    size_t i = 0;
+    // Each 8-pixel load reads 28 bytes for 24 used
+    for (; i + 18 <= pixels; i += 16)
+    {
+        for (int k = 0; k < 2; ++k)
+        {
+            size_t p = i + k * 8;
+            __m256i a = _mm256_slli_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(alpha + p))), 24);
+            _mm256_storeu_si256((__m256i*)(rgba + p * 4), _mm256_or_si256(LoadRgb8Avx2(rgb + p * 3), a));
+        }
+    }
+    RgbAlphaToRgbaScalar(rgb + i * 3, alpha + i, rgba + i * 4, pixels - i);
+}
+
+__attribute__((target("avx2")))
+void RgbToRgbaAvx2(const unsigned char* rgb, unsigned char alpha, unsigned char* rgba, size_t pixels)
+{
+    const __m256i a = _mm256_set1_epi32((int)((unsigned int)alpha << 24));
+    size_t i = 0;
+    for (; i + 10 <= pixels; i += 8)
+        _mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_or_si256(LoadRgb8Avx2(rgb + i * 3), a));
+    RgbToRgbaScalar(rgb + i * 3, alpha, rgba + i * 4, pixels - i);
+}
+
+__attribute__((target("avx2")))
+inline __m256i PremultiplyPairAvx2(__m256i px)
+{
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(px, alpha), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+void PremultiplyAlphaAvx2(unsigned char* rgba, size_t pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8)
+    {
+        __m256i px = _mm256_loadu_si256((const __m256i*)(rgba + i * 4));
+        // unpack and pack both work per 128-bit lane, so pixel order is preserved
+        __m256i lo = PremultiplyPairAvx2(_mm256_unpacklo_epi8(px, zero));
+        __m256i hi = PremultiplyPairAvx2(_mm256_unpackhi_epi8(px, zero));
+        __m256i result = _mm256_packus_epi16(lo, hi);
+        result = _mm256_or_si256(_mm256_andnot_si256(alphaMask, result), _mm256_and_si256(alphaMask, px));
+        _mm256_storeu_si256((__m256i*)(rgba + i * 4), result);
+    }
+    PremultiplyAlphaScalar(rgba + i * 4, pixels - i);
+}
+
+__attribute__((target("avx2")))
+void SrgbToLinearAvx2(const unsigned char* rgba, float* linear, size_t pixels)
+{
+    const float* table = GetLinearTable();
+    const __m256i alphaOffset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+    size_t i = 0;
+    // Independent gathers per iteration so their latency overlaps
+    for (; i + 8 <= pixels; i += 8)
+    {
+        __m128i bytes0 = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+        __m128i bytes1 = _mm_loadu_si128((const __m128i*)(rgba + i * 4 + 16));
+        __m256i index[4] = {
+            _mm256_cvtepu8_epi32(bytes0),
+            _mm256_cvtepu8_epi32(_mm_srli_si128(bytes0, 8)),
+            _mm256_cvtepu8_epi32(bytes1),
+            _mm256_cvtepu8_epi32(_mm_srli_si128(bytes1, 8))
+        };
+        for (int k = 0; k < 4; ++k)
+        {
+            __m256 values = _mm256_i32gather_ps(table, _mm256_add_epi32(index[k], alphaOffset), 4);
+            _mm256_storeu_ps(linear + i * 4 + k * 8, values);
+        }
+    }
+    SrgbToLinearScalar(rgba + i * 4, linear + i * 4, pixels - i);
+}
+
+// 16 RGBA pixels -> R, G, B in 16-bit lanes. The pack interleaves the 128-bit
+// lanes (0-3, 8-11, 4-7, 12-15), the permute puts pixels back in order.
+__attribute__((target("avx2")))
+inline void SplitRgba16Avx2(const unsigned char* rgba, __m256i& r, __m256i& g, __m256i& b)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    __m256i lo = _mm256_loadu_si256((const __m256i*)rgba);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(rgba + 32));
+    r = _mm256_packs_epi32(_mm256_and_si256(lo, mask), _mm256_and_si256(hi, mask));
+    g = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(lo, 8), mask), _mm256_and_si256(_mm256_srli_epi32(hi, 8), mask));
+    b = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(lo, 16), mask), _mm256_and_si256(_mm256_srli_epi32(hi, 16), mask));
+    r = _mm256_permute4x64_epi64(r, _MM_SHUFFLE(3, 1, 2, 0));
+    g = _mm256_permute4x64_epi64(g, _MM_SHUFFLE(3, 1, 2, 0));
+    b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+__attribute__((target("avx2")))
+inline __m256i LumaAvx2(__m256i r, __m256i g, __m256i b)
+{
+    __m256i y = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(77)), _mm256_mullo_epi16(g, _mm256_set1_epi16(150)));
+    y = _mm256_add_epi16(y, _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(29)), _mm256_set1_epi16(128)));
+    return _mm256_srli_epi16(y, 8);
+}
+
+__attribute__((target("avx2")))
+inline __m256i ChromaAvx2(__m256i rg, __m256i b0, __m256i rgWeights, __m256i bWeights)
+{
+    __m256i c = _mm256_add_epi32(_mm256_madd_epi16(rg, rgWeights), _mm256_madd_epi16(b0, bWeights));
+    return _mm256_srai_epi32(_mm256_add_epi32(c, _mm256_set1_epi32((128 << 10) + 512)), 10);
+}
+
+__attribute__((target("avx2")))
+void RgbaToYuv420Avx2(const unsigned char* rgba0, const unsigned char* rgba1, unsigned char* luma0, unsigned char* luma1,
+                      unsigned char* u, unsigned char* v, size_t width)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i uRg = _mm256_set1_epi32((int)(((unsigned int)(unsigned short)-85 << 16) | (unsigned short)-43));
+    const __m256i uB = _mm256_set1_epi32(128);
+    const __m256i vRg = _mm256_set1_epi32((int)(((unsigned int)(unsigned short)-107 << 16) | 128));
+    const __m256i vB = _mm256_set1_epi32((unsigned short)-21);
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i r0, g0, b0, r1, g1, b1;
+        SplitRgba16Avx2(rgba0 + x * 4, r0, g0, b0);
+        SplitRgba16Avx2(rgba1 + x * 4, r1, g1, b1);
+
+        // Lane-wise pack gives row0 0-7, row1 0-7, row0 8-15, row1 8-15
+        __m256i luma = _mm256_packus_epi16(LumaAvx2(r0, g0, b0), LumaAvx2(r1, g1, b1));
+        luma = _mm256_permute4x64_epi64(luma, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i*)(luma0 + x), _mm256_castsi256_si128(luma));
+        _mm_storeu_si128((__m128i*)(luma1 + x), _mm256_extracti128_si256(luma, 1));
+
+        __m256i r = _mm256_add_epi32(_mm256_madd_epi16(r0, ones), _mm256_madd_epi16(r1, ones));
+        __m256i g = _mm256_add_epi32(_mm256_madd_epi16(g0, ones), _mm256_madd_epi16(g1, ones));
+        __m256i b = _mm256_add_epi32(_mm256_madd_epi16(b0, ones), _mm256_madd_epi16(b1, ones));
+        __m256i rg = _mm256_unpacklo_epi16(_mm256_packs_epi32(r, r), _mm256_packs_epi32(g, g));
+        __m256i bz = _mm256_unpacklo_epi16(_mm256_packs_epi32(b, b), zero);
+
+        // Lane-wise again: u 0-3, v 0-3 | u 4-7, v 4-7
+        __m256i uv = _mm256_packs_epi32(ChromaAvx2(rg, bz, uRg, uB), ChromaAvx2(rg, bz, vRg, vB));
+        uv = _mm256_permute4x64_epi64(uv, _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(uv), _mm256_extracti128_si256(uv, 1));
+        _mm_storel_epi64((__m128i*)(u + x / 2), bytes);
+        _mm_storel_epi64((__m128i*)(v + x / 2), _mm_srli_si128(bytes, 8));
+    }
+    RgbaToYuv420Scalar(rgba0 + x * 4, rgba1 + x * 4, luma0 + x, luma1 + x, u + x / 2, v + x / 2, width - x);
+}
+
+#endif // PIXELCONVERT_X86
+
+struct Kernels
+{
+    SimdLevel level;
+    void (*rgbAlphaToRgba)(const unsigned char*, const unsigned char*, unsigned char*, size_t);
+    void (*rgbToRgba)(const unsigned char*, unsigned char, unsigned char*, size_t);
+    void (*premultiplyAlpha)(unsigned char*, size_t);
+    void (*srgbToLinear)(const unsigned char*, float*, size_t);
+    void (*rgbaToYuv420)(const unsigned char*, const unsigned char*, unsigned char*, unsigned char*,
+                         unsigned char*, unsigned char*, size_t);
+};
+
+const Kernels kScalarKernels = {
+    SimdLevel::Scalar, RgbAlphaToRgbaScalar, RgbToRgbaScalar, PremultiplyAlphaScalar, SrgbToLinearScalar,
+    RgbaToYuv420Scalar
+};
+
+#ifdef PIXELCONVERT_X86
+// No gather before AVX2, the table lookup is already the scalar path
+const Kernels kSse2Kernels = {
+    SimdLevel::SSE2, RgbAlphaToRgbaSse2, RgbToRgbaSse2, PremultiplyAlphaSse2, SrgbToLinearScalar,
+    RgbaToYuv420Sse2
+};
+
+const Kernels kAvx2Kernels = {
+    SimdLevel::AVX2, RgbAlphaToRgbaAvx2, RgbToRgbaAvx2, PremultiplyAlphaAvx2, SrgbToLinearAvx2,
+    RgbaToYuv420Avx2
+};
+#endif
+
+const Kernels* GetKernelsFor(SimdLevel level)
+{
+#ifdef PIXELCONVERT_X86
+    if (level == SimdLevel::AVX2)
+        return &kAvx2Kernels;
+    if (level == SimdLevel::SSE2)
+        return &kSse2Kernels;
+#endif
+    return &kScalarKernels;
+}
+
+std::atomic<const Kernels*> s_kernels(nullptr);
+
+const Kernels& GetKernels()
+{
+    const Kernels* kernels = s_kernels.load(std::memory_order_acquire);
+    if (!kernels)
+    {
+        kernels = GetKernelsFor(GetSupportedLevel());
+        s_kernels.store(kernels, std::memory_order_release);
+    }
+    return *kernels;
+}
+}
+
+void RgbAlphaToRgba(const unsigned char* rgb, const unsigned char* alpha, unsigned char* rgba, size_t pixels)
+{
+    GetKernels().rgbAlphaToRgba(rgb, alpha, rgba, pixels);
+}
+
+void RgbToRgba(const unsigned char* rgb, unsigned char alpha, unsigned char* rgba, size_t pixels)
+{
+    GetKernels().rgbToRgba(rgb, alpha, rgba, pixels);
+}
+
+void PremultiplyAlpha(unsigned char* rgba, size_t pixels)
+{
+    GetKernels().premultiplyAlpha(rgba, pixels);
+}
+
+void SrgbToLinear(const unsigned char* rgba, float* linear, size_t pixels)
+{
+    GetKernels().srgbToLinear(rgba, linear, pixels);
+}
+
+void RgbaToYuv420(const unsigned char* rgba0, const unsigned char* rgba1, unsigned char* luma0, unsigned char* luma1,
+                  unsigned char* u, unsigned char* v, size_t width)
+{
+    GetKernels().rgbaToYuv420(rgba0, rgba1, luma0, luma1, u, v, width);
+}
+
+SimdLevel GetSupportedLevel()
+{
+#ifdef PIXELCONVERT_X86
+    static const SimdLevel supported = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return SimdLevel::SSE2;
+        return SimdLevel::Scalar;
+    }();
+    return supported;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel GetLevel()
+{
+    return GetKernels().level;
+}
+
+void SetLevel(SimdLevel level)
+{
+    if ((int)level > (int)GetSupportedLevel())
+        level = GetSupportedLevel();
+    s_kernels.store(GetKernelsFor(level), std::memory_order_release);
+}
+
+const char* GetLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+}
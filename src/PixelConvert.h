@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+// Pixel format conversion for texture ingestion. Each kernel has a scalar,
+// SSE2 and AVX2 version; the best one the CPU supports is picked at startup.
+namespace PixelConvert
+{
+enum class SimdLevel
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// RGB (3 bytes/pixel) + separate alpha plane -> RGBA, as wxImage stores it
+void RgbAlphaToRgba(const unsigned char* rgb, const unsigned char* alpha, unsigned char* rgba, size_t pixels);
+// RGB -> RGBA with the same alpha for every pixel
+void RgbToRgba(const unsigned char* rgb, unsigned char alpha, unsigned char* rgba, size_t pixels);
+// In place, color = color * alpha / 255 rounded to nearest
+void PremultiplyAlpha(unsigned char* rgba, size_t pixels);
+// RGBA8 sRGB -> RGBA float linear; alpha is only scaled to [0, 1]
+void SrgbToLinear(const unsigned char* rgba, float* linear, size_t pixels);
+// Two RGBA rows -> two luma rows and one row of 4:2:0 chroma, full range BT.601.
+// Chroma is taken from the average of each 2x2 block; an odd last column
+// counts twice. For an odd last row pass the same row (and luma row) twice.
+void RgbaToYuv420(const unsigned char* rgba0, const unsigned char* rgba1, unsigned char* luma0, unsigned char* luma1,
+                  unsigned char* u, unsigned char* v, size_t width);
+
+SimdLevel GetSupportedLevel();
+SimdLevel GetLevel();
+void SetLevel(SimdLevel level); // Clamped to the supported level, for benchmarks and comparisons
+const char* GetLevelName(SimdLevel level);
+}
@@ -0,0 +1,200 @@
+#include <GL/glew.h>
+#include "RenderQueue.h"
+#include "GLStateCache.h"
+#include <algorithm>
+#include <cstring>
+
+void DrawCommand::SetUniform(int location, int value)
+{
+    if (uniformCount >= kMaxUniforms)
+        return;
+    Uniform& uniform = uniforms[uniformCount++];
+    uniform.location = location;
+    uniform.type = Int1;
+    uniform.i = value;
+}
+
+void DrawCommand::SetUniform(int location, float value)
+{
+    if (uniformCount >= kMaxUniforms)
+        return;
+    Uniform& uniform = uniforms[uniformCount++];
+    uniform.location = location;
+    uniform.type = Float1;
+    uniform.f[0] = value;
+}
+
+void DrawCommand::SetUniform(int location, float x, float y)
+{
+    if (uniformCount >= kMaxUniforms)
+        return;
+    Uniform& uniform = uniforms[uniformCount++];
+    uniform.location = location;
+    uniform.type = Float2;
+    uniform.f[0] = x;
+    uniform.f[1] = y;
+}
+
+RenderQueue::RenderQueue()
+    : m_sorted(true)
+{
+}
+
+uint64_t RenderQueue::MakeKey(unsigned int layer, unsigned int program, unsigned int texture,
+                              unsigned int vertexArray, unsigned int depth)
+{
+    return ((uint64_t)(layer & 0xFF) << 56)
+        | ((uint64_t)(program & 0xFFF) << 44)
+        | ((uint64_t)(texture & 0x3FFF) << 30)
+        | ((uint64_t)(vertexArray & 0x3FFF) << 16)
+        | (uint64_t)(depth & 0xFFFF);
+}
+
+void RenderQueue::Clear()
+{
+    m_items.clear();
+    m_commands.clear();
+    m_sorted = true;
+}
+
+DrawCommand& RenderQueue::Push(uint64_t key)
+{
+    m_items.push_back(SortItem{ key, (uint32_t)m_commands.size() });
+    m_commands.emplace_back();
+
+    DrawCommand& command = m_commands.back();
+    std::memset(&command, 0, sizeof(command));
+    command.primitive = GL_TRIANGLES;
+    m_sorted = m_items.size() == 1 || (m_sorted && m_items[m_items.size() - 2].key <= key);
+    return command;
+}
+
+void RenderQueue::Sort()
+{
+    if (m_sorted)
+        return;
+
+    size_t count = m_items.size();
+    m_scratch.resize(count);
+
+    // All eight byte histograms in one pass over the keys
+    size_t histograms[8][256] = {};
+    for (const SortItem& item : m_items)
+    {
+        for (int byte = 0; byte < 8; ++byte)
+            ++histograms[byte][(item.key >> (byte * 8)) & 0xFF];
+    }
+
+    SortItem* source = m_items.data();
+    SortItem* target = m_scratch.data();
+    for (int byte = 0; byte < 8; ++byte)
+    {
+        size_t* histogram = histograms[byte];
+
+        // Every key has the same value in this byte (unused fields): nothing to move
+        if (histogram[(source[0].key >> (byte * 8)) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket)
+        {
+            size_t bucketSize = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketSize;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const SortItem& item = source[i];
+            target[histogram[(item.key >> (byte * 8)) & 0xFF]++] = item;
+        }
+        std::swap(source, target);
+    }
+
+    if (source != m_items.data())
+        m_items.swap(m_scratch);
+    m_sorted = true;
+}
+
+RenderQueue::SubmitStats RenderQueue::Submit(GLStateCache& state) const
+{
+    return SubmitRange(state, 0, m_items.size());
+}
+
+RenderQueue::SubmitStats RenderQueue::SubmitLayer(GLStateCache& state, unsigned int layer) const
+{
+    uint64_t first = (uint64_t)layer << 56;
+    uint64_t last = first | 0x00FFFFFFFFFFFFFFull;
+    auto begin = std::lower_bound(m_items.begin(), m_items.end(), first,
+                                  [](const SortItem& item, uint64_t key) { return item.key < key; });
+    auto end = std::upper_bound(begin, m_items.end(), last,
+                                [](uint64_t key, const SortItem& item) { return key < item.key; });
+    return SubmitRange(state, begin - m_items.begin(), end - m_items.begin());
+}
+
+RenderQueue::SubmitStats RenderQueue::SubmitRange(GLStateCache& state, size_t begin, size_t end) const
+{
+    SubmitStats stats = { 0, 0 };
+    for (size_t i = begin; i < end; ++i)
+    {
+        const DrawCommand& command = m_commands[m_items[i].command];
+
+        state.UseProgram(command.program);
+        if (command.texture)
+        {
+            state.ActiveTexture(GL_TEXTURE0);
+            state.BindTexture2D(command.texture);
+        }
+        state.BindVertexArray(command.vertexArray);
+        state.SetDepthTest(command.depthTest);
+
+        for (int u = 0; u < command.uniformCount; ++u)
+        {
+            const DrawCommand::Uniform& uniform = command.uniforms[u];
+            switch (uniform.type)
+            {
+                case DrawCommand::Int1: state.Uniform1i(uniform.location, uniform.i); break;
+                case DrawCommand::Float1: state.Uniform1f(uniform.location, uniform.f[0]); break;
+                case DrawCommand::Float2: state.Uniform2f(uniform.location, uniform.f[0], uniform.f[1]); break;
+            }
+        }
+
+        const float* values = command.attributeValues;
+        for (int a = 0; a < command.attributeCount; ++a)
+        {
+            const ConstantAttribute& attribute = command.attributeLayout[a];
+            switch (attribute.components)
+            {
+                case 1: glVertexAttrib1fv(attribute.location, values); break;
+                case 2: glVertexAttrib2fv(attribute.location, values); break;
+                case 3: glVertexAttrib3fv(attribute.location, values); break;
+                case 4: glVertexAttrib4fv(attribute.location, values); break;
+            }
+            values += attribute.components;
+        }
+
+        size_t primitives = command.primitive == GL_TRIANGLES ? command.count / 3 : 0;
+        if (command.indexType)
+        {
+            size_t indexSize = command.indexType == GL_UNSIGNED_INT ? 4 : command.indexType == GL_UNSIGNED_SHORT ? 2 : 1;
+            const void* offset = (const void*)((size_t)command.first * indexSize);
+            if (command.instances > 0)
+                glDrawElementsInstanced(command.primitive, command.count, command.indexType, offset, command.instances);
+            else
+                glDrawElements(command.primitive, command.count, command.indexType, offset);
+            stats.triangles += primitives * std::max(command.instances, 1);
+        }
+        else if (command.instances > 0)
+        {
+            glDrawArraysInstanced(command.primitive, command.first, command.count, command.instances);
+            stats.triangles += primitives * command.instances;
+        }
+        else
+        {
+            glDrawArrays(command.primitive, command.first, command.count);
+            stats.triangles += primitives;
+        }
+        ++stats.drawCalls;
+    }
+    return stats;
+}
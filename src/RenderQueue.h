@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GLStateCache;
+
+// Constant vertex attribute set with glVertexAttrib*fv before a draw
+struct ConstantAttribute
+{
+    unsigned int location;
+    int components; // 1..4
+};
+
+// Everything needed to issue one draw. Plain data so the queue can be
+// refilled every frame without allocating.
+struct DrawCommand
+{
+    static const int kMaxUniforms = 4;
+
+    enum UniformType : unsigned char
+    {
+        Int1,
+        Float1,
+        Float2
+    };
+
+    struct Uniform
+    {
+        int location;
+        UniformType type;
+        union
+        {
+            int i;
+            float f[2];
+        };
+    };
+
+    unsigned int program;
+    unsigned int vertexArray;
+    unsigned int texture;      // GL_TEXTURE_2D on unit 0, 0 = leave as is
+    unsigned int primitive;    // GL_TRIANGLES, ...
+    int first, count;
+    int instances;             // 0 = glDrawArrays, otherwise glDrawArraysInstanced
+    unsigned int indexType;    // 0 = arrays; GL_UNSIGNED_INT etc. = glDrawElements from the
+                               // vertex array's index buffer, first and count in indices
+    bool depthTest;            // Off unless set
+
+    Uniform uniforms[kMaxUniforms];
+    int uniformCount;
+
+    const ConstantAttribute* attributeLayout; // Optional
+    int attributeCount;
+    const float* attributeValues;             // Packed in layout order
+
+    void SetUniform(int location, int value);
+    void SetUniform(int location, float value);
+    void SetUniform(int location, float x, float y);
+};
+
+// Per-frame list of draws. Each one carries a 64-bit sort key
+//   layer:8 | program:12 | texture:14 | vertexArray:14 | depth:16
+// and the queue is radix-sorted on it, so draws sharing a program, texture and
+// vertex array end up next to each other and the state cache skips the rebinds.
+// GL names are truncated into their fields; a collision only costs batching.
+class RenderQueue
+{
+public:
+    struct SubmitStats
+    {
+        unsigned int drawCalls;
+        size_t triangles;
+    };
+
+    RenderQueue();
+
+    static uint64_t MakeKey(unsigned int layer, unsigned int program, unsigned int texture,
+                            unsigned int vertexArray, unsigned int depth);
+    static unsigned int GetLayer(uint64_t key) { return (unsigned int)(key >> 56); }
+
+    void Clear(); // Keeps capacity
+    DrawCommand& Push(uint64_t key);
+    size_t GetSize() const { return m_items.size(); }
+
+    // Stable LSD radix sort on the key; without it draws go out in push order
+    void Sort();
+
+    SubmitStats Submit(GLStateCache& state) const;
+    // Requires Sort(); one layer at a time, e.g. to wrap passes in timer queries
+    SubmitStats SubmitLayer(GLStateCache& state, unsigned int layer) const;
+
+private:
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t command;
+    };
+
+    SubmitStats SubmitRange(GLStateCache& state, size_t begin, size_t end) const;
+
+    std::vector<SortItem> m_items;
+    std::vector<SortItem> m_scratch;
+    std::vector<DrawCommand> m_commands;
+    bool m_sorted;
+};
@@ -0,0 +1,249 @@
+#include "RenderThread.h"
+#include "Renderer.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+
+RenderThread::RenderThread()
+    : m_renderer(nullptr)
+    , m_frameTimeNext(0)
+    , m_frameCount(0)
+    , m_overflowing(false)
+    , m_frameRequested(false)
+    , m_stopRequested(false)
+    , m_running(false)
+{
+    m_frameTimes.reserve(kFrameHistorySize);
+}
+
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+bool RenderThread::Start(Renderer* renderer, const Callbacks& callbacks)
+{
+    if (m_thread.joinable() || !renderer)
+        return false;
+
+    m_renderer = renderer;
+    m_callbacks = callbacks;
+    m_frameRequested = false;
+    m_stopRequested = false;
+    m_running = true;
+    m_thread = std::thread(&RenderThread::Run, this);
+    return true;
+}
+
+void RenderThread::Stop()
+{
+    if (!m_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopRequested = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+bool RenderThread::IsRunning() const
+{
+    return m_running;
+}
+
+void RenderThread::Post(const RenderCommand& command)
+{
+    // Keep order: nothing new goes into the ring while older commands wait outside it
+    if (!m_overflowing.load(std::memory_order_acquire) && m_commands.Push(command))
+        return;
+    std::lock_guard<std::mutex> lock(m_overflowMutex);
+    m_overflow.push_back(command);
+    m_overflowing.store(true, std::memory_order_release);
+}
+
+void RenderThread::RequestFrame()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_frameRequested = true;
+    }
+    m_wake.notify_one();
+}
+
+void RenderThread::Wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_frameRequested = true;
+    }
+    m_wake.notify_one();
+}
+
+LatencyMonitor& RenderThread::GetLatencyMonitor()
+{
+    return m_latency;
+}
+
+PassTimingStats RenderThread::GetFrameTimeStats() const
+{
+    PassTimingStats stats = { 0.0, 0.0, 0.0, 0 };
+    std::vector<double> sorted;
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        sorted = m_frameTimes;
+    }
+    if (sorted.empty())
+        return stats;
+
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double ms : sorted)
+        total += ms;
+
+    size_t p99Index = std::min(sorted.size() - 1, (size_t)(0.99 * (sorted.size() - 1) + 0.5));
+    stats.minMs = sorted.front();
+    stats.avgMs = total / sorted.size();
+    stats.p99Ms = sorted[p99Index];
+    stats.samples = sorted.size();
+    return stats;
+}
+
+unsigned long RenderThread::GetFrameCount() const
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_frameCount;
+}
+
+void RenderThread::ResetFrameTimeStats()
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_frameTimes.clear();
+    m_frameTimeNext = 0;
+    m_frameCount = 0;
+}
+
+void RenderThread::ApplyCommands()
+{
+    TRACE_SCOPE("RenderThread::ApplyCommands");
+    RenderCommand command;
+    std::vector<RenderCommand> overflow;
+    while (true)
+    {
+        while (m_commands.Pop(command))
+            ApplyCommand(command);
+        if (!m_overflowing.load(std::memory_order_acquire))
+            break;
+
+        // The ring holds only commands older than the overflow while it is in use
+        {
+            std::lock_guard<std::mutex> lock(m_overflowMutex);
+            while (m_commands.Pop(command))
+                ApplyCommand(command);
+            overflow.swap(m_overflow);
+            m_overflowing.store(false, std::memory_order_release);
+        }
+        for (const RenderCommand& queued : overflow)
+            ApplyCommand(queued);
+        overflow.clear();
+    }
+}
+
+void RenderThread::ApplyCommand(const RenderCommand& command)
+{
+    // One sample per input event, however many commands it posted
+    if (command.inputTime && (m_frameInputs.empty() || m_frameInputs.back() != command.inputTime))
+        m_frameInputs.push_back(command.inputTime);
+
+    switch (command.type)
+    {
+        case RenderCommand::SetRotation:
+            m_renderer->SetRotation(command.rotation);
+            break;
+        case RenderCommand::SetTriangleVisible:
+            m_renderer->SetTriangleVisible(command.flag);
+            break;
+        case RenderCommand::SetVertexColor:
+            m_renderer->SetVertexColor(command.color.index, command.color.r, command.color.g, command.color.b);
+            break;
+        case RenderCommand::SetUseCustomColor:
+            m_renderer->SetUseCustomColor(command.flag);
+            break;
+        case RenderCommand::SetViewport:
+            m_renderer->SetViewport(command.viewport.width, command.viewport.height);
+            break;
+        case RenderCommand::SetButtonHovered:
+            m_renderer->SetButtonHovered((size_t)command.hover.index, command.hover.hovered);
+            break;
+        case RenderCommand::SetGpuPicking:
+            m_renderer->SetGpuPicking(command.flag);
+            break;
+        case RenderCommand::SetPickPoint:
+            m_renderer->SetPickPoint(command.point.x, command.point.y);
+            break;
+        case RenderCommand::MarkInput:
+            break;
+    }
+}
+
+void RenderThread::Run()
+{
+    TRACE_THREAD_NAME("Render");
+    bool initialized = m_callbacks.initialize && m_callbacks.initialize();
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            auto woken = [this]() { return m_frameRequested || m_stopRequested; };
+
+            // Pick and capture readbacks and latency fences in flight are collected
+            // as soon as the GPU is done, without a new frame
+            while (initialized && !woken() &&
+                   (m_renderer->HasPendingPicks() || m_renderer->HasPendingCaptures() || m_latency.HasPending()))
+            {
+                if (m_wake.wait_for(lock, std::chrono::milliseconds(1), woken))
+                    break;
+                lock.unlock();
+                m_renderer->CollectPicks();
+                m_renderer->CollectCaptures();
+                m_latency.Collect();
+                lock.lock();
+            }
+
+            m_wake.wait(lock, woken);
+            if (m_stopRequested)
+                break;
+            m_frameRequested = false;
+        }
+
+        // Commands posted while the previous frame rendered are applied in one go
+        auto frameStart = std::chrono::steady_clock::now();
+        ApplyCommands();
+        if (initialized)
+        {
+            m_latency.Collect();
+            m_renderer->Render();
+            if (m_callbacks.present)
+                m_callbacks.present();
+            m_latency.FramePresented(m_frameInputs);
+
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            if (m_frameTimes.size() < kFrameHistorySize)
+                m_frameTimes.push_back(ms);
+            else
+                m_frameTimes[m_frameTimeNext] = ms;
+            m_frameTimeNext = (m_frameTimeNext + 1) % kFrameHistorySize;
+            ++m_frameCount;
+        }
+        m_frameInputs.clear();
+    }
+
+    if (initialized)
+        m_latency.Release();
+    if (m_callbacks.shutdown)
+        m_callbacks.shutdown();
+    m_running = false;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "GpuProfiler.h"
+#include "LatencyMonitor.h"
+#include "SpscQueue.h"
+
+class Renderer;
+
+// State change sent from the UI thread to the render thread
+struct RenderCommand
+{
+    enum Type
+    {
+        SetRotation,
+        SetTriangleVisible,
+        SetVertexColor,
+        SetUseCustomColor,
+        SetViewport,
+        SetButtonHovered,
+        SetGpuPicking,
+        SetPickPoint,
+        MarkInput // No state change, only carries inputTime into the next frame
+    };
+
+    Type type;
+    uint64_t inputTime = 0; // LatencyMonitor::Now() when the input event arrived, 0 = not input
+    union
+    {
+        float rotation;
+        bool flag; // Visible, use custom color, GPU picking
+        struct { int index; bool hovered; } hover;
+        struct { int index; float r, g, b; } color;
+        struct { int width, height; } viewport;
+        struct { int x, y; } point;
+    };
+};
+
+// Owns the GL context on its own thread. The UI thread posts commands
+// (lock-free unless the ring is full) and requests frames. The only Renderer
+// calls made from the UI thread are the thread-safe Pick() (hit testing on
+// mouse events) and GetPassTimings() (stats); everything else, GL above all,
+// goes through commands.
+class RenderThread
+{
+public:
+    struct Callbacks
+    {
+        std::function<bool()> initialize; // Make the context current, load GL, Renderer::Initialize
+        std::function<void()> present;    // Swap buffers after Render()
+        std::function<void()> shutdown;   // Release GL resources while the context is current
+    };
+
+    RenderThread();
+    ~RenderThread();
+
+    bool Start(Renderer* renderer, const Callbacks& callbacks);
+    void Stop();
+    bool IsRunning() const;
+
+    // UI thread only
+    void Post(const RenderCommand& command);
+    void RequestFrame();
+
+    // Any thread, e.g. a finished background job; renders without flushing posted commands
+    void Wake();
+
+    // Stats are readable from any thread
+    LatencyMonitor& GetLatencyMonitor();
+    PassTimingStats GetFrameTimeStats() const; // CPU wall time per frame: commands, Render, present
+    unsigned long GetFrameCount() const;       // Since the last reset
+    void ResetFrameTimeStats();
+
+private:
+    void Run();
+    void ApplyCommands();
+    void ApplyCommand(const RenderCommand& command);
+
+    Renderer* m_renderer;
+    Callbacks m_callbacks;
+    LatencyMonitor m_latency;
+    std::vector<uint64_t> m_frameInputs; // Input times of the commands in the frame being drawn
+
+    static const size_t kFrameHistorySize = 1000;
+    mutable std::mutex m_statsMutex;
+    std::vector<double> m_frameTimes; // Rolling, ms
+    size_t m_frameTimeNext;
+    unsigned long m_frameCount;
+    std::thread m_thread;
+
+    // Once the ring is full, commands queue here until the render thread has
+    // taken them, so nothing posted after them can overtake them
+    SpscQueue<RenderCommand, 1024> m_commands;
+    std::mutex m_overflowMutex;
+    std::vector<RenderCommand> m_overflow;
+    std::atomic<bool> m_overflowing;
+
+    // Wakeup only; commands themselves never take the lock
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    bool m_frameRequested;
+    bool m_stopRequested;
+    std::atomic<bool> m_running;
+};
@@ -1,112 +1,39 @@
 #include <GL/glew.h>
 #include "Renderer.h"
-#include <wx/image.h>
+#include "JobSystem.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "Shaders.h"
+#include "Trace.h"
 #include <wx/log.h>
 #include <cmath>
-
-const std::string triangleVertexShader = R"(
-#version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aColor;
-
-uniform float rotation;
-uniform bool useFixedSize;
-uniform vec2 viewport;
-uniform float fixedSize;
-
-out vec3 vertexColor;
-
-void main()
-{
-    vec3 pos = aPos;
-    
-    float cosR = cos(radians(rotation));
-    float sinR = sin(radians(rotation));
-    
-    mat2 rotMatrix = mat2(cosR, -sinR, sinR, cosR);
-    vec2 rotatedPos = rotMatrix * pos.xy;
-    
-    if (useFixedSize) {
-        float aspectRatio = viewport.x / viewport.y;
-        float scale = fixedSize / min(viewport.x, viewport.y);
-        
-        rotatedPos *= scale;
-        
-        if (aspectRatio > 1.0) {
-            rotatedPos.x /= aspectRatio;
-        } else {
-            rotatedPos.y *= aspectRatio;
-        }
-    }
-    
-    gl_Position = vec4(rotatedPos, pos.z, 1.0);
-    vertexColor = aColor;
-}
-)";
-
-const std::string triangleFragmentShader = R"(
-#version 330 core
-in vec3 vertexColor;
-out vec4 FragColor;
-
-void main()
-{
-    FragColor = vec4(vertexColor, 1.0);
-}
-)";
-
-const std::string buttonVertexShader = R"(
-#version 330 core
-layout (location = 0) in vec2 aPos;
-layout (location = 1) in vec2 aTexCoord;
-
-uniform vec2 viewport;
-uniform vec2 buttonPos;
-uniform vec2 buttonSize;
-
-out vec2 TexCoord;
-
-void main()
-{
-    vec2 pixelPos = buttonPos + aPos * buttonSize;
-    vec2 normalizedPos = (pixelPos / viewport) * 2.0 - 1.0;
-    normalizedPos.y = -normalizedPos.y;
-    
-    gl_Position = vec4(normalizedPos, 0.0, 1.0);
-    TexCoord = aTexCoord;
-}
-)";
-
-const std::string buttonFragmentShader = R"(
-#version 330 core
-in vec2 TexCoord;
-out vec4 FragColor;
-
-uniform sampler2D buttonTexture;
-uniform bool hovered;
-
-void main()
-{
-    vec4 texColor = texture(buttonTexture, TexCoord);
-    if (hovered)
-    {
-        FragColor = texColor * vec4(1.15, 1.15, 1.15, 1.0); // Button hover
-    }
-    else
-    {
-        FragColor = texColor;
-    }
-}
-)";
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <limits>
 
 Renderer::Renderer()
-    : m_triangleVAO(0), m_triangleVBO(0), m_triangleShaderProgram(0)
-    , m_buttonVAO(0), m_buttonVBO(0), m_buttonShaderProgram(0)
+    : m_frameUBO(0)
+    , m_shaderCacheEnabled(true)
+    , m_textureBindingGeneration(0)
+    , m_triangleVAO(0), m_triangleVBO(0)
+    , m_instanceVAO(0), m_instanceVBO(0), m_perObjectVAO(0)
+    , m_spriteVAO(0), m_spriteVBO(0), m_spriteEBO(0), m_spriteIndexQuads(0)
+    , m_spritesDirty(true)
+    , m_fixedTriangleSize(800.0f)  // Triangle size
+    , m_useFixedSize(true)   
     , m_rotation(0.0f), m_triangleVisible(false)
     , m_viewportWidth(800), m_viewportHeight(600)
     , m_useCustomColor(false)
-    , m_fixedTriangleSize(800.0f)  // Triangle size
-    , m_useFixedSize(true)   
+    , m_instancedRendering(true)
+    , m_meshVAO(0), m_meshVBO(0), m_meshEBO(0)
+    , m_meshIndexCount(0)
+    , m_meshOptimization(true)
+    , m_buttonIndexDirty(true), m_triangleIndexDirty(true)
+    , m_gpuPicking(false)
+    , m_pickX(-1), m_pickY(-1)
+    , m_pickPointChanged(false)
 {
     // Vertex colors by default
     // Up - red
@@ -116,27 +43,42 @@ Renderer::Renderer()
     // right - blue
     m_vertexColors.vertex3[0] = 0.0f; m_vertexColors.vertex3[1] = 0.0f; m_vertexColors.vertex3[2] = 1.0f;
     
-    // button
-    m_button.x = -0.7f;
-    m_button.y = 0.7f;
-    m_button.width = 0.15f;
-    m_button.height = 0.15f;
-    m_button.hovered = false;
-    m_button.textureId = 0;
+    // Main button, 60x60 pixels near the top-left corner
+    m_buttons.push_back(ButtonData{ 20.0f, 20.0f, 60.0f, 60.0f, false, "icon/button_icon.png" });
+    
+    m_frameStats.drawCalls = 0;
+    m_frameStats.triangles = 0;
+    m_frameStats.stateChanges = 0;
+    m_frameStats.stateChangesSkipped = 0;
+    
+    m_triangleStream = StreamedVertices{ false, false, false };
+    m_instanceStream = StreamedVertices{ false, false, false };
+    m_spriteStream = StreamedVertices{ false, false, false };
+    
+    m_meshStats = MeshStats{ 0, 0, 0, 0.0, 0.0, 0.0, false };
 }
 
 Renderer::~Renderer()
 {
-    // Clear OpenGL
+    // Clear OpenGL (programs are released by ShaderProgram)
+    if (m_frameUBO) glDeleteBuffers(1, &m_frameUBO);
+    
     if (m_triangleVAO) glDeleteVertexArrays(1, &m_triangleVAO);
     if (m_triangleVBO) glDeleteBuffers(1, &m_triangleVBO);
-    if (m_triangleShaderProgram) glDeleteProgram(m_triangleShaderProgram);
     
-    if (m_buttonVAO) glDeleteVertexArrays(1, &m_buttonVAO);
-    if (m_buttonVBO) glDeleteBuffers(1, &m_buttonVBO);
-    if (m_buttonShaderProgram) glDeleteProgram(m_buttonShaderProgram);
+    if (m_instanceVAO) glDeleteVertexArrays(1, &m_instanceVAO);
+    if (m_instanceVBO) glDeleteBuffers(1, &m_instanceVBO);
+    if (m_perObjectVAO) glDeleteVertexArrays(1, &m_perObjectVAO);
+    
+    if (m_spriteVAO) glDeleteVertexArrays(1, &m_spriteVAO);
+    if (m_spriteVBO) glDeleteBuffers(1, &m_spriteVBO);
+    if (m_spriteEBO) glDeleteBuffers(1, &m_spriteEBO);
+    
+    ClearMesh();
     
-    if (m_button.textureId) glDeleteTextures(1, &m_button.textureId);
+    // Atlas texture belongs to the loader
+    m_textureLoader.Shutdown();
+    m_capture.Stop();
 }
 
 bool Renderer::Initialize()
@@ -147,6 +89,14 @@ bool Renderer::Initialize()
     // Main windows background
     glClearColor(0.4f, 0.4f, 0.4f, 1.0f);
     
+    m_startTime = std::chrono::steady_clock::now();
+    
+    // Expected on drivers without binary formats (e.g. llvmpipe), so not a warning dialog at every start
+    if (m_shaderCacheEnabled && !m_shaderCache.Initialize(m_shaderCacheDirectory))
+    {
+        wxLogVerbose("Program binaries unavailable, shaders are compiled on every start");
+    }
+    
     if (!InitializeShaders())
     {
         wxLogError("Failed to initialize shaders");
@@ -159,37 +109,118 @@ bool Renderer::Initialize()
         return false;
     }
     
-    if (!LoadButtonTexture())
+    if (!m_textureLoader.Initialize())
+    {
+        wxLogError("Failed to start texture loader");
+        return false;
+    }
+    
+    if (!LoadIconAtlas())
     {
-        wxLogError("Failed to load button texture");
+        wxLogError("Failed to load button icons");
         return false;
     }
     
+    if (!m_profiler.Initialize())
+    {
+        wxLogWarning("GPU timer queries unavailable, pass timings disabled");
+    }
+    
     return true;
 }
 
 void Renderer::Render()
 {
-    glClear(GL_COLOR_BUFFER_BIT);
+    TRACE_SCOPE("Renderer::Render");
+    m_frameStats.drawCalls = 0;
+    m_frameStats.triangles = 0;
+    m_state.ResetStats();
+    m_profiler.BeginFrame();
+    m_idPicker.Collect();
+    m_capture.Collect();
+    
+    // Uploads bind textures behind the cache's back
+    m_textureLoader.Update();
+    if (m_textureLoader.GetBindingGeneration() != m_textureBindingGeneration)
+    {
+        m_state.InvalidateTextures();
+        m_textureBindingGeneration = m_textureLoader.GetBindingGeneration();
+    }
+    
+    // Only meshes draw with depth testing
+    glClear(m_meshIndexCount > 0 ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT);
+    UpdateFrameUniforms();
+    UploadDynamicGeometry();
     
+    // Draws go through the queue so they reach the driver grouped by state
+    m_queue.Clear();
     if (m_triangleVisible)
     {
-        RenderTriangle();
+        if (m_meshIndexCount > 0)
+            QueueMesh();
+        else if (!m_instances.empty())
+            QueueTriangleInstances();
+        else
+            QueueTriangle();
     }
+    QueueButtons();
+    
+    // Id pass only when the answer can have changed
+    bool pickPass = m_gpuPicking && (m_pickPointChanged || m_triangleIndexDirty) && InitializePickShaders();
+    if (pickPass && m_triangleVisible && m_meshIndexCount == 0)
+        QueuePickTriangles();
+    m_queue.Sort();
     
-    RenderButton();
+    if (m_triangleVisible)
+    {
+        m_profiler.BeginPass(RenderPass::Triangle);
+        SubmitLayer(kSceneLayer);
+        m_profiler.EndPass(RenderPass::Triangle);
+    }
+    
+    m_profiler.BeginPass(RenderPass::Button);
+    SubmitLayer(kInterfaceLayer);
+    m_profiler.EndPass(RenderPass::Button);
+    
+    // Not counted in the frame stats, it is not part of the picture
+    if (pickPass)
+    {
+        m_pickPointChanged = false;
+        if (m_idPicker.Resize(m_viewportWidth, m_viewportHeight) && m_idPicker.BeginPass(m_pickX, m_pickY))
+        {
+            m_queue.SubmitLayer(m_state, kPickLayer);
+            m_idPicker.EndPass();
+        }
+        else
+        {
+            m_idPicker.ClearResult();
+        }
+    }
+    
+    // Same framebuffer the frame went to; the pick pass has put it back
+    m_capture.Capture(m_viewportWidth, m_viewportHeight);
+    
+    m_streamBuffer.EndFrame();
+    UpdatePickIndices();
+    
+    m_frameStats.stateChanges = m_state.GetStats().issued;
+    m_frameStats.stateChangesSkipped = m_state.GetStats().skipped;
 }
 
 void Renderer::SetViewport(int width, int height)
 {
     m_viewportWidth = width;
     m_viewportHeight = height;
+    m_triangleIndexDirty = true;
     glViewport(0, 0, width, height);
 }
 
 void Renderer::SetRotation(float rotation)
 {
     m_rotation = rotation;
+    // Instances carry their own rotation
+    if (m_instances.empty())
+        m_triangleIndexDirty = true;
 }
 
 void Renderer::SetUseCustomColor(bool useCustom)
@@ -240,18 +271,197 @@ void Renderer::UpdateTriangleGeometry()
                              m_useCustomColor ? m_vertexColors.vertex3[2] : 1.0f  // Right
     };
     
-    // update VBO
-    if (m_triangleVBO != 0)
+    // Uploaded by the next Render()
+    std::copy(triangleVertices, triangleVertices + 18, m_triangleVertices);
+    m_triangleStream.dirty = true;
+    m_triangleIndexDirty = true;
+}
+
+void Renderer::SetTriangleInstances(const std::vector<TriangleInstance>& instances)
+{
+    // Uploaded on the next frame so callers don't need the context current
+    m_instances = instances;
+    m_instanceStream.dirty = true;
+    m_triangleIndexDirty = true;
+}
+
+void Renderer::SetInstancedRendering(bool enabled)
+{
+    m_instancedRendering = enabled;
+}
+
+size_t Renderer::GetTriangleInstanceCount() const
+{
+    return m_instances.size();
+}
+
+bool Renderer::LoadMesh(const std::string& path)
+{
+    TRACE_SCOPE("Renderer::LoadMesh");
+    if (!InitializeMeshShader())
+        return false;
+    
+    MeshStats stats = { 0, 0, 0, 0.0, 0.0, 0.0, false };
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    // Native files stay in their mapping; everything else is parsed into memory
+    MeshFile file;
+    MeshData mesh;
+    const unsigned char* positions;
+    const unsigned char* indices;
+    size_t positionsOffset = 0, indicesOffset = 0; // In the mapping, for releasing uploaded pages
+    const float* bounds[2];
+    if (MeshFile::IsMeshFile(path))
+    {
+        if (!file.Open(path))
+            return false;
+        positions = (const unsigned char*)file.GetPositions();
+        indices = (const unsigned char*)file.GetIndices();
+        positionsOffset = (size_t)file.GetHeader().positionsOffset;
+        indicesOffset = (size_t)file.GetHeader().indicesOffset;
+        stats.vertices = file.GetVertexCount();
+        stats.triangles = file.GetIndexCount() / 3;
+        stats.fileBytes = file.GetFileSize();
+        stats.mapped = file.GetMapping().IsMapped();
+        bounds[0] = file.GetHeader().boundsMin;
+        bounds[1] = file.GetHeader().boundsMax;
+    }
+    else
+    {
+        if (!MeshLoader::Load(path, mesh, &JobSystem::GetShared()))
+            return false;
+        if (m_meshOptimization)
+        {
+            std::chrono::steady_clock::time_point optimizeStart = std::chrono::steady_clock::now();
+            MeshOptimizer::Optimize(mesh);
+            stats.optimizeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - optimizeStart).count();
+        }
+        positions = (const unsigned char*)mesh.positions.data();
+        indices = (const unsigned char*)mesh.indices.data();
+        stats.vertices = mesh.GetVertexCount();
+        stats.triangles = mesh.GetTriangleCount();
+        std::error_code error;
+        stats.fileBytes = (size_t)std::filesystem::file_size(path, error);
+        bounds[0] = mesh.boundsMin;
+        bounds[1] = mesh.boundsMax;
+    }
+    stats.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() - stats.optimizeMs;
+    
+    if (stats.triangles == 0 || stats.triangles * 3 > (size_t)std::numeric_limits<int>::max())
+    {
+        wxLogError("%s: %zu triangles, cannot draw that", path, stats.triangles);
+        return false;
+    }
+    
+    ClearMesh();
+    start = std::chrono::steady_clock::now();
+    glGenVertexArrays(1, &m_meshVAO);
+    glGenBuffers(1, &m_meshVBO);
+    glGenBuffers(1, &m_meshEBO);
+    m_state.BindVertexArray(m_meshVAO);
+    
+    // Slices keep the driver's staging copies small, and let the mapped pages
+    // go as soon as GL has them. Parsed indices were checked by the loader,
+    // file ones are checked slice by slice on the way.
+    bool indicesValid = true;
+    auto upload = [&](unsigned int target, const unsigned char* data, size_t size, size_t fileOffset, bool checkIndices) {
+        glBufferData(target, size, nullptr, GL_STATIC_DRAW);
+        for (size_t offset = 0; offset < size && indicesValid; offset += kMeshUploadSlice)
+        {
+            size_t sliceSize = std::min(kMeshUploadSlice, size - offset);
+            if (checkIndices && !MeshLoader::IndicesInRange((const uint32_t*)(data + offset), sliceSize / sizeof(uint32_t),
+                                                           stats.vertices, &JobSystem::GetShared()))
+                indicesValid = false;
+            else
+                glBufferSubData(target, offset, sliceSize, data + offset);
+            if (file.GetMapping().IsMapped())
+                file.GetMapping().Release(fileOffset + offset, sliceSize);
+        }
+    };
+    
+    glBindBuffer(GL_ARRAY_BUFFER, m_meshVBO);
+    upload(GL_ARRAY_BUFFER, positions, stats.vertices * 3 * sizeof(float), positionsOffset, false);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // The element buffer binding belongs to the vertex array
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_meshEBO);
+    upload(GL_ELEMENT_ARRAY_BUFFER, indices, stats.triangles * 3 * sizeof(uint32_t), indicesOffset, file.GetMapping().IsOpen());
+    m_state.BindVertexArray(0);
+    
+    if (!indicesValid)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, m_triangleVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(triangleVertices), triangleVertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        wxLogError("%s: face refers to a missing vertex", path);
+        ClearMesh();
+        return false;
     }
+    stats.uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    float radius = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float half = 0.5f * (bounds[1][axis] - bounds[0][axis]);
+        m_meshFit[axis] = bounds[0][axis] + half;
+        radius += half * half;
+    }
+    radius = std::sqrt(radius);
+    m_meshFit[3] = radius > 0.0f ? 1.0f / radius : 1.0f;
+    
+    m_meshIndexCount = (int)(stats.triangles * 3);
+    m_meshStats = stats;
+    m_triangleIndexDirty = true;
+    return true;
+}
+
+void Renderer::ClearMesh()
+{
+    if (m_meshVAO) glDeleteVertexArrays(1, &m_meshVAO);
+    if (m_meshVBO) glDeleteBuffers(1, &m_meshVBO);
+    if (m_meshEBO) glDeleteBuffers(1, &m_meshEBO);
+    
+    // Deleting the bound vertex array unbinds it behind the cache
+    if (m_meshVAO)
+        m_state.Invalidate();
+    
+    m_meshVAO = m_meshVBO = m_meshEBO = 0;
+    if (m_meshIndexCount > 0)
+        m_triangleIndexDirty = true;
+    m_meshIndexCount = 0;
+    m_meshStats = MeshStats{ 0, 0, 0, 0.0, 0.0, 0.0, false };
+}
+
+void Renderer::SetMeshOptimization(bool enabled)
+{
+    m_meshOptimization = enabled;
+}
+
+const MeshStats& Renderer::GetMeshStats() const
+{
+    return m_meshStats;
+}
+
+bool Renderer::InitializeMeshShader()
+{
+    if (m_meshShader.GetId())
+        return true;
+    
+    // Built on first use like the picking shaders
+    ShaderCache* cache = m_shaderCache.IsEnabled() ? &m_shaderCache : nullptr;
+    if (!m_meshShader.Create(meshVertexShader, meshFragmentShader, cache))
+    {
+        wxLogError("Failed to build the mesh shaders");
+        return false;
+    }
+    m_meshUniforms.rotation = m_meshShader.GetUniformLocation("rotation");
+    m_meshShader.BindUniformBlock("FrameData", kFrameDataBinding);
+    return true;
 }
 
 void Renderer::SetTriangleVisible(bool visible)
 {
     m_triangleVisible = visible;
+    m_triangleIndexDirty = true;
 }
 
 bool Renderer::IsButtonClicked(float x, float y)
@@ -259,31 +469,352 @@ bool Renderer::IsButtonClicked(float x, float y)
     float pixelX = (x + 1.0f) * 0.5f * m_viewportWidth;
     float pixelY = (1.0f - y) * 0.5f * m_viewportHeight;
     
-    // Check button click
-    return (pixelX >= 20.0f && pixelX <= 80.0f && 
-            pixelY >= 20.0f && pixelY <= 80.0f);
+    const ButtonData& button = m_buttons[0];
+    return (pixelX >= button.x && pixelX <= button.x + button.width &&
+            pixelY >= button.y && pixelY <= button.y + button.height);
 }
 
 void Renderer::UpdateButtonHover(float x, float y)
 {
-    m_button.hovered = IsButtonClicked(x, y);
+    SetButtonHovered((size_t)0, IsButtonClicked(x, y));
 }
 
 bool Renderer::IsButtonHovered() const
 {
-    return m_button.hovered;
+    return m_buttons[0].hovered;
+}
+
+void Renderer::SetButtonHovered(bool hovered)
+{
+    SetButtonHovered((size_t)0, hovered);
+}
+
+size_t Renderer::AddButton(float x, float y, float width, float height, const std::string& icon)
+{
+    m_buttons.push_back(ButtonData{ x, y, width, height, false, icon });
+    m_spritesDirty = true;
+    m_buttonIndexDirty = true;
+    return m_buttons.size() - 1;
+}
+
+size_t Renderer::GetButtonCount() const
+{
+    return m_buttons.size();
+}
+
+void Renderer::SetButtonHovered(size_t index, bool hovered)
+{
+    if (index >= m_buttons.size() || m_buttons[index].hovered == hovered)
+        return;
+    m_buttons[index].hovered = hovered;
+    m_spritesDirty = true;
+}
+
+PickResult Renderer::Pick(float x, float y) const
+{
+    std::shared_ptr<const SpatialIndex> buttons, triangles;
+    {
+        std::lock_guard<std::mutex> lock(m_pickMutex);
+        buttons = m_buttonIndex;
+        triangles = m_triangleIndex;
+    }
+    
+    PickResult result = { PickResult::None, 0 };
+    int pickX, pickY;
+    unsigned int id;
+    if (buttons && buttons->Pick(x, y, result.index))
+        result.kind = PickResult::Button;
+    else if (!m_gpuPicking && triangles && triangles->Pick(x, y, result.index))
+        result.kind = PickResult::Triangle;
+    else if (m_gpuPicking && m_idPicker.GetResult(pickX, pickY, id) && id != 0)
+    {
+        result.kind = PickResult::Triangle;
+        result.index = id - 1;
+    }
+    return result;
+}
+
+void Renderer::SetGpuPicking(bool enabled)
+{
+    if (m_gpuPicking == enabled)
+        return;
+    m_gpuPicking = enabled;
+    m_idPicker.ClearResult();
+    // Switching back needs the index; switching on drops it
+    m_triangleIndexDirty = true;
+}
+
+bool Renderer::IsGpuPicking() const
+{
+    return m_gpuPicking;
+}
+
+void Renderer::SetPickPoint(int x, int y)
+{
+    if (x == m_pickX && y == m_pickY)
+        return;
+    m_pickX = x;
+    m_pickY = y;
+    m_pickPointChanged = true;
+}
+
+bool Renderer::HasPendingPicks() const
+{
+    return m_idPicker.HasPending();
+}
+
+void Renderer::CollectPicks()
+{
+    m_idPicker.Collect();
+}
+
+bool Renderer::StartCapture(const std::string& path, int fps, bool dropWhenBehind)
+{
+    return m_capture.Start(path, fps, dropWhenBehind);
+}
+
+void Renderer::StopCapture()
+{
+    m_capture.Stop();
+}
+
+bool Renderer::IsCapturing() const
+{
+    return m_capture.IsActive();
+}
+
+bool Renderer::HasPendingCaptures() const
+{
+    return m_capture.HasPending();
+}
+
+void Renderer::CollectCaptures()
+{
+    m_capture.Collect();
+}
+
+CaptureStats Renderer::GetCaptureStats() const
+{
+    return m_capture.GetStats();
+}
+
+bool Renderer::InitializePickShaders()
+{
+    if (m_trianglePickShader.GetId() && m_instancedPickShader.GetId())
+        return true;
+    
+    // Built on first use, most sessions never pick on the GPU
+    ShaderCache* cache = m_shaderCache.IsEnabled() ? &m_shaderCache : nullptr;
+    if (!m_trianglePickShader.Create(triangleVertexShader, pickFragmentShader, cache) ||
+        !m_instancedPickShader.Create(triangleInstancedVertexShader, pickFragmentShader, cache))
+    {
+        wxLogError("Failed to build the picking shaders, GPU picking disabled");
+        m_gpuPicking = false;
+        m_triangleIndexDirty = true;
+        return false;
+    }
+    
+    m_trianglePickUniforms.rotation = m_trianglePickShader.GetUniformLocation("rotation");
+    m_trianglePickUniforms.useFixedSize = m_trianglePickShader.GetUniformLocation("useFixedSize");
+    m_trianglePickUniforms.fixedSize = m_trianglePickShader.GetUniformLocation("fixedSize");
+    m_trianglePickUniforms.baseId = m_trianglePickShader.GetUniformLocation("baseId");
+    m_instancedPickUniforms.fixedSize = m_instancedPickShader.GetUniformLocation("fixedSize");
+    m_instancedPickUniforms.baseId = m_instancedPickShader.GetUniformLocation("baseId");
+    
+    m_trianglePickShader.BindUniformBlock("FrameData", kFrameDataBinding);
+    m_instancedPickShader.BindUniformBlock("FrameData", kFrameDataBinding);
+    return true;
+}
+
+// Same geometry as the scene layer, ids instead of colors; instances are
+// always drawn instanced here so gl_InstanceID gives the index
+void Renderer::QueuePickTriangles()
+{
+    if (m_instances.empty())
+    {
+        unsigned int program = m_trianglePickShader.GetId();
+        DrawCommand& command = m_queue.Push(RenderQueue::MakeKey(kPickLayer, program, 0, m_triangleVAO, 0));
+        command.program = program;
+        command.vertexArray = m_triangleVAO;
+        command.count = 3;
+        command.SetUniform(m_trianglePickUniforms.rotation, m_rotation);
+        command.SetUniform(m_trianglePickUniforms.useFixedSize, m_useFixedSize ? 1 : 0);
+        command.SetUniform(m_trianglePickUniforms.fixedSize, m_fixedTriangleSize);
+        command.SetUniform(m_trianglePickUniforms.baseId, 1);
+        return;
+    }
+    
+    unsigned int program = m_instancedPickShader.GetId();
+    DrawCommand& command = m_queue.Push(RenderQueue::MakeKey(kPickLayer, program, 0, m_instanceVAO, 0));
+    command.program = program;
+    command.vertexArray = m_instanceVAO;
+    command.count = 3;
+    command.instances = (int)m_instances.size();
+    command.SetUniform(m_instancedPickUniforms.fixedSize, m_fixedTriangleSize);
+    command.SetUniform(m_instancedPickUniforms.baseId, 1);
+}
+
+void Renderer::UpdatePickIndices()
+{
+    TRACE_SCOPE("Renderer::UpdatePickIndices");
+    std::shared_ptr<SpatialIndex> buttons, triangles;
+    
+    if (m_buttonIndexDirty)
+    {
+        std::vector<Bounds> rects;
+        rects.reserve(m_buttons.size());
+        for (const ButtonData& button : m_buttons)
+            rects.push_back(Bounds{ button.x, button.y, button.x + button.width, button.y + button.height });
+        
+        buttons = std::make_shared<SpatialIndex>();
+        buttons->BuildRects(rects);
+        m_buttonIndexDirty = false;
+    }
+    
+    if (m_triangleIndexDirty)
+    {
+        // Left empty while the id pass answers for triangles, or a mesh hides them
+        std::vector<float> corners;
+        if (m_triangleVisible && !m_gpuPicking && m_meshIndexCount == 0)
+            ComputeTriangleCorners(corners);
+        
+        triangles = std::make_shared<SpatialIndex>();
+        triangles->BuildTriangles(corners, &JobSystem::GetShared());
+        m_triangleIndexDirty = false;
+    }
+    
+    if (buttons || triangles)
+    {
+        std::lock_guard<std::mutex> lock(m_pickMutex);
+        if (buttons)
+            m_buttonIndex = buttons;
+        if (triangles)
+            m_triangleIndex = triangles;
+    }
+}
+
+// Triangle corners in pixels, the same transform as the triangle vertex shaders
+void Renderer::ComputeTriangleCorners(std::vector<float>& corners) const
+{
+    float width = (float)m_viewportWidth;
+    float height = (float)m_viewportHeight;
+    float aspectRatio = width / height;
+    float sizeScale = m_fixedTriangleSize / std::min(width, height);
+    const float degreesToRadians = 3.14159265f / 180.0f;
+    
+    auto computeTriangle = [&](float rotation, float scale, float offsetX, float offsetY, bool fixedSize, float* out) {
+        float cosR = std::cos(rotation * degreesToRadians);
+        float sinR = std::sin(rotation * degreesToRadians);
+        for (int v = 0; v < 3; ++v)
+        {
+            float px = m_triangleVertices[v * 6 + 0];
+            float py = m_triangleVertices[v * 6 + 1];
+            float x = cosR * px + sinR * py;
+            float y = -sinR * px + cosR * py;
+            if (fixedSize)
+            {
+                x *= scale;
+                y *= scale;
+                if (aspectRatio > 1.0f)
+                    x /= aspectRatio;
+                else
+                    y *= aspectRatio;
+            }
+            out[v * 2] = (x + offsetX + 1.0f) * 0.5f * width;
+            out[v * 2 + 1] = (1.0f - (y + offsetY)) * 0.5f * height;
+        }
+    };
+    
+    if (m_instances.empty())
+    {
+        corners.resize(6);
+        computeTriangle(m_rotation, sizeScale, 0.0f, 0.0f, m_useFixedSize, corners.data());
+        return;
+    }
+    
+    // Every instance writes its own six floats, so the pieces need no locks
+    corners.resize(m_instances.size() * 6);
+    JobSystem::GetShared().ParallelFor(m_instances.size(), kCornersPerJob, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const TriangleInstance& instance = m_instances[i];
+            computeTriangle(instance.rotation, instance.scale * sizeScale, instance.offset[0], instance.offset[1], true,
+                            corners.data() + i * 6);
+        }
+    });
+}
+
+const RenderStats& Renderer::GetFrameStats() const
+{
+    return m_frameStats;
+}
+
+void Renderer::ResetStateCache()
+{
+    m_state.Invalidate();
+}
+
+PassTimingStats Renderer::GetPassTimings(RenderPass pass) const
+{
+    return m_profiler.GetStats(pass);
+}
+
+GpuProfiler& Renderer::GetProfiler()
+{
+    return m_profiler;
+}
+
+TextureLoader& Renderer::GetTextureLoader()
+{
+    return m_textureLoader;
+}
+
+void Renderer::SetShaderCache(bool enabled, const std::string& directory)
+{
+    m_shaderCacheEnabled = enabled;
+    m_shaderCacheDirectory = directory;
+}
+
+const ShaderCache& Renderer::GetShaderCache() const
+{
+    return m_shaderCache;
 }
 
 bool Renderer::InitializeShaders()
 {
-    m_triangleShaderProgram = CreateShaderProgram(triangleVertexShader, triangleFragmentShader);
-    if (m_triangleShaderProgram == 0)
+    ShaderCache* cache = m_shaderCache.IsEnabled() ? &m_shaderCache : nullptr;
+    
+    if (!m_triangleShader.Create(triangleVertexShader, triangleFragmentShader, cache))
         return false;
     
-    m_buttonShaderProgram = CreateShaderProgram(buttonVertexShader, buttonFragmentShader);
-    if (m_buttonShaderProgram == 0)
+    if (!m_spriteShader.Create(spriteVertexShader, spriteFragmentShader, cache))
         return false;
     
+    if (!m_instancedShader.Create(triangleInstancedVertexShader, triangleFragmentShader, cache))
+        return false;
+    
+    // Locations resolved once, per-frame code only uses the cached ints
+    m_triangleUniforms.rotation = m_triangleShader.GetUniformLocation("rotation");
+    m_triangleUniforms.useFixedSize = m_triangleShader.GetUniformLocation("useFixedSize");
+    m_triangleUniforms.fixedSize = m_triangleShader.GetUniformLocation("fixedSize");
+    
+    m_instancedUniforms.fixedSize = m_instancedShader.GetUniformLocation("fixedSize");
+    
+    // Texture unit never changes
+    m_state.UseProgram(m_spriteShader.GetId());
+    m_state.Uniform1i(m_spriteShader.GetUniformLocation("spriteTexture"), 0);
+    
+    // Shared per-frame data
+    glGenBuffers(1, &m_frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kFrameDataBinding, m_frameUBO);
+    
+    m_triangleShader.BindUniformBlock("FrameData", kFrameDataBinding);
+    m_instancedShader.BindUniformBlock("FrameData", kFrameDataBinding);
+    m_spriteShader.BindUniformBlock("FrameData", kFrameDataBinding);
+    
     return true;
 }
 
@@ -295,203 +826,334 @@ bool Renderer::InitializeGeometry()
         -0.5f, -0.289f, 0.0f,  0.0f, 1.0f, 0.0f, // Left
          0.5f, -0.289f, 0.0f,  0.0f, 0.0f, 1.0f  // Right
     };
+    std::copy(triangleVertices, triangleVertices + 18, m_triangleVertices);
+    
+    // Ring for per-frame vertex data, grows if a frame needs more
+    if (!m_streamBuffer.Create(256 * 1024))
+        return false;
     
     // VAO, VBO for triangle 
     glGenVertexArrays(1, &m_triangleVAO);
     glGenBuffers(1, &m_triangleVBO);
     
-    glBindVertexArray(m_triangleVAO);
     glBindBuffer(GL_ARRAY_BUFFER, m_triangleVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(triangleVertices), triangleVertices, GL_DYNAMIC_DRAW);
+    SetTriangleAttributes(m_triangleVBO, 0);
     
-    // Position
+    // Instanced triangles share the triangle positions, everything else is per instance
+    glGenVertexArrays(1, &m_instanceVAO);
+    glGenBuffers(1, &m_instanceVBO);
+    
+    m_state.BindVertexArray(m_instanceVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_triangleVBO);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     
-    // Color
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    
-    // Button positions
-    float buttonVertices[] = {
-        0.0f, 0.0f,              0.0f, 0.0f, // Лево-низ
-        1.0f, 0.0f,              1.0f, 0.0f, // Право-низ
-        1.0f, 1.0f,              1.0f, 1.0f, // Право-верх
-        
-        0.0f, 0.0f,              0.0f, 0.0f, // Лево-низ
-        1.0f, 1.0f,              1.0f, 1.0f, // Право-верх
-        0.0f, 1.0f,              0.0f, 1.0f  // Лево-верх
-    };    
-    
-    // VAO, VBO for button
-    glGenVertexArrays(1, &m_buttonVAO);
-    glGenBuffers(1, &m_buttonVBO);
-    
-    glBindVertexArray(m_buttonVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m_buttonVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(buttonVertices), buttonVertices, GL_STATIC_DRAW);
+    for (int attrib = 2; attrib <= 7; ++attrib)
+    {
+        glEnableVertexAttribArray(attrib);
+        glVertexAttribDivisor(attrib, 1);
+    }
+    SetInstanceAttributes(m_instanceVBO, 0);
     
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    // Per-object path: same program, per-instance values set as constant attributes
+    glGenVertexArrays(1, &m_perObjectVAO);
+    m_state.BindVertexArray(m_perObjectVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_triangleVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // Button quads, rebuilt when buttons change; four corners each, shared through the index buffer
+    glGenVertexArrays(1, &m_spriteVAO);
+    glGenBuffers(1, &m_spriteVBO);
+    glGenBuffers(1, &m_spriteEBO);
+    SetSpriteAttributes(m_spriteVBO, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_spriteEBO);
     
-    glBindVertexArray(0);
+    m_state.BindVertexArray(0);
     
     return true;
 }
 
-bool Renderer::LoadButtonTexture()
+bool Renderer::LoadIconAtlas()
 {
-    m_button.textureId = LoadTexture("icon/button_icon.png");
-    return m_button.textureId != 0;
+    // Every icon in one texture, packed on a loader worker; buttons appear once it is uploaded
+    std::vector<std::string> icons = TextureAtlas::ListImages("icon");
+    if (icons.empty())
+        return false;
+    return m_iconAtlas.Request(m_textureLoader, icons) != 0;
 }
 
-unsigned int Renderer::CompileShader(unsigned int type, const std::string& source)
+void Renderer::SetTriangleAttributes(unsigned int buffer, size_t offset)
 {
-    unsigned int shader = glCreateShader(type);
-    const char* src = source.c_str();
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
+    m_state.BindVertexArray(m_triangleVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
     
-    int success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        wxLogError("Shader compilation failed: %s", infoLog);
-        glDeleteShader(shader);
-        return 0;
-    }
+    // Position
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)offset);
+    glEnableVertexAttribArray(0);
+    
+    // Color
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(offset + 3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
     
-    return shader;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-unsigned int Renderer::CreateShaderProgram(const std::string& vertexShader, const std::string& fragmentShader)
+void Renderer::SetInstanceAttributes(unsigned int buffer, size_t offset)
 {
-    unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
-    unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
+    m_state.BindVertexArray(m_instanceVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
     
-    if (vs == 0 || fs == 0)
+    const GLsizei instanceStride = sizeof(TriangleInstance);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, instanceStride, (void*)(offset + offsetof(TriangleInstance, offset)));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, instanceStride, (void*)(offset + offsetof(TriangleInstance, rotation)));
+    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, instanceStride, (void*)(offset + offsetof(TriangleInstance, scale)));
+    for (int i = 0; i < 3; ++i)
     {
-        if (vs) glDeleteShader(vs);
-        if (fs) glDeleteShader(fs);
-        return 0;
+        glVertexAttribPointer(5 + i, 3, GL_FLOAT, GL_FALSE, instanceStride,
+                              (void*)(offset + offsetof(TriangleInstance, colors) + i * 3 * sizeof(float)));
     }
     
-    unsigned int program = glCreateProgram();
-    glAttachShader(program, vs);
-    glAttachShader(program, fs);
-    glLinkProgram(program);
-    
-    int success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        char infoLog[512];
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        wxLogError("Shader program linking failed: %s", infoLog);
-        glDeleteProgram(program);
-        program = 0;
-    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Renderer::SetSpriteAttributes(unsigned int buffer, size_t offset)
+{
+    m_state.BindVertexArray(m_spriteVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
     
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    const GLsizei stride = sizeof(SpriteVertex);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(SpriteVertex, position)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(SpriteVertex, texCoord)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(SpriteVertex, tint)));
+    glEnableVertexAttribArray(2);
     
-    return program;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void Renderer::RenderTriangle()
+void Renderer::UploadDynamicGeometry()
 {
-    glUseProgram(m_triangleShaderProgram);
+    TRACE_SCOPE("Renderer::UploadDynamicGeometry");
+    unsigned int buffer;
+    size_t offset;
+    
+    if (UploadVertexData(m_triangleStream, m_triangleVBO, m_triangleVertices, sizeof(m_triangleVertices), buffer, offset))
+        SetTriangleAttributes(buffer, offset);
     
-    int rotationLoc = glGetUniformLocation(m_triangleShaderProgram, "rotation");
-    glUniform1f(rotationLoc, m_rotation);
+    if (UploadVertexData(m_instanceStream, m_instanceVBO, m_instances.data(),
+                         m_instances.size() * sizeof(TriangleInstance), buffer, offset))
+        SetInstanceAttributes(buffer, offset);
     
-    int viewportLoc = glGetUniformLocation(m_triangleShaderProgram, "viewport");
-    glUniform2f(viewportLoc, (float)m_viewportWidth, (float)m_viewportHeight);
+    // Regions are only known once the atlas is in
+    if (m_spritesDirty && m_iconAtlas.IsReady())
+        RebuildSprites();
+    UpdateSpriteIndices();
     
-    int useFixedSizeLoc = glGetUniformLocation(m_triangleShaderProgram, "useFixedSize");
-    glUniform1i(useFixedSizeLoc, m_useFixedSize ? 1 : 0);
+    if (UploadVertexData(m_spriteStream, m_spriteVBO, m_sprites.GetVertices(), m_sprites.GetSizeBytes(), buffer, offset))
+        SetSpriteAttributes(buffer, offset);
+}
+
+void Renderer::RebuildSprites()
+{
+    const float normal[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    const float hover[4] = { 1.15f, 1.15f, 1.15f, 1.0f };
     
-    int fixedSizeLoc = glGetUniformLocation(m_triangleShaderProgram, "fixedSize");
-    glUniform1f(fixedSizeLoc, m_fixedTriangleSize);
+    m_sprites.Clear();
+    for (const ButtonData& button : m_buttons)
+    {
+        const AtlasRegion* region = m_iconAtlas.Find(button.icon);
+        if (region)
+            m_sprites.AddQuad(button.x, button.y, button.width, button.height, *region, button.hovered ? hover : normal);
+    }
     
-    glBindVertexArray(m_triangleVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-    glBindVertexArray(0);
+    m_spritesDirty = false;
+    m_spriteStream.dirty = true;
 }
 
-void Renderer::RenderButton()
+// Every batch uses the same quad pattern, so the buffer only grows
+void Renderer::UpdateSpriteIndices()
 {
-    glUseProgram(m_buttonShaderProgram);
+    size_t quads = m_sprites.GetQuadCount();
+    if (quads <= m_spriteIndexQuads)
+        return;
     
-    int viewportLoc = glGetUniformLocation(m_buttonShaderProgram, "viewport");
-    glUniform2f(viewportLoc, (float)m_viewportWidth, (float)m_viewportHeight);
+    std::vector<uint32_t> indices;
+    SpriteBatch::BuildQuadIndices(quads, indices);
+    m_state.BindVertexArray(m_spriteVAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_spriteEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    m_spriteIndexQuads = quads;
+}
+
+bool Renderer::UploadVertexData(StreamedVertices& state, unsigned int staticBuffer, const void* data, size_t size,
+                                unsigned int& buffer, size_t& offset)
+{
+    bool changed = state.dirty;
+    bool animated = changed && state.changedLastFrame;
+    state.changedLastFrame = changed;
+    state.dirty = false;
     
-    float buttonPixelX = 20.0f;
-    float buttonPixelY = 20.0f;
-    int buttonPosLoc = glGetUniformLocation(m_buttonShaderProgram, "buttonPos");
-    glUniform2f(buttonPosLoc, buttonPixelX, buttonPixelY);
+    // Changing every frame: write into the ring, no driver copy and no stall
+    if (animated && size > 0)
+    {
+        void* target = m_streamBuffer.Map(size, offset);
+        if (target)
+        {
+            std::memcpy(target, data, size);
+            m_streamBuffer.Unmap();
+            buffer = m_streamBuffer.GetBuffer();
+            state.inRing = true;
+            return true;
+        }
+    }
     
-    // Size
-    float buttonPixelWidth = 60.0f;
-    float buttonPixelHeight = 60.0f;
-    int buttonSizeLoc = glGetUniformLocation(m_buttonShaderProgram, "buttonSize");
-    glUniform2f(buttonSizeLoc, buttonPixelWidth, buttonPixelHeight);
+    // One-off change, or settled while the last copy sits in a ring segment that will be reused
+    if (changed || state.inRing)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, staticBuffer);
+        glBufferData(GL_ARRAY_BUFFER, size, data, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        
+        bool moved = state.inRing;
+        state.inRing = false;
+        buffer = staticBuffer;
+        offset = 0;
+        return moved;
+    }
+    
+    return false;
+}
+
+void Renderer::UpdateFrameUniforms()
+{
+    FrameUniformData data = {};
     
-    // Texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_button.textureId);
-    glUniform1i(glGetUniformLocation(m_buttonShaderProgram, "buttonTexture"), 0);
+    // Orthographic pixels -> NDC with y pointing down, column-major
+    float width = (float)m_viewportWidth;
+    float height = (float)m_viewportHeight;
+    data.projection[0] = 2.0f / width;
+    data.projection[5] = -2.0f / height;
+    data.projection[10] = 1.0f;
+    data.projection[12] = -1.0f;
+    data.projection[13] = 1.0f;
+    data.projection[15] = 1.0f;
     
-    // Hover
-    glUniform1i(glGetUniformLocation(m_buttonShaderProgram, "hovered"), m_button.hovered ? 1 : 0);
+    data.viewport[0] = width;
+    data.viewport[1] = height;
+    data.time = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_startTime).count();
     
-    glBindVertexArray(m_buttonVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    // Rebound every frame: another renderer in this context may have taken the binding point
+    glBindBufferBase(GL_UNIFORM_BUFFER, kFrameDataBinding, m_frameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
-unsigned int Renderer::LoadTexture(const std::string& path)
+void Renderer::SubmitLayer(unsigned int layer)
 {
-    wxInitAllImageHandlers();
+    TRACE_SCOPE("Renderer::SubmitLayer");
+    RenderQueue::SubmitStats stats = m_queue.SubmitLayer(m_state, layer);
+    m_frameStats.drawCalls += stats.drawCalls;
+    m_frameStats.triangles += stats.triangles;
+}
+
+void Renderer::QueueTriangle()
+{
+    unsigned int program = m_triangleShader.GetId();
+    DrawCommand& command = m_queue.Push(RenderQueue::MakeKey(kSceneLayer, program, 0, m_triangleVAO, 0));
+    command.program = program;
+    command.vertexArray = m_triangleVAO;
+    command.count = 3;
+    command.SetUniform(m_triangleUniforms.rotation, m_rotation);
+    command.SetUniform(m_triangleUniforms.useFixedSize, m_useFixedSize ? 1 : 0);
+    command.SetUniform(m_triangleUniforms.fixedSize, m_fixedTriangleSize);
+}
+
+void Renderer::QueueTriangleInstances()
+{
+    unsigned int program = m_instancedShader.GetId();
     
-    wxImage image;
-    if (!image.LoadFile(path, wxBITMAP_TYPE_PNG))
+    if (m_instancedRendering)
     {
-        wxLogError("Failed to load texture: %s", path);
-        return 0;
+        DrawCommand& command = m_queue.Push(RenderQueue::MakeKey(kSceneLayer, program, 0, m_instanceVAO, 0));
+        command.program = program;
+        command.vertexArray = m_instanceVAO;
+        command.count = 3;
+        command.instances = (int)m_instances.size();
+        command.SetUniform(m_instancedUniforms.fixedSize, m_fixedTriangleSize);
+        return;
     }
     
-    int width = image.GetWidth();
-    int height = image.GetHeight();
-    unsigned char* data = image.GetData();
-    unsigned char* alpha = image.GetAlpha();
-    
-    unsigned char* rgba_data = new unsigned char[width * height * 4];
-    for (int i = 0; i < width * height; ++i)
+    // One draw per instance, attributes matching the TriangleInstance layout
+    static const ConstantAttribute layout[] = { { 2, 2 }, { 3, 1 }, { 4, 1 }, { 5, 3 }, { 6, 3 }, { 7, 3 } };
+    uint64_t key = RenderQueue::MakeKey(kSceneLayer, program, 0, m_perObjectVAO, 0);
+    for (size_t i = 0; i < m_instances.size(); ++i)
     {
-        rgba_data[i * 4 + 0] = data[i * 3 + 0]; // R
-        rgba_data[i * 4 + 1] = data[i * 3 + 1]; // G
-        rgba_data[i * 4 + 2] = data[i * 3 + 2]; // B
-        rgba_data[i * 4 + 3] = alpha ? alpha[i] : 255; // A
+        DrawCommand& command = m_queue.Push(key);
+        command.program = program;
+        command.vertexArray = m_perObjectVAO;
+        command.count = 3;
+        command.attributeLayout = layout;
+        command.attributeCount = 6;
+        command.attributeValues = m_instances[i].offset;
+        // Same key for all of them, so the first one is submitted first
+        if (i == 0)
+            command.SetUniform(m_instancedUniforms.fixedSize, m_fixedTriangleSize);
     }
+}
+
+void Renderer::QueueMesh()
+{
+    static const ConstantAttribute layout[] = { { 1, 4 } };
+    unsigned int program = m_meshShader.GetId();
+    DrawCommand& command = m_queue.Push(RenderQueue::MakeKey(kSceneLayer, program, 0, m_meshVAO, 0));
+    command.program = program;
+    command.vertexArray = m_meshVAO;
+    command.count = m_meshIndexCount;
+    command.indexType = GL_UNSIGNED_INT;
+    command.depthTest = true;
+    command.attributeLayout = layout;
+    command.attributeCount = 1;
+    command.attributeValues = m_meshFit;
+    command.SetUniform(m_meshUniforms.rotation, m_rotation);
+}
+
+void Renderer::QueueButtons()
+{
+    if (m_sprites.GetVertexCount() == 0)
+        return;
+    
+    // All buttons in one draw
+    unsigned int program = m_spriteShader.GetId();
+    unsigned int texture = m_iconAtlas.GetTexture();
+    DrawCommand& command = m_queue.Push(RenderQueue::MakeKey(kInterfaceLayer, program, texture, m_spriteVAO, 0));
+    command.program = program;
+    command.vertexArray = m_spriteVAO;
+    command.texture = texture;
+    command.count = (int)m_sprites.GetIndexCount();
+    command.indexType = GL_UNSIGNED_INT;
+}
+
+unsigned int Renderer::LoadTexture(const std::string& path)
+{
+    DecodedImage image;
+    if (!TextureLoader::DecodeImage(path, image))
+        return 0;
     
     unsigned int textureId;
     glGenTextures(1, &textureId);
-    glBindTexture(GL_TEXTURE_2D, textureId);
+    m_state.BindTexture2D(textureId);
     
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba_data);
-    
-    delete[] rgba_data;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.rgba.data());
+    m_state.BindTexture2D(0);
     
     return textureId;
 }
@@ -1,12 +1,29 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+#include "FrameCapture.h"
+#include "GLStateCache.h"
+#include "GpuProfiler.h"
+#include "IdPicker.h"
+#include "RenderQueue.h"
+#include "ShaderCache.h"
+#include "ShaderProgram.h"
+#include "SpatialIndex.h"
+#include "SpriteBatch.h"
+#include "StreamBuffer.h"
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
 
 struct ButtonData
 {
-    float x, y;          // Positions
-    float width, height; // Size
+    float x, y;          // Top-left, pixels
+    float width, height; // Size, pixels
     bool hovered;        // Hover
-    unsigned int textureId; // icon Id
+    std::string icon;    // Atlas entry, e.g. "icon/button_icon.png"
 };
 
 struct VertexColors
@@ -16,12 +33,57 @@ struct VertexColors
     float vertex3[3]; // Right
 };
 
+struct TriangleInstance
+{
+    float offset[2];  // NDC offset
+    float rotation;   // Degrees
+    float scale;      // Relative to the fixed triangle size
+    float colors[9];  // Up, left, right RGB
+};
+
+// std140 layout of the FrameData block shared by all programs
+struct FrameUniformData
+{
+    float projection[16]; // Pixels (top-left origin) -> NDC
+    float viewport[2];
+    float time;           // Seconds since Initialize()
+    float padding;
+};
+
+struct PickResult
+{
+    enum Kind { None, Button, Triangle } kind;
+    size_t index; // Button index, or triangle instance (0 for the single triangle)
+};
+
+struct MeshStats
+{
+    size_t vertices, triangles; // 0 when no mesh is loaded
+    size_t fileBytes;
+    double loadMs;   // Parse, or open and map for .rmesh
+    double optimizeMs; // MeshOptimizer pass on parsed meshes, 0 when off
+    double uploadMs; // Buffer creation and copies into GL
+    bool mapped;     // .rmesh uploaded straight from the file mapping
+};
+
+struct RenderStats
+{
+    unsigned int drawCalls; // Issued during the last Render()
+    size_t triangles;
+    unsigned int stateChanges;        // Binds and uniform updates sent to the driver
+    unsigned int stateChangesSkipped; // Redundant ones dropped by the state cache
+};
+
 class Renderer
 {
 public:
     Renderer();
     ~Renderer();
 
+    // Program binary cache, before Initialize(); empty directory = per-user default
+    void SetShaderCache(bool enabled, const std::string& directory = std::string());
+    const ShaderCache& GetShaderCache() const;
+
     bool Initialize();
     void Render();
     void SetViewport(int width, int height);
@@ -32,34 +94,151 @@ public:
     void SetVertexColor(int vertexIndex, float r, float g, float b); // 0=верх, 1=лево, 2=право
     void SetUseCustomColor(bool useCustom);
     void UpdateTriangleGeometry();
+
+    // Instanced triangles (replace the single triangle while non-empty)
+    void SetTriangleInstances(const std::vector<TriangleInstance>& instances);
+    void SetInstancedRendering(bool enabled); // false = one draw call per instance
+    size_t GetTriangleInstanceCount() const;
+
+    // Mesh from an .obj, .ply or .rmesh file, drawn instead of the triangles
+    // while loaded (and while they are visible), spun by the rotation. Text
+    // formats are parsed on the shared JobSystem; .rmesh files are uploaded
+    // from their mapping without a copy. Needs the context current.
+    bool LoadMesh(const std::string& path);
+    // Welds and reorders parsed meshes for the vertex cache before upload (on
+    // by default); .rmesh files are taken as mesh_convert optimized them
+    void SetMeshOptimization(bool enabled);
+    void ClearMesh();
+    const MeshStats& GetMeshStats() const;
     
     // Button
     bool IsButtonClicked(float x, float y);
     void UpdateButtonHover(float x, float y);
     bool IsButtonHovered() const;
+    void SetButtonHovered(bool hovered);
+    // More buttons (any icon under icon/), all drawn in one batch; 0 is the one above
+    size_t AddButton(float x, float y, float width, float height, const std::string& icon);
+    size_t GetButtonCount() const;
+    void SetButtonHovered(size_t index, bool hovered);
+    
+    // Pointer picking in pixels (top-left origin), safe from any thread.
+    // Answers from the scene as of the last Render(); buttons lie above triangles.
+    // With GPU picking, triangles come from the id pass at the last pick point.
+    PickResult Pick(float x, float y) const;
+    
+    // GPU picking: an id pass at the pick point replaces the triangle index,
+    // the answer shows up one frame later
+    void SetGpuPicking(bool enabled);
+    bool IsGpuPicking() const;
+    void SetPickPoint(int x, int y);
+    bool HasPendingPicks() const; // A readback is in flight
+    void CollectPicks();          // Resolves finished readbacks without rendering
+
+    // Frame capture: every Render() from now on is read back asynchronously and
+    // encoded off this thread, to a .y4m video or a numbered PNG sequence
+    bool StartCapture(const std::string& path, int fps = 60, bool dropWhenBehind = true);
+    void StopCapture(); // Waits until the captured frames are written
+    bool IsCapturing() const;
+    bool HasPendingCaptures() const;
+    void CollectCaptures();
+    CaptureStats GetCaptureStats() const; // Any thread
+
+    // Stats
+    const RenderStats& GetFrameStats() const;
+    PassTimingStats GetPassTimings(RenderPass pass) const; // Rolling GPU time per pass, any thread
+    GpuProfiler& GetProfiler(); // For passes outside Render(), e.g. SwapBuffers
+    
+    // Forget cached GL bindings after other code changed them in this context
+    void ResetStateCache();
+
+    // Textures decode in the background; Render() uploads whatever has finished
+    TextureLoader& GetTextureLoader();
 
 private:
+    friend class RendererBench;
+
     // Init
     bool InitializeShaders();
     bool InitializeGeometry();
-    bool LoadButtonTexture();
-    unsigned int CompileShader(unsigned int type, const std::string& source);
-    unsigned int CreateShaderProgram(const std::string& vertexShader, const std::string& fragmentShader);
+    bool LoadIconAtlas();
     
     // Render
-    void RenderTriangle();
-    void RenderButton();
+    void UpdateFrameUniforms();
+    void QueueTriangle();
+    void QueueTriangleInstances();
+    void QueueButtons();
+    void QueueMesh();
+    void SubmitLayer(unsigned int layer);
+    
+    // Sort key layers, drawn in this order
+    enum : unsigned int { kSceneLayer = 0, kInterfaceLayer = 1, kPickLayer = 2 };
+    
+    // Dynamic vertex data: streamed through the ring while it changes every
+    // frame, copied to its own buffer once it settles
+    struct StreamedVertices
+    {
+        bool dirty;
+        bool changedLastFrame;
+        bool inRing;
+    };
+    void UploadDynamicGeometry();
+    bool UploadVertexData(StreamedVertices& state, unsigned int staticBuffer, const void* data, size_t size,
+                          unsigned int& buffer, size_t& offset);
+    void SetTriangleAttributes(unsigned int buffer, size_t offset);
+    void SetInstanceAttributes(unsigned int buffer, size_t offset);
+    void SetSpriteAttributes(unsigned int buffer, size_t offset);
+    void RebuildSprites();
+    void UpdateSpriteIndices();
+    
+    // Hit testing: indices are rebuilt on the render thread when their input
+    // changes and swapped in under the mutex, so Pick() never waits for a build
+    void UpdatePickIndices();
+    void ComputeTriangleCorners(std::vector<float>& corners) const;
+    static const size_t kCornersPerJob = 4096; // Instances per ParallelFor piece
+    bool InitializePickShaders();
+    void QueuePickTriangles();
+
+    bool InitializeMeshShader();
+    static constexpr size_t kMeshUploadSlice = 64u << 20; // Bytes per glBufferSubData
     
-    // Texture
+    // Texture, synchronous (decode + upload on the calling thread)
     unsigned int LoadTexture(const std::string& path);
 
+    // Per-frame uniform buffer (FrameData block)
+    static const unsigned int kFrameDataBinding = 0;
+    unsigned int m_frameUBO;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    ShaderCache m_shaderCache;
+    bool m_shaderCacheEnabled;
+    std::string m_shaderCacheDirectory;
+
+    StreamBuffer m_streamBuffer;
+    GLStateCache m_state;
+    RenderQueue m_queue;
+    unsigned int m_textureBindingGeneration; // Last TextureLoader generation the cache saw
+
     // OpenGL for triangle
     unsigned int m_triangleVAO, m_triangleVBO;
-    unsigned int m_triangleShaderProgram;
+    float m_triangleVertices[18]; // Position + color per vertex
+    StreamedVertices m_triangleStream;
+    ShaderProgram m_triangleShader;
+    struct { int rotation, useFixedSize, fixedSize; } m_triangleUniforms;
+
+    // OpenGL for instanced triangles
+    unsigned int m_instanceVAO, m_instanceVBO;
+    unsigned int m_perObjectVAO;
+    ShaderProgram m_instancedShader;
+    struct { int fixedSize; } m_instancedUniforms;
     
-    // OpenGL for button
-    unsigned int m_buttonVAO, m_buttonVBO;
-    unsigned int m_buttonShaderProgram;
+    // OpenGL for buttons: one batch of quads over the icon atlas
+    unsigned int m_spriteVAO, m_spriteVBO, m_spriteEBO;
+    size_t m_spriteIndexQuads; // Quads the index buffer covers
+    ShaderProgram m_spriteShader;
+    TextureAtlas m_iconAtlas;
+    SpriteBatch m_sprites;
+    StreamedVertices m_spriteStream;
+    bool m_spritesDirty; // Buttons changed since the batch was built
     
     float m_fixedTriangleSize;
     bool m_useFixedSize;
@@ -69,6 +248,35 @@ private:
     VertexColors m_vertexColors;
     bool m_useCustomColor;
 
-    ButtonData m_button;
+    std::vector<TriangleInstance> m_instances;
+    StreamedVertices m_instanceStream;
+    bool m_instancedRendering;
+
+    // OpenGL for the loaded mesh
+    unsigned int m_meshVAO, m_meshVBO, m_meshEBO;
+    int m_meshIndexCount; // 0 = no mesh
+    float m_meshFit[4];   // Bounds center and 1 / radius, a constant attribute
+    ShaderProgram m_meshShader;
+    struct { int rotation; } m_meshUniforms;
+    MeshStats m_meshStats;
+    bool m_meshOptimization;
+
+    std::vector<ButtonData> m_buttons;
+    
+    mutable std::mutex m_pickMutex;
+    std::shared_ptr<const SpatialIndex> m_buttonIndex, m_triangleIndex;
+    bool m_buttonIndexDirty, m_triangleIndexDirty;
+    
+    IdPicker m_idPicker;
+    std::atomic<bool> m_gpuPicking;
+    ShaderProgram m_trianglePickShader, m_instancedPickShader;
+    struct { int rotation, useFixedSize, fixedSize, baseId; } m_trianglePickUniforms;
+    struct { int fixedSize, baseId; } m_instancedPickUniforms;
+    int m_pickX, m_pickY;
+    bool m_pickPointChanged;
+    FrameCapture m_capture;
+    RenderStats m_frameStats;
+    GpuProfiler m_profiler;
+    TextureLoader m_textureLoader;
 };
 
@@ -0,0 +1,229 @@
+#include <GL/glew.h>
+#include "ShaderCache.h"
+#include <wx/log.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+const char kMagic[4] = { 'S', 'P', 'B', 'C' };
+const uint32_t kFormatVersion = 1;
+
+// Stored in front of every binary
+struct EntryHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint32_t length;
+};
+
+uint64_t Fnv1a(uint64_t hash, const std::string& text)
+{
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    // Separator, so ("ab", "c") and ("a", "bc") hash differently
+    hash ^= 0xFF;
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+// Unique per process, thread and call, so parallel writers of the same entry
+// (renderer_batch, two app instances) never share a temporary file
+std::string GetTemporaryPath(const std::string& path)
+{
+    static const unsigned int processToken = std::random_device()();
+    static std::atomic<unsigned long> sequence(0);
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), ".%08x.%zx.%lu.tmp", processToken,
+                  std::hash<std::thread::id>()(std::this_thread::get_id()), sequence.fetch_add(1));
+    return path + suffix;
+}
+
+std::string GetString(GLenum name)
+{
+    const char* value = (const char*)glGetString(name);
+    return value ? value : "";
+}
+}
+
+ShaderCache::ShaderCache()
+    : m_enabled(false)
+{
+    m_stats.hits = 0;
+    m_stats.misses = 0;
+    m_stats.rejected = 0;
+}
+
+bool ShaderCache::Initialize(const std::string& directory)
+{
+    m_enabled = false;
+    if (!GLEW_ARB_get_program_binary)
+        return false;
+
+    int formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount <= 0)
+        return false;
+
+    m_directory = directory.empty() ? GetDefaultDirectory() : directory;
+    if (m_directory.empty())
+        return false;
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error)
+    {
+        wxLogWarning("Cannot create shader cache directory %s: %s", m_directory, error.message());
+        return false;
+    }
+
+    m_driver = GetString(GL_VENDOR) + "\n" + GetString(GL_RENDERER) + "\n" + GetString(GL_VERSION);
+    m_enabled = true;
+    return true;
+}
+
+std::string ShaderCache::GetDefaultDirectory()
+{
+    std::filesystem::path base;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        base = xdg;
+    else if (const char* localAppData = std::getenv("LOCALAPPDATA"); localAppData && *localAppData)
+        base = localAppData;
+    else if (const char* home = std::getenv("HOME"); home && *home)
+        base = std::filesystem::path(home) / ".cache";
+    else
+        return std::string();
+
+    return (base / "MyOpenGLApp" / "shaders").string();
+}
+
+uint64_t ShaderCache::ComputeKey(const std::string& vertexShader, const std::string& fragmentShader) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = Fnv1a(hash, m_driver);
+    hash = Fnv1a(hash, vertexShader);
+    hash = Fnv1a(hash, fragmentShader);
+    return hash;
+}
+
+std::string ShaderCache::GetEntryPath(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+unsigned int ShaderCache::Load(const std::string& vertexShader, const std::string& fragmentShader)
+{
+    if (!m_enabled)
+        return 0;
+
+    std::string path = GetEntryPath(ComputeKey(vertexShader, fragmentShader));
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        ++m_stats.misses;
+        return 0;
+    }
+
+    // The length is checked against the file before anything is allocated
+    std::error_code sizeError;
+    const uintmax_t fileSize = std::filesystem::file_size(path, sizeError);
+    EntryHeader header;
+    std::vector<char> binary;
+    bool valid = !sizeError
+        && file.read((char*)&header, sizeof(header))
+        && std::equal(kMagic, kMagic + 4, header.magic)
+        && header.version == kFormatVersion
+        && header.length > 0
+        && header.length <= fileSize - sizeof(header);
+    if (valid)
+    {
+        binary.resize(header.length);
+        valid = (bool)file.read(binary.data(), header.length);
+    }
+
+    unsigned int program = 0;
+    if (valid)
+    {
+        program = glCreateProgram();
+        glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+        int success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    if (!program)
+    {
+        // Corrupt or refused (e.g. same version string, different build), rebuilt on Store()
+        ++m_stats.rejected;
+        file.close();
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return 0;
+    }
+
+    ++m_stats.hits;
+    return program;
+}
+
+void ShaderCache::Store(const std::string& vertexShader, const std::string& fragmentShader, unsigned int program)
+{
+    if (!m_enabled || !program)
+        return;
+
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+    if (length <= 0)
+        return;
+
+    EntryHeader header;
+    std::copy(kMagic, kMagic + 4, header.magic);
+    header.version = kFormatVersion;
+    header.binaryFormat = binaryFormat;
+    header.length = (uint32_t)length;
+
+    // Write to a file of our own then rename, so neither readers nor other
+    // writers of the same entry see a partial one. Losing the rename to
+    // another writer is fine: they stored the same program.
+    std::string path = GetEntryPath(ComputeKey(vertexShader, fragmentShader));
+    std::string temporaryPath = GetTemporaryPath(path);
+    std::error_code error;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.write((const char*)&header, sizeof(header)) || !file.write(binary.data(), length))
+        {
+            wxLogWarning("Failed to write shader cache entry %s", path);
+            file.close();
+            std::filesystem::remove(temporaryPath, error);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+        std::filesystem::remove(temporaryPath, error);
+}
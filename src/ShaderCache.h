@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+// Entries are keyed by a hash of the shader sources and the GL vendor, renderer
+// and version strings, so a driver update never loads a stale binary.
+class ShaderCache
+{
+public:
+    struct Stats
+    {
+        unsigned int hits;     // Programs restored from disk
+        unsigned int misses;   // No entry, compiled from source
+        unsigned int rejected; // Entry present but refused by the driver
+    };
+
+    ShaderCache();
+
+    // GL thread, after the context is current. Empty directory = GetDefaultDirectory().
+    // Returns false (and stays disabled) without program binary support.
+    bool Initialize(const std::string& directory = std::string());
+    bool IsEnabled() const { return m_enabled; }
+    const std::string& GetDirectory() const { return m_directory; }
+
+    // Linked program from the cache, 0 on a miss or if the driver rejects the binary
+    unsigned int Load(const std::string& vertexShader, const std::string& fragmentShader);
+    // Program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    void Store(const std::string& vertexShader, const std::string& fragmentShader, unsigned int program);
+
+    const Stats& GetStats() const { return m_stats; }
+
+    // $XDG_CACHE_HOME/MyOpenGLApp/shaders, ~/.cache/... or %LOCALAPPDATA%\...
+    static std::string GetDefaultDirectory();
+
+private:
+    uint64_t ComputeKey(const std::string& vertexShader, const std::string& fragmentShader) const;
+    std::string GetEntryPath(uint64_t key) const;
+
+    bool m_enabled;
+    std::string m_directory;
+    std::string m_driver; // Vendor, renderer and version, part of every key
+    Stats m_stats;
+};
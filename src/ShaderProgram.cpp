@@ -0,0 +1,144 @@
+#include <GL/glew.h>
+#include "ShaderProgram.h"
+#include "ShaderCache.h"
+#include <wx/log.h>
+#include <vector>
+
+ShaderProgram::ShaderProgram()
+    : m_program(0)
+{
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    Destroy();
+}
+
+void ShaderProgram::Destroy()
+{
+    if (m_program) glDeleteProgram(m_program);
+    m_program = 0;
+    m_uniformLocations.clear();
+}
+
+unsigned int ShaderProgram::CompileShader(unsigned int type, const std::string& source)
+{
+    unsigned int shader = glCreateShader(type);
+    const char* src = source.c_str();
+    glShaderSource(shader, 1, &src, nullptr);
+    glCompileShader(shader);
+    
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+        wxLogError("Shader compilation failed: %s", infoLog);
+        glDeleteShader(shader);
+        return 0;
+    }
+    
+    return shader;
+}
+
+bool ShaderProgram::Create(const std::string& vertexShader, const std::string& fragmentShader, ShaderCache* cache)
+{
+    Destroy();
+
+    if (cache)
+    {
+        m_program = cache->Load(vertexShader, fragmentShader);
+        if (m_program)
+        {
+            CacheUniformLocations();
+            return true;
+        }
+    }
+
+    unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
+    unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
+    
+    if (vs == 0 || fs == 0)
+    {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return false;
+    }
+    
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    if (cache && cache->IsEnabled())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, nullptr, infoLog);
+        wxLogError("Shader program linking failed: %s", infoLog);
+        glDeleteProgram(program);
+        program = 0;
+    }
+    
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    
+    m_program = program;
+    if (m_program)
+    {
+        CacheUniformLocations();
+        if (cache)
+            cache->Store(vertexShader, fragmentShader, m_program);
+    }
+
+    return m_program != 0;
+}
+
+void ShaderProgram::CacheUniformLocations()
+{
+    int uniformCount = 0;
+    int maxNameLength = 0;
+    glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char> name(maxNameLength + 1);
+    for (int i = 0; i < uniformCount; ++i)
+    {
+        int length = 0, size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_program, i, (GLsizei)name.size(), &length, &size, &type, name.data());
+
+        // Block members have no location, they live in the uniform buffer
+        int location = glGetUniformLocation(m_program, name.data());
+        if (location < 0)
+            continue;
+
+        std::string uniformName(name.data(), length);
+        m_uniformLocations[uniformName] = location;
+
+        // Arrays are reported as "name[0]", allow lookups by the bare name too
+        size_t bracket = uniformName.find('[');
+        if (bracket != std::string::npos)
+            m_uniformLocations[uniformName.substr(0, bracket)] = location;
+    }
+}
+
+int ShaderProgram::GetUniformLocation(const std::string& name) const
+{
+    auto it = m_uniformLocations.find(name);
+    return it != m_uniformLocations.end() ? it->second : -1;
+}
+
+bool ShaderProgram::BindUniformBlock(const char* blockName, unsigned int bindingPoint)
+{
+    unsigned int blockIndex = glGetUniformBlockIndex(m_program, blockName);
+    if (blockIndex == GL_INVALID_INDEX)
+        return false;
+
+    glUniformBlockBinding(m_program, blockIndex, bindingPoint);
+    return true;
+}
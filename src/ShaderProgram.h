@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+
+class ShaderCache;
+
+// Linked GLSL program with every active uniform location resolved once at link time,
+// so per-frame code never looks uniforms up by string.
+class ShaderProgram
+{
+public:
+    ShaderProgram();
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    // With a cache, a stored binary is tried first and a fresh link is stored back
+    bool Create(const std::string& vertexShader, const std::string& fragmentShader, ShaderCache* cache = nullptr);
+    void Destroy();
+
+    unsigned int GetId() const { return m_program; }
+    int GetUniformLocation(const std::string& name) const; // -1 if not active
+
+    // Attach a named std140 block to a uniform buffer binding point
+    bool BindUniformBlock(const char* blockName, unsigned int bindingPoint);
+
+private:
+    static unsigned int CompileShader(unsigned int type, const std::string& source);
+    void CacheUniformLocations();
+
+    unsigned int m_program;
+    std::unordered_map<std::string, int> m_uniformLocations;
+};
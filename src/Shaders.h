@@ -0,0 +1,215 @@
+#pragma once
+#include <string>
+
+// GLSL sources, shared by Renderer and the benchmarks.
+// Every program reads per-frame state from the FrameData block (see FrameUniformData).
+
+inline const std::string triangleVertexShader = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+
+uniform float rotation;
+uniform bool useFixedSize;
+uniform float fixedSize;
+
+layout (std140) uniform FrameData
+{
+    mat4 projection;
+    vec2 viewport;
+    float time;
+};
+
+out vec3 vertexColor;
+flat out uint instanceId; // For the picking pass
+
+void main()
+{
+    vec3 pos = aPos;
+    
+    float cosR = cos(radians(rotation));
+    float sinR = sin(radians(rotation));
+    
+    mat2 rotMatrix = mat2(cosR, -sinR, sinR, cosR);
+    vec2 rotatedPos = rotMatrix * pos.xy;
+    
+    if (useFixedSize) {
+        float aspectRatio = viewport.x / viewport.y;
+        float scale = fixedSize / min(viewport.x, viewport.y);
+        
+        rotatedPos *= scale;
+        
+        if (aspectRatio > 1.0) {
+            rotatedPos.x /= aspectRatio;
+        } else {
+            rotatedPos.y *= aspectRatio;
+        }
+    }
+    
+    gl_Position = vec4(rotatedPos, pos.z, 1.0);
+    vertexColor = aColor;
+    instanceId = 0u;
+}
+)";
+
+inline const std::string triangleFragmentShader = R"(
+#version 330 core
+in vec3 vertexColor;
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(vertexColor, 1.0);
+}
+)";
+
+inline const std::string triangleInstancedVertexShader = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aOffset;
+layout (location = 3) in float aRotation;
+layout (location = 4) in float aScale;
+layout (location = 5) in vec3 aColor0;
+layout (location = 6) in vec3 aColor1;
+layout (location = 7) in vec3 aColor2;
+
+uniform float fixedSize;
+
+layout (std140) uniform FrameData
+{
+    mat4 projection;
+    vec2 viewport;
+    float time;
+};
+
+out vec3 vertexColor;
+flat out uint instanceId; // For the picking pass
+
+void main()
+{
+    float cosR = cos(radians(aRotation));
+    float sinR = sin(radians(aRotation));
+    
+    mat2 rotMatrix = mat2(cosR, -sinR, sinR, cosR);
+    vec2 rotatedPos = rotMatrix * aPos.xy;
+    
+    float aspectRatio = viewport.x / viewport.y;
+    rotatedPos *= aScale * fixedSize / min(viewport.x, viewport.y);
+    
+    if (aspectRatio > 1.0) {
+        rotatedPos.x /= aspectRatio;
+    } else {
+        rotatedPos.y *= aspectRatio;
+    }
+    
+    gl_Position = vec4(rotatedPos + aOffset, aPos.z, 1.0);
+    vertexColor = gl_VertexID == 0 ? aColor0 : (gl_VertexID == 1 ? aColor1 : aColor2);
+    instanceId = uint(gl_InstanceID);
+}
+)";
+
+inline const std::string spriteVertexShader = R"(
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aTint;
+
+layout (std140) uniform FrameData
+{
+    mat4 projection;
+    vec2 viewport;
+    float time;
+};
+
+out vec2 TexCoord;
+out vec4 Tint;
+
+void main()
+{
+    gl_Position = projection * vec4(aPos, 0.0, 1.0);
+    TexCoord = aTexCoord;
+    Tint = aTint;
+}
+)";
+
+inline const std::string spriteFragmentShader = R"(
+#version 330 core
+in vec2 TexCoord;
+in vec4 Tint;
+out vec4 FragColor;
+
+uniform sampler2D spriteTexture;
+
+void main()
+{
+    FragColor = texture(spriteTexture, TexCoord) * Tint;
+}
+)";
+
+// Loaded meshes: positions only, fitted into the view by a constant attribute
+inline const std::string meshVertexShader = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aFit; // Bounds center, 1 / bounds radius
+
+uniform float rotation;
+
+layout (std140) uniform FrameData
+{
+    mat4 projection;
+    vec2 viewport;
+    float time;
+};
+
+out vec3 viewPos;
+
+void main()
+{
+    vec3 pos = (aPos - aFit.xyz) * aFit.w;
+    
+    // Spin about the vertical axis, then tip 30 degrees towards the viewer
+    float cosR = cos(radians(rotation));
+    float sinR = sin(radians(rotation));
+    pos = vec3(cosR * pos.x + sinR * pos.z, pos.y, -sinR * pos.x + cosR * pos.z);
+    pos = vec3(pos.x, 0.866 * pos.y - 0.5 * pos.z, 0.5 * pos.y + 0.866 * pos.z);
+    
+    vec2 screenPos = pos.xy * 0.9;
+    float aspectRatio = viewport.x / viewport.y;
+    if (aspectRatio > 1.0) {
+        screenPos.x /= aspectRatio;
+    } else {
+        screenPos.y *= aspectRatio;
+    }
+    
+    viewPos = pos;
+    gl_Position = vec4(screenPos, -0.5 * pos.z, 1.0); // +z faces the viewer
+}
+)";
+
+inline const std::string meshFragmentShader = R"(
+#version 330 core
+in vec3 viewPos;
+out vec4 FragColor;
+
+void main()
+{
+    // Flat face normal from the screen-space slope, always towards the viewer
+    vec3 normal = normalize(cross(dFdx(viewPos), dFdy(viewPos)));
+    float light = max(dot(normal, normalize(vec3(0.3, 0.5, 1.0))), 0.0);
+    FragColor = vec4(vec3(0.15) + vec3(0.75, 0.7, 0.6) * light, 1.0);
+}
+)";
+
+// Object ids for the picking pass, used with either triangle vertex shader
+inline const std::string pickFragmentShader = R"(
+#version 330 core
+flat in uint instanceId;
+layout (location = 0) out uint objectId;
+
+uniform int baseId; // 0 is reserved for "nothing"
+
+void main()
+{
+    objectId = uint(baseId) + instanceId;
+}
+)";
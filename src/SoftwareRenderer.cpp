@@ -0,0 +1,623 @@
+#include "SoftwareRenderer.h"
+#include "PixelConvert.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SOFTWARERENDERER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+// Vertices snap to 1/256 pixel, like llvmpipe, which matters for small
+// triangles. Larger ones use 1/16 so that every edge value inside a partly
+// covered tile still fits in 32 bits.
+const int kFineSubpixels = 256;
+const int kCoarseSubpixels = 16;
+const float kFineMaxExtent = 256.0f; // Pixels
+// Vertices further out than this (pixels) drop the triangle, for the same reason
+const float kGuardBand = 16384.0f;
+
+// Bin entries: triangle index, plus one bit per edge that is all inside the tile
+const uint32_t kIndexMask = 0x1FFFFFFF;
+const int kEdgeInsideShift = 29;
+
+// Pixels are RGBA in memory, i.e. R in the low byte on the little-endian hosts this builds for
+const uint32_t kClearColor = 0xFF666666; // glClearColor(0.4, 0.4, 0.4, 1)
+
+// One tile row of one triangle; values at the row's first tile pixel, bias included
+struct TriangleRow
+{
+    int32_t edge[3];
+    int32_t edgeStep[3]; // Per pixel, 0 for edges the whole tile is inside
+    float color[3];
+    float colorStep[3];
+};
+
+typedef void (*ShadeRowFn)(uint32_t* row, int begin, int end, const TriangleRow& setup);
+
+// The triangle fragment shader's vec4(color, 1) as stored in RGBA8
+inline uint32_t ToUnorm8(float c)
+{
+    return (uint32_t)(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+void ShadeRowScalar(uint32_t* row, int begin, int end, const TriangleRow& s)
+{
+    for (int x = begin; x < end; ++x)
+    {
+        int32_t e0 = s.edge[0] + s.edgeStep[0] * x;
+        int32_t e1 = s.edge[1] + s.edgeStep[1] * x;
+        int32_t e2 = s.edge[2] + s.edgeStep[2] * x;
+        if ((e0 | e1 | e2) < 0)
+            continue;
+        float fx = (float)x;
+        row[x] = ToUnorm8(s.color[0] + s.colorStep[0] * fx) |
+                 ToUnorm8(s.color[1] + s.colorStep[1] * fx) << 8 |
+                 ToUnorm8(s.color[2] + s.colorStep[2] * fx) << 16 | 0xFF000000;
+    }
+}
+
+#ifdef SOFTWARERENDERER_X86
+
+// Same arithmetic as the scalar row, lane for lane, so every level gives the same picture
+
+__attribute__((target("sse2")))
+inline __m128i ToUnorm8Sse2(__m128 c)
+{
+    c = _mm_min_ps(_mm_max_ps(c, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+__attribute__((target("sse2")))
+void ShadeRowSse2(uint32_t* row, int begin, int end, const TriangleRow& s)
+{
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+    int x = begin & ~3;
+    __m128i edge[3], edgeStep[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        int32_t e = s.edge[i] + s.edgeStep[i] * x;
+        edge[i] = _mm_setr_epi32(e, e + s.edgeStep[i], e + s.edgeStep[i] * 2, e + s.edgeStep[i] * 3);
+        edgeStep[i] = _mm_set1_epi32(s.edgeStep[i] * 4);
+    }
+    const __m128i first = _mm_set1_epi32(begin - 1);
+    const __m128i last = _mm_set1_epi32(end);
+
+    for (; x < end; x += 4)
+    {
+        __m128i xs = _mm_add_epi32(_mm_set1_epi32(x), lane);
+        __m128i outside = _mm_srai_epi32(_mm_or_si128(_mm_or_si128(edge[0], edge[1]), edge[2]), 31);
+        __m128i inRange = _mm_and_si128(_mm_cmpgt_epi32(xs, first), _mm_cmpgt_epi32(last, xs));
+        __m128i mask = _mm_andnot_si128(outside, inRange);
+        for (int i = 0; i < 3; ++i)
+            edge[i] = _mm_add_epi32(edge[i], edgeStep[i]);
+        if (_mm_movemask_epi8(mask) == 0)
+            continue;
+
+        __m128 fx = _mm_cvtepi32_ps(xs);
+        __m128i r = ToUnorm8Sse2(_mm_add_ps(_mm_set1_ps(s.color[0]), _mm_mul_ps(_mm_set1_ps(s.colorStep[0]), fx)));
+        __m128i g = ToUnorm8Sse2(_mm_add_ps(_mm_set1_ps(s.color[1]), _mm_mul_ps(_mm_set1_ps(s.colorStep[1]), fx)));
+        __m128i b = ToUnorm8Sse2(_mm_add_ps(_mm_set1_ps(s.color[2]), _mm_mul_ps(_mm_set1_ps(s.colorStep[2]), fx)));
+        __m128i px = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                                  _mm_or_si128(_mm_slli_epi32(b, 16), _mm_set1_epi32((int)0xFF000000)));
+
+        __m128i dst = _mm_load_si128((const __m128i*)(row + x));
+        _mm_store_si128((__m128i*)(row + x), _mm_or_si128(_mm_and_si128(mask, px), _mm_andnot_si128(mask, dst)));
+    }
+}
+
+__attribute__((target("avx2")))
+inline __m256i ToUnorm8Avx2(__m256 c)
+{
+    c = _mm256_min_ps(_mm256_max_ps(c, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(c, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+}
+
+__attribute__((target("avx2")))
+void ShadeRowAvx2(uint32_t* row, int begin, int end, const TriangleRow& s)
+{
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int x = begin & ~7;
+    __m256i edge[3], edgeStep[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        __m256i step = _mm256_set1_epi32(s.edgeStep[i]);
+        edge[i] = _mm256_add_epi32(_mm256_set1_epi32(s.edge[i] + s.edgeStep[i] * x), _mm256_mullo_epi32(lane, step));
+        edgeStep[i] = _mm256_slli_epi32(step, 3);
+    }
+    const __m256i first = _mm256_set1_epi32(begin - 1);
+    const __m256i last = _mm256_set1_epi32(end);
+
+    for (; x < end; x += 8)
+    {
+        __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(x), lane);
+        __m256i outside = _mm256_srai_epi32(_mm256_or_si256(_mm256_or_si256(edge[0], edge[1]), edge[2]), 31);
+        __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi32(xs, first), _mm256_cmpgt_epi32(last, xs));
+        __m256i mask = _mm256_andnot_si256(outside, inRange);
+        for (int i = 0; i < 3; ++i)
+            edge[i] = _mm256_add_epi32(edge[i], edgeStep[i]);
+        if (_mm256_testz_si256(mask, mask))
+            continue;
+
+        __m256 fx = _mm256_cvtepi32_ps(xs);
+        __m256i r = ToUnorm8Avx2(_mm256_add_ps(_mm256_set1_ps(s.color[0]), _mm256_mul_ps(_mm256_set1_ps(s.colorStep[0]), fx)));
+        __m256i g = ToUnorm8Avx2(_mm256_add_ps(_mm256_set1_ps(s.color[1]), _mm256_mul_ps(_mm256_set1_ps(s.colorStep[1]), fx)));
+        __m256i b = ToUnorm8Avx2(_mm256_add_ps(_mm256_set1_ps(s.color[2]), _mm256_mul_ps(_mm256_set1_ps(s.colorStep[2]), fx)));
+        __m256i px = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+                                     _mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_set1_epi32((int)0xFF000000)));
+
+        __m256i dst = _mm256_load_si256((const __m256i*)(row + x));
+        _mm256_store_si256((__m256i*)(row + x), _mm256_blendv_epi8(dst, px, mask));
+    }
+}
+
+#endif // SOFTWARERENDERER_X86
+
+ShadeRowFn GetShadeRow()
+{
+#ifdef SOFTWARERENDERER_X86
+    switch (PixelConvert::GetLevel())
+    {
+        case PixelConvert::SimdLevel::AVX2: return ShadeRowAvx2;
+        case PixelConvert::SimdLevel::SSE2: return ShadeRowSse2;
+        default: break;
+    }
+#endif
+    return ShadeRowScalar;
+}
+
+int64_t FloorDiv(int64_t value, int64_t divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// Top-left fill rule: pixels exactly on an edge belong to the triangle on its
+// right or below it, so neighbours never both draw them. Returns the bias to add.
+int32_t FillBias(int32_t a, int32_t b)
+{
+    return a > 0 || (a == 0 && b > 0) ? 0 : -1;
+}
+
+// At the center of pixel (x, y)
+int64_t EdgeAt(int32_t a, int32_t b, int64_t c, int32_t subpixels, int x, int y)
+{
+    return (int64_t)a * (x * subpixels + subpixels / 2) + (int64_t)b * (y * subpixels + subpixels / 2) + c;
+}
+
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+SoftwareRenderer::SoftwareRenderer(int threads)
+    : m_width(0), m_height(0)
+    , m_tilesX(0), m_tilesY(0)
+    , m_rotation(0.0f)
+    , m_triangleVisible(false)
+    , m_useCustomColor(false)
+    , m_fixedTriangleSize(800.0f)
+    , m_stats{ 0, 0, 0, 0, 0.0, 0.0 }
+    , m_jobs(threads)
+{
+    // Same defaults as Renderer, see Renderer::InitializeGeometry
+    const float positions[6] = { 0.0f, 0.577f, -0.5f, -0.289f, 0.5f, -0.289f };
+    std::copy(positions, positions + 6, m_positions);
+    const VertexColors defaults = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+    m_vertexColors = defaults;
+    m_buttons.push_back(ButtonData{ 20.0f, 20.0f, 60.0f, 60.0f, false, "icon/button_icon.png" });
+
+    SetViewport(800, 600);
+}
+
+void SoftwareRenderer::SetViewport(int width, int height)
+{
+    m_width = std::max(1, width);
+    m_height = std::max(1, height);
+    m_tilesX = (m_width + kTileSize - 1) / kTileSize;
+    m_tilesY = (m_height + kTileSize - 1) / kTileSize;
+    m_bins.assign((size_t)GetThreadCount() * m_tilesX * m_tilesY, std::vector<uint32_t>());
+    m_pixels.assign((size_t)m_width * m_height * 4, 0);
+}
+
+void SoftwareRenderer::SetRotation(float rotation)
+{
+    m_rotation = rotation;
+}
+
+void SoftwareRenderer::SetTriangleVisible(bool visible)
+{
+    m_triangleVisible = visible;
+}
+
+void SoftwareRenderer::SetVertexColor(int vertexIndex, float r, float g, float b)
+{
+    float* colors[3] = { m_vertexColors.vertex1, m_vertexColors.vertex2, m_vertexColors.vertex3 };
+    if (vertexIndex < 0 || vertexIndex > 2)
+        return;
+    colors[vertexIndex][0] = r;
+    colors[vertexIndex][1] = g;
+    colors[vertexIndex][2] = b;
+    if (m_useCustomColor)
+        SetUseCustomColor(true);
+}
+
+void SoftwareRenderer::SetUseCustomColor(bool useCustom)
+{
+    // Renderer::UpdateTriangleGeometry also swaps in these corners
+    const float positions[6] = { 0.0f, 0.5f, -0.5f, -0.5f, 0.5f, -0.5f };
+    std::copy(positions, positions + 6, m_positions);
+    m_useCustomColor = useCustom;
+}
+
+void SoftwareRenderer::SetTriangleInstances(const std::vector<TriangleInstance>& instances)
+{
+    m_instances = instances;
+}
+
+size_t SoftwareRenderer::AddButton(float x, float y, float width, float height, const std::string& icon)
+{
+    m_buttons.push_back(ButtonData{ x, y, width, height, false, icon });
+    return m_buttons.size() - 1;
+}
+
+void SoftwareRenderer::SetButtonHovered(size_t index, bool hovered)
+{
+    if (index < m_buttons.size())
+        m_buttons[index].hovered = hovered;
+}
+
+bool SoftwareRenderer::LoadIconAtlas(const std::string& directory)
+{
+    std::vector<std::string> icons = TextureAtlas::ListImages(directory);
+    return !icons.empty() && m_iconAtlas.Build(icons, 4096, m_atlasPixels);
+}
+
+const std::vector<unsigned char>& SoftwareRenderer::GetPixels() const
+{
+    return m_pixels;
+}
+
+PixelDiff SoftwareRenderer::Compare(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, int tolerance)
+{
+    PixelDiff diff = { std::min(a.size(), b.size()) / 4, 0, 0 };
+    for (size_t i = 0; i < diff.pixels; ++i)
+    {
+        int pixelDiff = 0;
+        for (int c = 0; c < 3; ++c)
+            pixelDiff = std::max(pixelDiff, std::abs(a[i * 4 + c] - b[i * 4 + c]));
+        diff.maxDiff = std::max(diff.maxDiff, pixelDiff);
+        if (pixelDiff > tolerance)
+            ++diff.differing;
+    }
+    return diff;
+}
+
+void SoftwareRenderer::Render()
+{
+    TRACE_SCOPE("SoftwareRenderer::Render");
+    SetupPrimitives();
+    const JobStats before = m_jobs.GetStats();
+
+    // One slice per thread; the slice count fixes the bin layout, so it must not change with the frame
+    auto start = std::chrono::steady_clock::now();
+    m_jobs.ParallelFor((size_t)GetThreadCount(), 1, [this](size_t begin, size_t end) {
+        for (size_t slice = begin; slice < end; ++slice)
+            BinTriangles(slice);
+    });
+    m_stats.binMs = MsSince(start);
+
+    const size_t tiles = (size_t)m_tilesX * m_tilesY;
+    start = std::chrono::steady_clock::now();
+    m_jobs.ParallelFor(tiles, 1, [this](size_t begin, size_t end) {
+        TRACE_SCOPE("SoftwareRenderer::Shade");
+        alignas(32) uint32_t pixels[kTileSize * kTileSize];
+        for (size_t tile = begin; tile < end; ++tile)
+            ShadeTile((uint32_t)tile, pixels);
+    });
+    m_stats.shadeMs = MsSince(start);
+
+    m_stats.triangles = 0;
+    for (uint8_t valid : m_triangleValid)
+        m_stats.triangles += valid;
+    m_stats.binEntries = 0;
+    for (const std::vector<uint32_t>& bin : m_bins)
+        m_stats.binEntries += bin.size();
+    m_stats.tiles = tiles;
+    m_stats.jobsStolen = m_jobs.GetStats().stolen - before.stolen;
+}
+
+void SoftwareRenderer::SetupPrimitives()
+{
+    size_t triangles = m_triangleVisible ? std::max<size_t>(1, m_instances.size()) : 0;
+    m_triangles.resize(triangles);
+    m_triangleValid.assign(triangles, 0);
+
+    // Same quads and tints as Renderer::RebuildSprites
+    m_quads.clear();
+    for (const ButtonData& button : m_buttons)
+    {
+        const AtlasRegion* region = m_iconAtlas.Find(button.icon);
+        if (!region)
+            continue;
+        float tint = button.hovered ? 1.15f : 1.0f;
+        m_quads.push_back(SetupQuad{ button.x, button.y, button.x + button.width, button.y + button.height,
+                                     region->u0, region->v0, region->u1, region->v1,
+                                     { tint, tint, tint, 1.0f } });
+    }
+}
+
+// Corners in pixels (top-left origin) are snapped to the subpixel grid; false for
+// triangles that cover no pixel centers' worth of area or leave the guard band
+bool SoftwareRenderer::Setup(const float corners[6], const float colors[9], SetupTriangle& triangle) const
+{
+    for (int v = 0; v < 3; ++v)
+    {
+        if (!(std::fabs(corners[v * 2]) <= kGuardBand && std::fabs(corners[v * 2 + 1]) <= kGuardBand))
+            return false;
+    }
+    float extent = std::max(std::max({ corners[0], corners[2], corners[4] }) - std::min({ corners[0], corners[2], corners[4] }),
+                            std::max({ corners[1], corners[3], corners[5] }) - std::min({ corners[1], corners[3], corners[5] }));
+    const int32_t subpixels = extent < kFineMaxExtent ? kFineSubpixels : kCoarseSubpixels;
+    triangle.subpixels = subpixels;
+
+    int32_t x[3], y[3];
+    for (int v = 0; v < 3; ++v)
+    {
+        x[v] = (int32_t)std::lround(corners[v * 2] * subpixels);
+        y[v] = (int32_t)std::lround(corners[v * 2 + 1] * subpixels);
+    }
+
+    // Counter-clockwise on screen, so inside is positive for every edge
+    int order[3] = { 0, 1, 2 };
+    int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(y[1] - y[0]) * (x[2] - x[0]);
+    if (area == 0)
+        return false;
+    if (area < 0)
+    {
+        std::swap(order[1], order[2]);
+        area = -area;
+    }
+
+    // Edge i is opposite vertex i; at that vertex it equals the doubled area
+    for (int i = 0; i < 3; ++i)
+    {
+        int j = order[(i + 1) % 3], k = order[(i + 2) % 3];
+        triangle.a[i] = y[j] - y[k];
+        triangle.b[i] = x[k] - x[j];
+        triangle.c[i] = (int64_t)x[j] * y[k] - (int64_t)y[j] * x[k];
+    }
+
+    // Pixels whose centers can be inside
+    int32_t minX = std::min({ x[0], x[1], x[2] }), maxX = std::max({ x[0], x[1], x[2] });
+    int32_t minY = std::min({ y[0], y[1], y[2] }), maxY = std::max({ y[0], y[1], y[2] });
+    triangle.minX = (int)std::max<int64_t>(0, FloorDiv(minX - subpixels / 2 + subpixels - 1, subpixels));
+    triangle.minY = (int)std::max<int64_t>(0, FloorDiv(minY - subpixels / 2 + subpixels - 1, subpixels));
+    triangle.maxX = (int)std::min<int64_t>(m_width - 1, FloorDiv(maxX - subpixels / 2, subpixels));
+    triangle.maxY = (int)std::min<int64_t>(m_height - 1, FloorDiv(maxY - subpixels / 2, subpixels));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return false;
+
+    // Barycentric weight of vertex i is edge i / area; the color is linear in x and y
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        double atOrigin = 0.0, dx = 0.0, dy = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            double color = colors[order[i] * 3 + channel];
+            atOrigin += (double)EdgeAt(triangle.a[i], triangle.b[i], triangle.c[i], subpixels, 0, 0) * color;
+            dx += (double)triangle.a[i] * subpixels * color;
+            dy += (double)triangle.b[i] * subpixels * color;
+        }
+        triangle.color[channel] = atOrigin / (double)area;
+        triangle.colorDx[channel] = (float)(dx / (double)area);
+        triangle.colorDy[channel] = (float)(dy / (double)area);
+    }
+    return true;
+}
+
+// Each slice of the draw order is set up and binned into its own bins, so
+// walking the slices' bins in order keeps the draw order without locks
+void SoftwareRenderer::BinTriangles(size_t slice)
+{
+    TRACE_SCOPE("SoftwareRenderer::Bin");
+    const size_t tiles = (size_t)m_tilesX * m_tilesY;
+    std::vector<uint32_t>* bins = m_bins.data() + slice * tiles;
+    for (size_t tile = 0; tile < tiles; ++tile)
+        bins[tile].clear();
+
+    const size_t slices = (size_t)GetThreadCount();
+    const size_t first = m_triangles.size() * slice / slices;
+    const size_t end = m_triangles.size() * (slice + 1) / slices;
+
+    // The triangle vertex shaders, see Renderer::ComputeTriangleCorners
+    const float width = (float)m_width, height = (float)m_height;
+    const float aspectRatio = width / height;
+    const float sizeScale = m_fixedTriangleSize / std::min(width, height);
+    const float degreesToRadians = 3.14159265f / 180.0f;
+    const float* positions = m_positions;
+    float defaultColors[9] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+    if (m_useCustomColor)
+    {
+        std::copy(m_vertexColors.vertex1, m_vertexColors.vertex1 + 3, defaultColors);
+        std::copy(m_vertexColors.vertex2, m_vertexColors.vertex2 + 3, defaultColors + 3);
+        std::copy(m_vertexColors.vertex3, m_vertexColors.vertex3 + 3, defaultColors + 6);
+    }
+
+    for (size_t index = first; index < end; ++index)
+    {
+        float rotation = m_rotation, scale = sizeScale, offsetX = 0.0f, offsetY = 0.0f;
+        const float* colors = defaultColors;
+        if (!m_instances.empty())
+        {
+            const TriangleInstance& instance = m_instances[index];
+            rotation = instance.rotation;
+            scale = instance.scale * sizeScale;
+            offsetX = instance.offset[0];
+            offsetY = instance.offset[1];
+            colors = instance.colors;
+        }
+
+        float cosR = std::cos(rotation * degreesToRadians);
+        float sinR = std::sin(rotation * degreesToRadians);
+        float corners[6];
+        for (int v = 0; v < 3; ++v)
+        {
+            float px = positions[v * 2], py = positions[v * 2 + 1];
+            float x = (cosR * px + sinR * py) * scale;
+            float y = (-sinR * px + cosR * py) * scale;
+            if (aspectRatio > 1.0f)
+                x /= aspectRatio;
+            else
+                y *= aspectRatio;
+            corners[v * 2] = (x + offsetX + 1.0f) * 0.5f * width;
+            corners[v * 2 + 1] = (1.0f - (y + offsetY)) * 0.5f * height;
+        }
+
+        SetupTriangle& triangle = m_triangles[index];
+        if (!Setup(corners, colors, triangle))
+            continue;
+        m_triangleValid[index] = 1;
+
+        // Per tile and edge: skip the tile if it is all outside, flag the edge if all inside
+        for (int tileY = triangle.minY / kTileSize; tileY <= triangle.maxY / kTileSize; ++tileY)
+        {
+            for (int tileX = triangle.minX / kTileSize; tileX <= triangle.maxX / kTileSize; ++tileX)
+            {
+                int x0 = tileX * kTileSize, y0 = tileY * kTileSize;
+                int x1 = x0 + kTileSize - 1, y1 = y0 + kTileSize - 1;
+                uint32_t flags = 0;
+                bool outside = false;
+                for (int i = 0; i < 3 && !outside; ++i)
+                {
+                    int32_t a = triangle.a[i], b = triangle.b[i];
+                    int32_t bias = FillBias(a, b);
+                    int64_t highest = EdgeAt(a, b, triangle.c[i], triangle.subpixels, a > 0 ? x1 : x0, b > 0 ? y1 : y0) + bias;
+                    int64_t lowest = EdgeAt(a, b, triangle.c[i], triangle.subpixels, a > 0 ? x0 : x1, b > 0 ? y0 : y1) + bias;
+                    outside = highest < 0;
+                    if (lowest >= 0)
+                        flags |= 1u << (kEdgeInsideShift + i);
+                }
+                if (!outside)
+                    bins[(size_t)tileY * m_tilesX + tileX].push_back((uint32_t)index | flags);
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::ShadeTile(uint32_t tile, uint32_t* pixels)
+{
+    const int tileX = (int)(tile % m_tilesX) * kTileSize;
+    const int tileY = (int)(tile / m_tilesX) * kTileSize;
+    const int width = std::min(kTileSize, m_width - tileX);
+    const int height = std::min(kTileSize, m_height - tileY);
+    std::fill(pixels, pixels + kTileSize * kTileSize, kClearColor);
+
+    // Triangles in draw order: the slices' bins in turn, each in its own order
+    const size_t tiles = (size_t)m_tilesX * m_tilesY;
+    for (int slice = 0; slice < GetThreadCount(); ++slice)
+    {
+        for (uint32_t entry : m_bins[(size_t)slice * tiles + tile])
+            ShadeTriangle(m_triangles[entry & kIndexMask], entry & ~kIndexMask, tileX, tileY, pixels);
+    }
+    // Then the interface layer
+    for (const SetupQuad& quad : m_quads)
+        ShadeQuad(quad, tileX, tileY, pixels);
+
+    for (int y = 0; y < height; ++y)
+    {
+        unsigned char* row = m_pixels.data() + ((size_t)(tileY + y) * m_width + tileX) * 4;
+        std::memcpy(row, pixels + y * kTileSize, (size_t)width * 4);
+    }
+}
+
+void SoftwareRenderer::ShadeTriangle(const SetupTriangle& triangle, uint32_t flags, int tileX, int tileY, uint32_t* pixels)
+{
+    const ShadeRowFn shadeRow = GetShadeRow();
+    const int begin = std::max(triangle.minX, tileX) - tileX;
+    const int end = std::min(triangle.maxX, tileX + kTileSize - 1) - tileX + 1;
+    const int rowBegin = std::max(triangle.minY, tileY);
+    const int rowEnd = std::min(triangle.maxY, tileY + kTileSize - 1) + 1;
+
+    bool inside[3];
+    TriangleRow row;
+    for (int i = 0; i < 3; ++i)
+    {
+        inside[i] = (flags & (1u << (kEdgeInsideShift + i))) != 0;
+        row.edgeStep[i] = inside[i] ? 0 : triangle.a[i] * triangle.subpixels;
+        row.colorStep[i] = triangle.colorDx[i];
+    }
+    for (int y = rowBegin; y < rowEnd; ++y)
+    {
+        // An edge that crosses this tile stays within 32 bits anywhere in it
+        for (int i = 0; i < 3; ++i)
+        {
+            row.edge[i] = inside[i] ? 0 : (int32_t)(EdgeAt(triangle.a[i], triangle.b[i], triangle.c[i], triangle.subpixels, tileX, y) +
+                                                    FillBias(triangle.a[i], triangle.b[i]));
+            row.color[i] = (float)(triangle.color[i] + (double)triangle.colorDx[i] * tileX +
+                                   (double)triangle.colorDy[i] * y);
+        }
+        shadeRow(pixels + (y - tileY) * kTileSize, begin, end, row);
+    }
+}
+
+// spriteFragmentShader with linear filtering and clamp to edge, blended with
+// SRC_ALPHA, ONE_MINUS_SRC_ALPHA. A handful of buttons, so plain scalar code.
+void SoftwareRenderer::ShadeQuad(const SetupQuad& quad, int tileX, int tileY, uint32_t* pixels)
+{
+    // Pixel centers in [x0, x1) x [y0, y1), like the two triangles of the quad
+    int x0 = std::max(tileX, (int)std::ceil(quad.x0 - 0.5f));
+    int x1 = std::min(std::min(tileX + kTileSize, m_width), (int)std::ceil(quad.x1 - 0.5f));
+    int y0 = std::max(tileY, (int)std::ceil(quad.y0 - 0.5f));
+    int y1 = std::min(std::min(tileY + kTileSize, m_height), (int)std::ceil(quad.y1 - 0.5f));
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    const int atlasWidth = m_atlasPixels.width, atlasHeight = m_atlasPixels.height;
+    const unsigned char* texels = m_atlasPixels.rgba.data();
+    auto texel = [&](int x, int y, int channel) {
+        x = std::min(std::max(x, 0), atlasWidth - 1);
+        y = std::min(std::max(y, 0), atlasHeight - 1);
+        return texels[((size_t)y * atlasWidth + x) * 4 + channel] / 255.0f;
+    };
+
+    for (int y = y0; y < y1; ++y)
+    {
+        float v = quad.v0 + (y + 0.5f - quad.y0) / (quad.y1 - quad.y0) * (quad.v1 - quad.v0);
+        float ty = v * atlasHeight - 0.5f;
+        int iy = (int)std::floor(ty);
+        float fy = ty - iy;
+        uint32_t* row = pixels + (y - tileY) * kTileSize;
+        for (int x = x0; x < x1; ++x)
+        {
+            float u = quad.u0 + (x + 0.5f - quad.x0) / (quad.x1 - quad.x0) * (quad.u1 - quad.u0);
+            float tx = u * atlasWidth - 0.5f;
+            int ix = (int)std::floor(tx);
+            float fx = tx - ix;
+
+            float source[4];
+            for (int c = 0; c < 4; ++c)
+            {
+                float top = texel(ix, iy, c) * (1.0f - fx) + texel(ix + 1, iy, c) * fx;
+                float bottom = texel(ix, iy + 1, c) * (1.0f - fx) + texel(ix + 1, iy + 1, c) * fx;
+                source[c] = std::min(std::max((top * (1.0f - fy) + bottom * fy) * quad.tint[c], 0.0f), 1.0f);
+            }
+
+            uint32_t& target = row[x - tileX];
+            float alpha = source[3];
+            uint32_t result = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                float destination = ((target >> (c * 8)) & 0xFF) / 255.0f;
+                result |= ToUnorm8(source[c] * alpha + destination * (1.0f - alpha)) << (c * 8);
+            }
+            target = result;
+        }
+    }
+}
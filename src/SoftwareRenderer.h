@@ -0,0 +1,115 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "Renderer.h"
+#include "TextureLoader.h"
+
+struct SoftwareRenderStats
+{
+    size_t triangles;   // Set up and binned
+    size_t binEntries;  // Triangle x tile pairs
+    size_t tiles;
+    size_t jobsStolen;  // Bin and shade pieces run by another thread than the one that split them off
+    double binMs, shadeMs;
+};
+
+struct PixelDiff
+{
+    size_t pixels;
+    size_t differing; // Any of R, G, B off by more than the tolerance
+    int maxDiff;      // Largest channel difference, alpha ignored
+};
+
+// Draws the same scene as Renderer (triangle or instances, then the icon
+// buttons) on the CPU, for machines whose only GL is a software one.
+// Triangles are set up and binned into 64x64 screen tiles in parallel, one
+// slice of the draw order per thread; then whole tiles are shaded in a
+// tile-local buffer, spread over the threads by a JobSystem::ParallelFor.
+// The triangle rows go 4 (SSE2) or 8 (AVX2) pixels at a time, following
+// PixelConvert::GetLevel().
+// Not thread-safe; the calling thread is one of the workers.
+class SoftwareRenderer
+{
+public:
+    static constexpr int kTileSize = 64;
+
+    explicit SoftwareRenderer(int threads = 0); // 0 = one per hardware thread
+
+    // Same scene calls as Renderer
+    void SetViewport(int width, int height);
+    void SetRotation(float rotation);
+    void SetTriangleVisible(bool visible);
+    void SetVertexColor(int vertexIndex, float r, float g, float b); // 0 = up, 1 = left, 2 = right
+    void SetUseCustomColor(bool useCustom);
+    void SetTriangleInstances(const std::vector<TriangleInstance>& instances);
+    size_t AddButton(float x, float y, float width, float height, const std::string& icon);
+    void SetButtonHovered(size_t index, bool hovered);
+
+    // Decodes and packs *.png under directory, as Renderer does on its loader;
+    // here it is synchronous. Buttons are not drawn without it.
+    bool LoadIconAtlas(const std::string& directory = "icon");
+
+    void Render();
+    const std::vector<unsigned char>& GetPixels() const; // RGBA, top row first, as OffscreenTarget::ReadPixels
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    int GetThreadCount() const { return m_jobs.GetThreadCount(); }
+    const SoftwareRenderStats& GetFrameStats() const { return m_stats; }
+
+    // Two RGBA images of the same size, e.g. GetPixels() against OffscreenTarget::ReadPixels()
+    static PixelDiff Compare(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, int tolerance);
+
+private:
+    // Edge functions in subpixel fixed point, E = A * x + B * y + C with
+    // inside >= 0; colors as planes over pixel centers
+    struct SetupTriangle
+    {
+        int32_t subpixels; // Per pixel, 256 or 16 for big triangles
+        int32_t a[3], b[3];
+        int64_t c[3];
+        int minX, minY, maxX, maxY; // Pixels, clipped to the viewport
+        double color[3];            // At the center of pixel (0, 0)
+        float colorDx[3], colorDy[3];
+    };
+
+    struct SetupQuad
+    {
+        float x0, y0, x1, y1; // Pixels
+        float u0, v0, u1, v1;
+        float tint[4];
+    };
+
+    void SetupPrimitives();
+    void BinTriangles(size_t slice);
+    void ShadeTile(uint32_t tile, uint32_t* pixels);
+    void ShadeTriangle(const SetupTriangle& triangle, uint32_t flags, int tileX, int tileY, uint32_t* pixels);
+    void ShadeQuad(const SetupQuad& quad, int tileX, int tileY, uint32_t* pixels);
+    bool Setup(const float corners[6], const float colors[9], SetupTriangle& triangle) const;
+
+    int m_width, m_height;
+    int m_tilesX, m_tilesY;
+    float m_rotation;
+    bool m_triangleVisible;
+    bool m_useCustomColor;
+    float m_fixedTriangleSize;
+    float m_positions[6]; // Triangle corners before the vertex shader, as Renderer has them
+    VertexColors m_vertexColors;
+    std::vector<TriangleInstance> m_instances;
+    std::vector<ButtonData> m_buttons;
+
+    TextureAtlas m_iconAtlas;
+    DecodedImage m_atlasPixels;
+
+    // Per frame
+    std::vector<SetupTriangle> m_triangles;
+    std::vector<uint8_t> m_triangleValid;      // Degenerate or outside the guard band = 0
+    std::vector<std::vector<uint32_t>> m_bins; // [slice * tiles + tile], triangle index | edge flags
+    std::vector<SetupQuad> m_quads;
+    std::vector<unsigned char> m_pixels;
+    SoftwareRenderStats m_stats;
+
+    JobSystem m_jobs;
+};
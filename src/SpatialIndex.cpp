@@ -0,0 +1,203 @@
+#include "SpatialIndex.h"
+#include "JobSystem.h"
+#include <algorithm>
+
+void SpatialIndex::BuildRects(const std::vector<Bounds>& rects)
+{
+    m_bounds = rects;
+    m_triangles.clear();
+    Build(nullptr);
+}
+
+void SpatialIndex::BuildTriangles(const std::vector<float>& corners, JobSystem* jobs)
+{
+    m_triangles = corners;
+    m_bounds.resize(corners.size() / 6);
+    auto computeBounds = [this, &corners](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float* t = &corners[i * 6];
+            m_bounds[i].minX = std::min(t[0], std::min(t[2], t[4]));
+            m_bounds[i].maxX = std::max(t[0], std::max(t[2], t[4]));
+            m_bounds[i].minY = std::min(t[1], std::min(t[3], t[5]));
+            m_bounds[i].maxY = std::max(t[1], std::max(t[3], t[5]));
+        }
+    };
+    if (jobs)
+        jobs->ParallelFor(m_bounds.size(), kParallelBuildMin, computeBounds);
+    else
+        computeBounds(0, m_bounds.size());
+    Build(jobs);
+}
+
+void SpatialIndex::Build(JobSystem* jobs)
+{
+    uint32_t count = (uint32_t)m_bounds.size();
+    m_nodes.clear();
+    m_order.resize(count);
+    if (count == 0)
+        return;
+
+    // Items are moved around by value while building, so the splits read memory in order
+    std::vector<BuildItem> items(count);
+    auto fillItems = [this, &items](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            items[i].bounds = m_bounds[i];
+            items[i].center[0] = (m_bounds[i].minX + m_bounds[i].maxX) * 0.5f;
+            items[i].center[1] = (m_bounds[i].minY + m_bounds[i].maxY) * 0.5f;
+            items[i].id = (uint32_t)i;
+        }
+    };
+    if (jobs)
+        jobs->ParallelFor(count, kParallelBuildMin, fillItems);
+    else
+        fillItems(0, count);
+
+    m_nodes.reserve(2 * (count / kLeafSize + 1));
+    BuildNode(items, 0, count, m_nodes, jobs);
+
+    for (uint32_t i = 0; i < count; ++i)
+        m_order[i] = items[i].id;
+}
+
+// Median split on the longer axis of the item centers
+uint32_t SpatialIndex::BuildNode(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, std::vector<Node>& nodes, JobSystem* jobs)
+{
+    uint32_t nodeIndex = (uint32_t)nodes.size();
+    nodes.push_back(Node());
+
+    Bounds bounds = items[begin].bounds;
+    float centerMin[2] = { items[begin].center[0], items[begin].center[1] };
+    float centerMax[2] = { centerMin[0], centerMin[1] };
+    uint32_t maxItem = 0;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const BuildItem& item = items[i];
+        bounds.minX = std::min(bounds.minX, item.bounds.minX);
+        bounds.minY = std::min(bounds.minY, item.bounds.minY);
+        bounds.maxX = std::max(bounds.maxX, item.bounds.maxX);
+        bounds.maxY = std::max(bounds.maxY, item.bounds.maxY);
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            centerMin[axis] = std::min(centerMin[axis], item.center[axis]);
+            centerMax[axis] = std::max(centerMax[axis], item.center[axis]);
+        }
+        maxItem = std::max(maxItem, item.id);
+    }
+
+    Node node;
+    node.bounds = bounds;
+    node.maxItem = maxItem;
+
+    int axis = centerMax[0] - centerMin[0] >= centerMax[1] - centerMin[1] ? 0 : 1;
+    if (end - begin <= kLeafSize || centerMax[axis] == centerMin[axis])
+    {
+        node.first = begin;
+        node.count = end - begin;
+        nodes[nodeIndex] = node;
+        return nodeIndex;
+    }
+
+    uint32_t middle = begin + (end - begin) / 2;
+    std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end,
+                     [axis](const BuildItem& a, const BuildItem& b) { return a.center[axis] < b.center[axis]; });
+
+    if (!jobs || jobs->GetThreadCount() == 1 || end - middle < kParallelBuildMin)
+    {
+        BuildNode(items, begin, middle, nodes, jobs);
+        node.first = BuildNode(items, middle, end, nodes, jobs);
+    }
+    else
+    {
+        // The halves touch disjoint items; the right one goes into its own
+        // nodes and is appended after the left, where the serial build puts it
+        std::vector<Node> rightNodes;
+        rightNodes.reserve(2 * ((end - middle) / kLeafSize + 1));
+        JobSystem::JobHandle right = jobs->Schedule([&, middle, end]() { BuildNode(items, middle, end, rightNodes, jobs); });
+        BuildNode(items, begin, middle, nodes, jobs);
+        jobs->Wait(right);
+
+        const uint32_t base = (uint32_t)nodes.size();
+        for (Node& child : rightNodes)
+        {
+            if (child.count == 0)
+                child.first += base;
+        }
+        nodes.insert(nodes.end(), rightNodes.begin(), rightNodes.end());
+        node.first = base;
+    }
+    node.count = 0;
+    nodes[nodeIndex] = node;
+    return nodeIndex;
+}
+
+bool SpatialIndex::Contains(uint32_t item, float x, float y) const
+{
+    if (!m_bounds[item].Contains(x, y))
+        return false;
+    if (m_triangles.empty())
+        return true;
+
+    // Same side of all three edges, either winding
+    const float* t = &m_triangles[(size_t)item * 6];
+    float e0 = (t[2] - t[0]) * (y - t[1]) - (t[3] - t[1]) * (x - t[0]);
+    float e1 = (t[4] - t[2]) * (y - t[3]) - (t[5] - t[3]) * (x - t[2]);
+    float e2 = (t[0] - t[4]) * (y - t[5]) - (t[1] - t[5]) * (x - t[4]);
+    return (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) || (e0 <= 0.0f && e1 <= 0.0f && e2 <= 0.0f);
+}
+
+bool SpatialIndex::Pick(float x, float y, size_t& index) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    bool found = false;
+    uint32_t best = 0;
+    uint32_t stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node& node = m_nodes[stack[--top]];
+        if ((found && node.maxItem <= best) || !node.bounds.Contains(x, y))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                uint32_t item = m_order[i];
+                if ((!found || item > best) && Contains(item, x, y))
+                {
+                    best = item;
+                    found = true;
+                }
+            }
+        }
+        else
+        {
+            // Median splits keep the depth near log2(n / kLeafSize), far below the stack size
+            uint32_t left = (uint32_t)(&node - m_nodes.data()) + 1;
+            stack[top++] = node.first;
+            stack[top++] = left;
+        }
+    }
+
+    if (found)
+        index = best;
+    return found;
+}
+
+bool SpatialIndex::PickLinear(float x, float y, size_t& index) const
+{
+    for (size_t item = m_bounds.size(); item-- > 0;)
+    {
+        if (Contains((uint32_t)item, x, y))
+        {
+            index = item;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+struct Bounds
+{
+    float minX, minY, maxX, maxY;
+
+    bool Contains(float x, float y) const { return x >= minX && x <= maxX && y >= minY && y <= maxY; }
+};
+
+// Bounding volume hierarchy over rectangles or triangles (pixels) for pointer
+// hit tests: a query only descends into boxes that contain the point, so it
+// stays logarithmic as long as items do not pile up on top of each other.
+// Immutable once built, so one thread can query while another builds the next.
+// Given a JobSystem, large triangle sets are built in parallel; the tree comes
+// out node for node the same as the serial build.
+class SpatialIndex
+{
+public:
+    static const uint32_t kLeafSize = 4;
+    static const uint32_t kParallelBuildMin = 8192; // Items below which a subtree is not worth a job
+
+    void BuildRects(const std::vector<Bounds>& rects);
+    void BuildTriangles(const std::vector<float>& corners, JobSystem* jobs = nullptr); // x0 y0 x1 y1 x2 y2 per triangle
+
+    // Topmost item under the point, i.e. the one added last
+    bool Pick(float x, float y, size_t& index) const;
+    // Same answer by testing every item, reference for the benchmark
+    bool PickLinear(float x, float y, size_t& index) const;
+
+    size_t GetSize() const { return m_bounds.size(); }
+    size_t GetNodeCount() const { return m_nodes.size(); }
+
+private:
+    struct Node
+    {
+        Bounds bounds;
+        uint32_t first;   // Leaf: into m_order; inner: right child (left is the next node)
+        uint32_t count;   // 0 for inner nodes
+        uint32_t maxItem; // Highest item below, lets Pick skip subtrees that cannot win
+    };
+
+    struct BuildItem
+    {
+        Bounds bounds;
+        float center[2];
+        uint32_t id;
+    };
+
+    void Build(JobSystem* jobs);
+    // Appends the subtree to nodes; child links are relative to nodes[0]
+    uint32_t BuildNode(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, std::vector<Node>& nodes, JobSystem* jobs);
+    bool Contains(uint32_t item, float x, float y) const;
+
+    std::vector<Bounds> m_bounds;
+    std::vector<float> m_triangles; // Empty when indexing rectangles
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_order;
+};
@@ -0,0 +1,40 @@
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+
+void SpriteBatch::Clear()
+{
+    m_vertices.clear();
+}
+
+void SpriteBatch::AddQuad(float x, float y, float width, float height, const AtlasRegion& region, const float tint[4])
+{
+    const float corners[4][4] = {
+        { x,         y,          region.u0, region.v0 }, // Top-left
+        { x + width, y,          region.u1, region.v0 }, // Top-right
+        { x + width, y + height, region.u1, region.v1 }, // Bottom-right
+        { x,         y + height, region.u0, region.v1 }  // Bottom-left
+    };
+
+    for (const float* corner : corners)
+    {
+        SpriteVertex vertex;
+        vertex.position[0] = corner[0];
+        vertex.position[1] = corner[1];
+        vertex.texCoord[0] = corner[2];
+        vertex.texCoord[1] = corner[3];
+        for (int c = 0; c < 4; ++c)
+            vertex.tint[c] = tint[c];
+        m_vertices.push_back(vertex);
+    }
+}
+
+void SpriteBatch::BuildQuadIndices(size_t quadCount, std::vector<uint32_t>& indices)
+{
+    const uint32_t order[kIndicesPerQuad] = { 0, 1, 2, 0, 2, 3 };
+    indices.resize(quadCount * kIndicesPerQuad);
+    for (size_t quad = 0; quad < quadCount; ++quad)
+    {
+        for (int i = 0; i < kIndicesPerQuad; ++i)
+            indices[quad * kIndicesPerQuad + i] = (uint32_t)(quad * kVerticesPerQuad) + order[i];
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct AtlasRegion;
+
+struct SpriteVertex
+{
+    float position[2]; // Pixels, top-left origin
+    float texCoord[2];
+    float tint[4];     // Multiplies the texel, e.g. brightened for hover
+};
+
+// Collects textured quads that share one atlas into a single vertex array,
+// so a whole UI layer goes out in one draw call. CPU only; the owner uploads
+// GetVertices() (four corners per quad) and draws GetIndexCount() indices as
+// GL_TRIANGLES from an index buffer filled by BuildQuadIndices().
+class SpriteBatch
+{
+public:
+    static const int kVerticesPerQuad = 4;
+    static const int kIndicesPerQuad = 6;
+
+    void Clear();
+    void AddQuad(float x, float y, float width, float height, const AtlasRegion& region, const float tint[4]);
+
+    const SpriteVertex* GetVertices() const { return m_vertices.data(); }
+    size_t GetVertexCount() const { return m_vertices.size(); }
+    size_t GetQuadCount() const { return m_vertices.size() / kVerticesPerQuad; }
+    size_t GetIndexCount() const { return GetQuadCount() * kIndicesPerQuad; }
+    size_t GetSizeBytes() const { return m_vertices.size() * sizeof(SpriteVertex); }
+
+    // Two triangles per quad, the same for every batch of up to quadCount quads
+    static void BuildQuadIndices(size_t quadCount, std::vector<uint32_t>& indices);
+
+private:
+    std::vector<SpriteVertex> m_vertices;
+};
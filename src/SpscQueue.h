@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free single-producer/single-consumer ring.
+// Push() only from the producer thread, Pop() only from the consumer thread.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue()
+        : m_head(0), m_tailCache(0)
+        , m_tail(0), m_headCache(0)
+    {
+    }
+
+    bool Push(const T& item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tailCache == Capacity)
+        {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head - m_tailCache == Capacity)
+                return false;
+        }
+
+        m_items[head & (Capacity - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_headCache)
+        {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail == m_headCache)
+                return false;
+        }
+
+        item = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> m_head;
+    size_t m_tailCache;
+
+    alignas(64) std::atomic<size_t> m_tail;
+    size_t m_headCache;
+
+    alignas(64) T m_items[Capacity];
+};
@@ -0,0 +1,219 @@
+#include <GL/glew.h>
+#include "StreamBuffer.h"
+#include <wx/log.h>
+#include <algorithm>
+
+StreamBuffer::StreamBuffer()
+    : m_buffer(0)
+    , m_persistent(false)
+    , m_allowPersistent(true)
+    , m_mapped(nullptr)
+    , m_rangeMapped(false)
+    , m_segmentSize(0)
+    , m_segment(0)
+    , m_head(0)
+{
+    for (void*& fence : m_fences)
+        fence = nullptr;
+
+    m_stats.bytesWritten = 0;
+    m_stats.fenceWaits = 0;
+    m_stats.orphans = 0;
+    m_stats.reallocations = 0;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    Destroy();
+}
+
+bool StreamBuffer::Create(size_t segmentSize, bool allowPersistent)
+{
+    Destroy();
+    m_allowPersistent = allowPersistent;
+    return Allocate(segmentSize);
+}
+
+void StreamBuffer::Destroy()
+{
+    Release();
+    ReleaseRetired(true);
+    m_segmentSize = 0;
+}
+
+bool StreamBuffer::Allocate(size_t segmentSize)
+{
+    Release();
+
+    m_segmentSize = (segmentSize + kAlignment - 1) / kAlignment * kAlignment;
+    size_t totalSize = m_segmentSize * kSegmentCount;
+    m_persistent = m_allowPersistent && GLEW_ARB_buffer_storage;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    if (m_persistent)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+        m_mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags);
+        if (!m_mapped)
+        {
+            // Immutable storage can't be respecified, start over with a mutable buffer
+            wxLogWarning("Persistent mapping failed, streaming through buffer orphaning");
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &m_buffer);
+            m_persistent = false;
+            m_allowPersistent = false;
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        }
+    }
+    if (!m_persistent)
+        glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_segment = 0;
+    m_head = 0;
+    return m_buffer != 0;
+}
+
+void StreamBuffer::Release()
+{
+    for (void*& fence : m_fences)
+    {
+        if (fence) glDeleteSync((GLsync)fence);
+        fence = nullptr;
+    }
+
+    if (m_buffer)
+    {
+        if (m_mapped || m_rangeMapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    m_buffer = 0;
+    m_mapped = nullptr;
+    m_rangeMapped = false;
+}
+
+void StreamBuffer::Grow(size_t segmentSize)
+{
+    // Written data stays valid after unmapping, draws already set up keep reading it
+    if (m_buffer)
+    {
+        if (m_mapped || m_rangeMapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        m_retired.push_back(RetiredBuffer{ m_buffer, kSegmentCount });
+    }
+    m_buffer = 0;
+    m_mapped = nullptr;
+    m_rangeMapped = false;
+
+    Allocate(segmentSize);
+    ++m_stats.reallocations;
+}
+
+void StreamBuffer::ReleaseRetired(bool all)
+{
+    size_t kept = 0;
+    for (RetiredBuffer& retired : m_retired)
+    {
+        if (all || --retired.framesLeft <= 0)
+            glDeleteBuffers(1, &retired.buffer);
+        else
+            m_retired[kept++] = retired;
+    }
+    m_retired.resize(kept);
+}
+
+void* StreamBuffer::Map(size_t size, size_t& offset)
+{
+    size_t alignedSize = (size + kAlignment - 1) / kAlignment * kAlignment;
+
+    if (m_persistent)
+    {
+        // One frame's data must fit its segment. Regrowing is rare; the old buffer
+        // is retired, not deleted, so ranges mapped earlier this frame stay drawable.
+        if (m_head + alignedSize > m_segmentSize)
+            Grow(std::max(m_segmentSize * 2, alignedSize));
+
+        offset = m_segment * m_segmentSize + m_head;
+        m_head += alignedSize;
+        m_stats.bytesWritten += size;
+        return m_mapped + offset;
+    }
+
+    size_t totalSize = m_segmentSize * kSegmentCount;
+    if (alignedSize > totalSize)
+    {
+        Grow(alignedSize);
+        totalSize = m_segmentSize * kSegmentCount;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+    if (m_head + alignedSize > totalSize)
+    {
+        // Detach the old storage (the driver keeps it alive for pending draws) and start over
+        glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+        m_head = 0;
+        ++m_stats.orphans;
+    }
+
+    offset = m_head;
+    void* pointer = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, access);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_rangeMapped = pointer != nullptr;
+    m_head += alignedSize;
+    m_stats.bytesWritten += size;
+    return pointer;
+}
+
+void StreamBuffer::Unmap()
+{
+    if (!m_rangeMapped)
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_rangeMapped = false;
+}
+
+void StreamBuffer::EndFrame()
+{
+    if (!m_retired.empty())
+        ReleaseRetired(false);
+    if (!m_persistent || !m_buffer)
+        return;
+
+    m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_segment = (m_segment + 1) % kSegmentCount;
+    m_head = 0;
+
+    // Normally signalled long ago; only a GPU more than two frames behind blocks here
+    GLsync fence = (GLsync)m_fences[m_segment];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            ++m_stats.fenceWaits;
+            do
+            {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            } while (result == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fence);
+        m_fences[m_segment] = nullptr;
+    }
+}
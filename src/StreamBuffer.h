@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Ring buffer for vertex data rewritten every frame. With ARB_buffer_storage the
+// whole ring is mapped once (persistent + coherent) and split into segments, one
+// per frame in flight; a fence per segment makes sure the CPU never overwrites
+// data the GPU may still read. Without it, ranges are mapped unsynchronized and
+// the buffer is orphaned whenever it wraps.
+// Growing mid-frame replaces the buffer, but the old one is only deleted once
+// its segments have come round again: ranges mapped earlier in the frame may be
+// bound to vertex arrays, and deleting a buffer detaches it from the bound one.
+class StreamBuffer
+{
+public:
+    static const int kSegmentCount = 3;
+
+    struct Stats
+    {
+        size_t bytesWritten;
+        unsigned int fenceWaits;  // EndFrame() found the next segment still in use
+        unsigned int orphans;     // Fallback path wrapped around
+        unsigned int reallocations;
+    };
+
+    StreamBuffer();
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // segmentSize = bytes one frame may write; grows on demand
+    bool Create(size_t segmentSize, bool allowPersistent = true);
+    void Destroy();
+
+    // Returns a write pointer for size bytes and their offset in GetBuffer().
+    // Call Unmap() before drawing from the range.
+    void* Map(size_t size, size_t& offset);
+    void Unmap();
+
+    // Once per frame, after the last draw reading this frame's data
+    void EndFrame();
+
+    unsigned int GetBuffer() const { return m_buffer; }
+    bool IsPersistent() const { return m_persistent; }
+    size_t GetSegmentSize() const { return m_segmentSize; }
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    static const size_t kAlignment = 64;
+
+    bool Allocate(size_t segmentSize);
+    void Grow(size_t segmentSize);
+    void Release();
+    void ReleaseRetired(bool all);
+
+    unsigned int m_buffer;
+    bool m_persistent;
+    bool m_allowPersistent;
+    unsigned char* m_mapped;   // Persistent mapping of the whole ring
+    bool m_rangeMapped;        // Fallback path has a range mapped
+    size_t m_segmentSize;
+    int m_segment;
+    size_t m_head;             // Next free byte, relative to the segment (persistent) or buffer
+    void* m_fences[kSegmentCount]; // GLsync
+    Stats m_stats;
+
+    // Replaced by Grow(), unmapped, kept alive for a few more EndFrame() calls
+    struct RetiredBuffer
+    {
+        unsigned int buffer;
+        int framesLeft;
+    };
+    std::vector<RetiredBuffer> m_retired;
+};
@@ -0,0 +1,197 @@
+#include <GL/glew.h>
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
+#include <wx/log.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+int NextPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value)
+        result *= 2;
+    return result;
+}
+
+struct PackedImage
+{
+    size_t index;
+    int x, y; // Of the bordered rectangle
+};
+
+// Shelf packing at a fixed width; returns the height used
+int PackShelves(const std::vector<DecodedImage>& images, const std::vector<size_t>& order, int width,
+                std::vector<PackedImage>& placed)
+{
+    placed.clear();
+    int x = 0, y = 0, shelfHeight = 0;
+    for (size_t index : order)
+    {
+        int w = images[index].width + 2 * TextureAtlas::kBorder;
+        int h = images[index].height + 2 * TextureAtlas::kBorder;
+        if (x + w > width)
+        {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        placed.push_back(PackedImage{ index, x, y });
+        x += w;
+        shelfHeight = std::max(shelfHeight, h);
+    }
+    return y + shelfHeight;
+}
+
+void CopyWithBorder(const DecodedImage& image, DecodedImage& atlas, int left, int top)
+{
+    const int b = TextureAtlas::kBorder;
+    for (int row = -b; row < image.height + b; ++row)
+    {
+        int sourceRow = std::min(std::max(row, 0), image.height - 1);
+        const unsigned char* source = &image.rgba[(size_t)sourceRow * image.width * 4];
+        unsigned char* target = &atlas.rgba[((size_t)(top + b + row) * atlas.width + left) * 4];
+
+        for (int i = 0; i < b; ++i)
+            std::memcpy(target + i * 4, source, 4);
+        std::memcpy(target + b * 4, source, (size_t)image.width * 4);
+        for (int i = 0; i < b; ++i)
+            std::memcpy(target + (b + image.width + i) * 4, source + (image.width - 1) * 4, 4);
+    }
+}
+}
+
+TextureAtlas::TextureAtlas()
+    : m_loader(nullptr)
+    , m_texture(0)
+    , m_width(0), m_height(0)
+    , m_built(false)
+{
+}
+
+unsigned int TextureAtlas::Request(TextureLoader& loader, const std::vector<std::string>& paths, int maxSize)
+{
+    if (m_texture)
+        return m_texture;
+
+    std::string key = "atlas:";
+    for (const std::string& path : paths)
+        key += path + ";";
+
+    m_loader = &loader;
+    m_texture = loader.RequestTexture(key, [this, paths, maxSize](DecodedImage& atlas) {
+        return Build(paths, maxSize, atlas);
+    });
+    return m_texture;
+}
+
+bool TextureAtlas::IsReady() const
+{
+    // Regions are complete before the worker hands over the pixels, the upload comes later
+    return m_built.load(std::memory_order_acquire) && (!m_loader || m_loader->IsReady(m_texture));
+}
+
+unsigned int TextureAtlas::GetTexture() const
+{
+    return m_texture;
+}
+
+const AtlasRegion* TextureAtlas::Find(const std::string& path) const
+{
+    if (!IsReady())
+        return nullptr;
+    auto it = m_regions.find(path);
+    return it != m_regions.end() ? &it->second : nullptr;
+}
+
+int TextureAtlas::GetWidth() const
+{
+    return IsReady() ? m_width : 0;
+}
+
+int TextureAtlas::GetHeight() const
+{
+    return IsReady() ? m_height : 0;
+}
+
+bool TextureAtlas::Build(const std::vector<std::string>& paths, int maxSize, DecodedImage& atlas)
+{
+    std::vector<DecodedImage> images(paths.size());
+    std::vector<size_t> order;
+    long long area = 0;
+    int widest = 0;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (!TextureLoader::DecodeImage(paths[i], images[i]))
+            continue;
+        order.push_back(i);
+        area += (long long)(images[i].width + 2 * kBorder) * (images[i].height + 2 * kBorder);
+        widest = std::max(widest, images[i].width + 2 * kBorder);
+    }
+    if (order.empty())
+        return false;
+
+    // Tallest first keeps shelves tight; ties by path order for a stable layout
+    std::stable_sort(order.begin(), order.end(), [&images](size_t a, size_t b) {
+        return images[a].height > images[b].height;
+    });
+
+    // Narrowest power-of-two width whose packing also fits in height
+    std::vector<PackedImage> placed;
+    int width = NextPowerOfTwo(std::max(widest, (int)std::sqrt((double)area)));
+    int height = PackShelves(images, order, width, placed);
+    while (height > width && width < maxSize)
+    {
+        width *= 2;
+        height = PackShelves(images, order, width, placed);
+    }
+    if (width > maxSize || height > maxSize)
+    {
+        wxLogWarning("%zu images do not fit in a %dx%d atlas", order.size(), maxSize, maxSize);
+        return false;
+    }
+
+    atlas.width = width;
+    atlas.height = height;
+    atlas.rgba.assign((size_t)width * height * 4, 0);
+
+    std::unordered_map<std::string, AtlasRegion> regions;
+    for (const PackedImage& place : placed)
+    {
+        const DecodedImage& image = images[place.index];
+        CopyWithBorder(image, atlas, place.x, place.y);
+
+        AtlasRegion region;
+        region.x = place.x + kBorder;
+        region.y = place.y + kBorder;
+        region.width = image.width;
+        region.height = image.height;
+        region.u0 = (float)region.x / width;
+        region.v0 = (float)region.y / height;
+        region.u1 = (float)(region.x + region.width) / width;
+        region.v1 = (float)(region.y + region.height) / height;
+        regions[paths[place.index]] = region;
+    }
+
+    m_regions.swap(regions);
+    m_width = width;
+    m_height = height;
+    m_built.store(true, std::memory_order_release);
+    return true;
+}
+
+std::vector<std::string> TextureAtlas::ListImages(const std::string& directory)
+{
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".png")
+            paths.push_back(entry.path().generic_string());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TextureLoader;
+struct DecodedImage;
+
+struct AtlasRegion
+{
+    int x, y, width, height; // Pixels, without the border
+    float u0, v0, u1, v1;    // v0 = top row
+};
+
+// Many small images packed into one texture, so UI quads that use different
+// icons can share a texture bind and a draw call. Shelf packing, tallest image
+// first; each image gets a 1-pixel border copied from its edge so linear
+// filtering never picks up a neighbour.
+class TextureAtlas
+{
+public:
+    static const int kBorder = 1;
+
+    TextureAtlas();
+
+    // Decode and packing run on a loader worker; the texture id comes back at
+    // once and regions appear when the upload is done (IsReady). Once per atlas.
+    unsigned int Request(TextureLoader& loader, const std::vector<std::string>& paths, int maxSize = 4096);
+    bool IsReady() const; // GL thread
+    unsigned int GetTexture() const;
+
+    // nullptr until ready, or if the image was not part of the atlas
+    const AtlasRegion* Find(const std::string& path) const;
+    int GetWidth() const;
+    int GetHeight() const;
+
+    // CPU only: decode, pack and compose into one image. Images that fail to
+    // decode are left out; false if none fit in maxSize x maxSize.
+    bool Build(const std::vector<std::string>& paths, int maxSize, DecodedImage& atlas);
+
+    // *.png in a directory, sorted so the layout is the same on every run
+    static std::vector<std::string> ListImages(const std::string& directory);
+
+private:
+    const TextureLoader* m_loader;
+    unsigned int m_texture;
+    int m_width, m_height;
+    std::unordered_map<std::string, AtlasRegion> m_regions;
+    std::atomic<bool> m_built; // Set by the worker once m_regions is complete
+};
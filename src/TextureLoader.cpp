@@ -0,0 +1,281 @@
+#include <GL/glew.h>
+#include "TextureLoader.h"
+#include "PixelConvert.h"
+#include "Trace.h"
+#include <wx/image.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+TextureLoader::TextureLoader()
+    : m_stopping(false)
+    , m_nextPixelBuffer(0)
+    , m_uploadBudget(16 * 1024 * 1024)
+    , m_pendingCount(0)
+    , m_bindingGeneration(0)
+    , m_initialized(false)
+{
+    for (unsigned int& buffer : m_pixelBuffers)
+        buffer = 0;
+}
+
+TextureLoader::~TextureLoader()
+{
+    Shutdown();
+}
+
+bool TextureLoader::Initialize(int workerCount)
+{
+    if (m_initialized)
+        return true;
+
+    glGenBuffers(kPixelBufferCount, m_pixelBuffers);
+
+    if (workerCount <= 0)
+        workerCount = (int)std::min(4u, std::max(1u, std::thread::hardware_concurrency() - 1));
+
+    m_stopping = false;
+    for (int i = 0; i < workerCount; ++i)
+        m_workers.emplace_back(&TextureLoader::WorkerLoop, this);
+
+    m_initialized = true;
+    return true;
+}
+
+void TextureLoader::Shutdown()
+{
+    if (!m_initialized)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_stopping = true;
+        m_jobs.clear();
+    }
+    m_jobReady.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+
+    for (auto& entry : m_textures)
+        glDeleteTextures(1, &entry.second);
+    m_textures.clear();
+    m_ready.clear();
+    m_uploadQueue.clear();
+    m_results.clear();
+
+    glDeleteBuffers(kPixelBufferCount, m_pixelBuffers);
+    for (unsigned int& buffer : m_pixelBuffers)
+        buffer = 0;
+
+    m_pendingCount = 0;
+    m_initialized = false;
+}
+
+void TextureLoader::SetReadyCallback(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    m_readyCallback = callback;
+}
+
+void TextureLoader::SetUploadBudget(size_t bytesPerUpdate)
+{
+    m_uploadBudget = std::max<size_t>(1, bytesPerUpdate);
+}
+
+unsigned int TextureLoader::RequestTexture(const std::string& path)
+{
+    return RequestTexture(path, std::function<bool(DecodedImage&)>());
+}
+
+unsigned int TextureLoader::RequestTexture(const std::string& key, std::function<bool(DecodedImage&)> decode)
+{
+    auto existing = m_textures.find(key);
+    if (existing != m_textures.end())
+        return existing->second;
+
+    // Placeholder
+    const unsigned char transparent[4] = { 0, 0, 0, 0 };
+    unsigned int textureId;
+    glGenTextures(1, &textureId);
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, transparent);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    ++m_bindingGeneration;
+
+    m_textures[key] = textureId;
+    m_ready[textureId] = false;
+    ++m_pendingCount;
+
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_jobs.push_back(Job{ textureId, key, std::move(decode) });
+    }
+    m_jobReady.notify_one();
+
+    return textureId;
+}
+
+void TextureLoader::WorkerLoop()
+{
+    TRACE_THREAD_NAME("TextureLoader");
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            m_jobReady.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping)
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        TRACE_SCOPE("TextureLoader::Decode");
+        Result result;
+        result.texture = job.texture;
+        result.ok = job.decode ? job.decode(result.image) : DecodeImage(job.path, result.image);
+
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(m_resultMutex);
+            m_results.push_back(std::move(result));
+            callback = m_readyCallback;
+        }
+        m_resultReady.notify_all();
+        if (callback)
+            callback();
+    }
+}
+
+void TextureLoader::Update()
+{
+    TRACE_SCOPE("TextureLoader::Update");
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        for (Result& result : m_results)
+            m_uploadQueue.push_back(std::move(result));
+        m_results.clear();
+    }
+
+    // Spread big batches over several frames
+    size_t uploadedBytes = 0;
+    while (!m_uploadQueue.empty() && uploadedBytes < m_uploadBudget)
+    {
+        Result& result = m_uploadQueue.front();
+        if (result.ok)
+        {
+            Upload(result);
+            uploadedBytes += result.image.rgba.size();
+        }
+        m_ready[result.texture] = result.ok;
+        --m_pendingCount;
+        m_uploadQueue.pop_front();
+    }
+}
+
+void TextureLoader::Flush()
+{
+    size_t budget = m_uploadBudget;
+    m_uploadBudget = SIZE_MAX;
+    while (true)
+    {
+        Update();
+        if (m_pendingCount == 0)
+            break;
+        
+        std::unique_lock<std::mutex> lock(m_resultMutex);
+        m_resultReady.wait(lock, [this]() { return !m_results.empty(); });
+    }
+    m_uploadBudget = budget;
+}
+
+void TextureLoader::Upload(const Result& result)
+{
+    const DecodedImage& image = result.image;
+    size_t size = image.rgba.size();
+
+    // Orphan the next buffer so the copy never waits on an upload still in flight
+    unsigned int pixelBuffer = m_pixelBuffers[m_nextPixelBuffer];
+    m_nextPixelBuffer = (m_nextPixelBuffer + 1) % kPixelBufferCount;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    const void* pixels = nullptr; // Offset into the bound unpack buffer
+    if (mapped)
+    {
+        std::memcpy(mapped, image.rgba.data(), size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else
+    {
+        wxLogWarning("Pixel buffer mapping failed, uploading texture directly");
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        pixels = image.rgba.data();
+    }
+
+    glBindTexture(GL_TEXTURE_2D, result.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    ++m_bindingGeneration;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool TextureLoader::IsReady(unsigned int texture) const
+{
+    auto it = m_ready.find(texture);
+    return it != m_ready.end() && it->second;
+}
+
+size_t TextureLoader::GetPendingCount() const
+{
+    return m_pendingCount;
+}
+
+int TextureLoader::GetWorkerCount() const
+{
+    return (int)m_workers.size();
+}
+
+void TextureLoader::InitImageHandlers()
+{
+    // Handler registration is not thread-safe, the first caller does it for everyone
+    static std::once_flag handlersOnce;
+    std::call_once(handlersOnce, []() { wxInitAllImageHandlers(); });
+}
+
+bool TextureLoader::DecodeImage(const std::string& path, DecodedImage& decoded)
+{
+    InitImageHandlers();
+
+    wxImage image;
+    if (!image.LoadFile(path, wxBITMAP_TYPE_PNG))
+    {
+        wxLogError("Failed to load texture: %s", path);
+        return false;
+    }
+    
+    int width = image.GetWidth();
+    int height = image.GetHeight();
+    unsigned char* data = image.GetData();
+    unsigned char* alpha = image.GetAlpha();
+    
+    decoded.width = width;
+    decoded.height = height;
+    decoded.rgba.resize((size_t)width * height * 4);
+    if (alpha)
+        PixelConvert::RgbAlphaToRgba(data, alpha, decoded.rgba.data(), (size_t)width * height);
+    else
+        PixelConvert::RgbToRgba(data, 255, decoded.rgba.data(), (size_t)width * height);
+    
+    return true;
+}
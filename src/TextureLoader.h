@@ -0,0 +1,93 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct DecodedImage
+{
+    int width = 0, height = 0;
+    std::vector<unsigned char> rgba; // Tightly packed RGBA8, top row first
+};
+
+// Asynchronous texture loading: PNG decode and RGBA conversion run on worker
+// threads, uploads go through a ring of pixel buffer objects on the GL thread.
+// RequestTexture() hands out the final texture id at once; it samples as a
+// transparent 1x1 placeholder until the real image has been uploaded.
+class TextureLoader
+{
+public:
+    TextureLoader();
+    ~TextureLoader();
+
+    bool Initialize(int workerCount = 0); // GL thread; 0 = pick from hardware threads
+    void Shutdown();
+
+    // GL thread
+    unsigned int RequestTexture(const std::string& path);
+    // Same, with a custom decode run on a worker (e.g. building an atlas); key dedups requests
+    unsigned int RequestTexture(const std::string& key, std::function<bool(DecodedImage&)> decode);
+    void Update(); // Uploads finished decodes, at most m_uploadBudget bytes per call
+    void Flush();  // Blocks until every requested texture is uploaded, for one-shot renders
+    bool IsReady(unsigned int texture) const;
+    size_t GetPendingCount() const;
+    int GetWorkerCount() const;
+    // Changes whenever the loader rebinds GL_TEXTURE_2D, so state caches know to resync
+    unsigned int GetBindingGeneration() const { return m_bindingGeneration; }
+
+    // Called from a worker thread whenever a decode finishes, e.g. to wake the render loop
+    void SetReadyCallback(std::function<void()> callback);
+    void SetUploadBudget(size_t bytesPerUpdate);
+
+    // Synchronous decode, usable from any thread
+    static bool DecodeImage(const std::string& path, DecodedImage& image);
+    static void InitImageHandlers(); // wxImage handlers, once per process
+
+private:
+    static const int kPixelBufferCount = 4;
+
+    struct Job
+    {
+        unsigned int texture;
+        std::string path;
+        std::function<bool(DecodedImage&)> decode; // Empty = DecodeImage(path)
+    };
+
+    struct Result
+    {
+        unsigned int texture;
+        bool ok;
+        DecodedImage image;
+    };
+
+    void WorkerLoop();
+    void Upload(const Result& result);
+
+    // Worker pool
+    std::vector<std::thread> m_workers;
+    std::deque<Job> m_jobs;
+    std::mutex m_jobMutex;
+    std::condition_variable m_jobReady;
+    bool m_stopping;
+
+    // Finished decodes waiting for the GL thread
+    std::vector<Result> m_results;
+    std::mutex m_resultMutex;
+    std::condition_variable m_resultReady;
+    std::function<void()> m_readyCallback;
+
+    // GL thread only
+    std::deque<Result> m_uploadQueue;
+    std::unordered_map<std::string, unsigned int> m_textures;
+    std::unordered_map<unsigned int, bool> m_ready;
+    unsigned int m_pixelBuffers[kPixelBufferCount];
+    int m_nextPixelBuffer;
+    size_t m_uploadBudget;
+    size_t m_pendingCount;
+    unsigned int m_bindingGeneration;
+    bool m_initialized;
+};
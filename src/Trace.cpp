@@ -0,0 +1,170 @@
+#include "Trace.h"
+#include <wx/log.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+struct TraceEvent
+{
+    const char* name;
+    uint64_t begin, end;
+};
+
+// Chunks are allocated as a thread needs them, up to about 1M spans per thread
+const size_t kChunkSize = 16384;
+const size_t kMaxChunks = 64;
+
+// Written by its own thread only; readers see events below count
+struct ThreadBuffer
+{
+    std::atomic<TraceEvent*> chunks[kMaxChunks];
+    std::atomic<size_t> count;
+    std::atomic<size_t> dropped;
+    std::atomic<const char*> name;
+    int id;
+};
+
+const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+// Buffers outlive their threads so finished threads still show up in the dump;
+// the registry is never freed, a late span during exit must not touch a dead vector
+std::mutex g_registryMutex;
+std::vector<ThreadBuffer*>* g_registry = new std::vector<ThreadBuffer*>();
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+
+ThreadBuffer* RegisterThread()
+{
+    ThreadBuffer* buffer = new ThreadBuffer();
+    for (std::atomic<TraceEvent*>& chunk : buffer->chunks)
+        chunk.store(nullptr, std::memory_order_relaxed);
+    buffer->count.store(0, std::memory_order_relaxed);
+    buffer->dropped.store(0, std::memory_order_relaxed);
+    buffer->name.store(nullptr, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    buffer->id = (int)g_registry->size() + 1;
+    g_registry->push_back(buffer);
+    t_buffer = buffer;
+    return buffer;
+}
+
+void WriteEscaped(FILE* file, const char* text)
+{
+    for (; *text; ++text)
+    {
+        if (*text == '"' || *text == '\\')
+            std::fputc('\\', file);
+        if ((unsigned char)*text >= 0x20)
+            std::fputc(*text, file);
+    }
+}
+}
+
+uint64_t Trace::Now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+void Trace::Record(const char* name, uint64_t begin, uint64_t end)
+{
+    ThreadBuffer* buffer = t_buffer ? t_buffer : RegisterThread();
+
+    size_t index = buffer->count.load(std::memory_order_relaxed);
+    size_t chunk = index / kChunkSize;
+    if (chunk >= kMaxChunks)
+    {
+        buffer->dropped.store(buffer->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    TraceEvent* events = buffer->chunks[chunk].load(std::memory_order_relaxed);
+    if (!events)
+    {
+        events = new TraceEvent[kChunkSize];
+        buffer->chunks[chunk].store(events, std::memory_order_release);
+    }
+    events[index % kChunkSize] = TraceEvent{ name, begin, end };
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const char* name)
+{
+    ThreadBuffer* buffer = t_buffer ? t_buffer : RegisterThread();
+    buffer->name.store(name, std::memory_order_release);
+}
+
+bool Trace::WriteJson(const std::string& path)
+{
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        wxLogError("Failed to write trace file %s", path);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    for (const ThreadBuffer* buffer : *g_registry)
+    {
+        const char* threadName = buffer->name.load(std::memory_order_acquire);
+        if (threadName)
+        {
+            std::fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+                         first ? "" : ",", buffer->id);
+            WriteEscaped(file, threadName);
+            std::fprintf(file, "\"}}");
+            first = false;
+        }
+
+        // Complete events, timestamps in microseconds
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const TraceEvent& event = buffer->chunks[i / kChunkSize].load(std::memory_order_acquire)[i % kChunkSize];
+            std::fprintf(file, "%s\n{\"name\":\"", first ? "" : ",");
+            WriteEscaped(file, event.name);
+            std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         buffer->id, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+            first = false;
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+
+    bool ok = std::ferror(file) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+        wxLogError("Failed to write trace file %s", path);
+    return ok;
+}
+
+std::string Trace::GetDefaultPath()
+{
+    const char* path = std::getenv("TRACE_FILE");
+    return path && *path ? path : "trace.json";
+}
+
+size_t Trace::GetEventCount()
+{
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    size_t total = 0;
+    for (const ThreadBuffer* buffer : *g_registry)
+        total += buffer->count.load(std::memory_order_acquire);
+    return total;
+}
+
+size_t Trace::GetDroppedCount()
+{
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    size_t total = 0;
+    for (const ThreadBuffer* buffer : *g_registry)
+        total += buffer->dropped.load(std::memory_order_relaxed);
+    return total;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// CPU spans for chrome://tracing and Perfetto. Every thread appends to its own
+// buffer without locks; WriteJson() reads whatever has been published so far,
+// so it can run at any time, from any thread. Span names must be string
+// literals, only the pointer is stored.
+class Trace
+{
+public:
+    static uint64_t Now(); // Nanoseconds since startup
+    static void Record(const char* name, uint64_t begin, uint64_t end);
+    static void SetThreadName(const char* name);
+
+    static bool WriteJson(const std::string& path);
+    static std::string GetDefaultPath(); // $TRACE_FILE, or trace.json
+    static size_t GetEventCount();
+    static size_t GetDroppedCount(); // Spans lost to full buffers
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+        : m_name(name), m_begin(Trace::Now())
+    {
+    }
+
+    ~TraceScope()
+    {
+        Trace::Record(m_name, m_begin, Trace::Now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_begin;
+};
+
+// Instrumentation; compiles to nothing unless the build enables ENABLE_TRACING
+#ifdef ENABLE_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Trace::SetThreadName(name)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_THREAD_NAME(name) do {} while (0)
+#endif
@@ -1,15 +1,58 @@
 #include <wx/wx.h>
 #include "MainFrame.h"
+#include "Trace.h"
+
+#ifdef HAVE_XINITTHREADS
+#include <X11/Xlib.h>
+#endif
 
 class MyApp : public wxApp
 {
 public:
+    MyApp()
+    {
+#ifdef HAVE_XINITTHREADS
+        // GL is driven from the render thread, Xlib has to know before the display opens
+        XInitThreads();
+#endif
+    }
+
     virtual bool OnInit() override
     {
+        TRACE_THREAD_NAME("Main");
+
+        // --record FILE / --replay FILE [--realtime] / --capture FILE.y4m|FILE.png / --verbose
+        wxString recordPath, replayPath, capturePath;
+        bool realtime = false;
+        for (int i = 1; i < argc; ++i)
+        {
+            wxString arg = argv[i];
+            if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+            else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+            else if (arg == "--capture" && i + 1 < argc) capturePath = argv[++i];
+            else if (arg == "--realtime") realtime = true;
+            else if (arg == "--verbose") wxLog::SetVerbose(true);
+        }
+
         MainFrame* frame = new MainFrame();
+        if (!capturePath.IsEmpty())
+            frame->StartCapture(capturePath.ToStdString());
         frame->Show(true);
+        if (!recordPath.IsEmpty())
+            frame->StartRecording(recordPath.ToStdString());
+        if (!replayPath.IsEmpty())
+            frame->StartReplay(replayPath.ToStdString(), realtime);
         return true;
     }
+
+#ifdef ENABLE_TRACING
+    virtual int OnExit() override
+    {
+        // Frames and threads are gone, every span is in
+        Trace::WriteJson(Trace::GetDefaultPath());
+        return wxApp::OnExit();
+    }
+#endif
 };
 
 wxIMPLEMENT_APP(MyApp);
@@ -0,0 +1,348 @@
+#include <GL/glew.h>
+#include <wx/init.h>
+#include <wx/image.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HeadlessContext.h"
+#include "OffscreenTarget.h"
+#include "Renderer.h"
+#include "TextureLoader.h"
+
+// Renders a parameter sweep (rotations x vertex color palettes) without a
+// window, one independent headless context per worker thread, and prints
+// throughput as JSON.
+// Usage: renderer_batch [--spec FILE] [--rotations START:END:STEP] [--palette NAME=RRGGBB,RRGGBB,RRGGBB]...
+//                       [--size WxH] [--output PATTERN] [--workers 1,2,4] [--no-write]
+// PATTERN may use {palette}, {rotation} and {index}; default sweep/{palette}_{rotation}.png.
+// A spec file holds the same settings, one per line without the dashes:
+//   rotations 0:360:15
+//   palette warm=ff4000,ffc000,ffff80
+//   size 512x512
+// A palette named "default" keeps the built-in vertex colors. With a list of
+// worker counts the whole sweep runs once per count, for a scaling table.
+
+namespace
+{
+struct Palette
+{
+    std::string name;
+    bool custom;
+    float colors[3][3]; // Up, left, right
+};
+
+struct Sweep
+{
+    double rotationStart = 0.0, rotationEnd = 360.0, rotationStep = 30.0;
+    std::vector<Palette> palettes;
+    int width = 512, height = 512;
+    std::string output = "sweep/{palette}_{rotation}.png";
+    std::vector<int> workers;
+    bool write = true;
+};
+
+struct Job
+{
+    float rotation;
+    size_t palette;
+};
+
+struct WorkerStats
+{
+    bool ok = false;
+    size_t images = 0;
+    double setupMs = 0.0, renderMs = 0.0, readbackMs = 0.0, writeMs = 0.0;
+};
+
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ParsePalette(const std::string& text, Palette& palette)
+{
+    size_t equals = text.find('=');
+    palette.name = equals == std::string::npos ? text : text.substr(0, equals);
+    palette.custom = equals != std::string::npos;
+    if (!palette.custom)
+        return palette.name == "default";
+
+    unsigned int rgb[3];
+    if (std::sscanf(text.c_str() + equals + 1, "%6x,%6x,%6x", &rgb[0], &rgb[1], &rgb[2]) != 3)
+        return false;
+    for (int vertex = 0; vertex < 3; ++vertex)
+    {
+        palette.colors[vertex][0] = ((rgb[vertex] >> 16) & 0xFF) / 255.0f;
+        palette.colors[vertex][1] = ((rgb[vertex] >> 8) & 0xFF) / 255.0f;
+        palette.colors[vertex][2] = (rgb[vertex] & 0xFF) / 255.0f;
+    }
+    return true;
+}
+
+// One setting; the same keys serve the command line and spec files
+bool ApplySetting(const std::string& key, const std::string& value, Sweep& sweep)
+{
+    if (key == "rotations")
+        return std::sscanf(value.c_str(), "%lf:%lf:%lf", &sweep.rotationStart, &sweep.rotationEnd, &sweep.rotationStep) == 3 &&
+               sweep.rotationStep > 0.0;
+    if (key == "palette")
+    {
+        Palette palette;
+        if (!ParsePalette(value, palette))
+            return false;
+        sweep.palettes.push_back(palette);
+        return true;
+    }
+    if (key == "size")
+        return std::sscanf(value.c_str(), "%dx%d", &sweep.width, &sweep.height) == 2 && sweep.width > 0 && sweep.height > 0;
+    if (key == "output")
+    {
+        sweep.output = value;
+        return true;
+    }
+    if (key == "workers")
+    {
+        sweep.workers.clear();
+        std::stringstream list(value);
+        std::string item;
+        while (std::getline(list, item, ','))
+            sweep.workers.push_back(std::max(1, std::atoi(item.c_str())));
+        return !sweep.workers.empty();
+    }
+    return false;
+}
+
+bool LoadSpec(const std::string& path, Sweep& sweep)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::fprintf(stderr, "Cannot open spec %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number)
+    {
+        std::stringstream words(line);
+        std::string key, value;
+        if (!(words >> key) || key[0] == '#')
+            continue;
+        words >> value;
+        if (!ApplySetting(key, value, sweep))
+        {
+            std::fprintf(stderr, "%s:%d: bad setting: %s\n", path.c_str(), number, line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string FormatPath(const std::string& pattern, const Palette& palette, float rotation, size_t index)
+{
+    char number[32];
+    std::string path = pattern;
+    auto replace = [&path](const char* field, const std::string& text)
+    {
+        for (size_t at = path.find(field); at != std::string::npos; at = path.find(field, at + text.size()))
+            path.replace(at, std::strlen(field), text);
+    };
+    replace("{palette}", palette.name);
+    std::snprintf(number, sizeof(number), "%g", rotation);
+    replace("{rotation}", number);
+    std::snprintf(number, sizeof(number), "%06zu", index);
+    replace("{index}", number);
+    return path;
+}
+
+bool WritePng(const std::string& path, int width, int height, const std::vector<unsigned char>& rgba)
+{
+    wxImage image(width, height, false);
+    unsigned char* rgb = image.GetData();
+    for (size_t i = 0; i < (size_t)width * height; ++i)
+    {
+        rgb[i * 3 + 0] = rgba[i * 4 + 0];
+        rgb[i * 3 + 1] = rgba[i * 4 + 1];
+        rgb[i * 3 + 2] = rgba[i * 4 + 2];
+    }
+    return image.SaveFile(path, wxBITMAP_TYPE_PNG);
+}
+
+// One worker: its own context, target and Renderer, pulling jobs until none are left
+void RunWorker(const Sweep& sweep, const std::vector<Job>& jobs, std::atomic<size_t>& nextJob, WorkerStats& stats)
+{
+    auto setupStart = std::chrono::steady_clock::now();
+    HeadlessContext context;
+    if (!context.Create())
+        return;
+    OffscreenTarget target;
+    if (!target.Create(sweep.width, sweep.height))
+        return;
+    target.Bind();
+
+    Renderer renderer;
+    if (!renderer.Initialize())
+        return;
+    renderer.GetTextureLoader().Flush();
+    renderer.SetViewport(sweep.width, sweep.height);
+    renderer.SetTriangleVisible(true);
+    stats.setupMs = MsSince(setupStart);
+
+    std::vector<unsigned char> rgba;
+    for (size_t index = nextJob++; index < jobs.size(); index = nextJob++)
+    {
+        const Job& job = jobs[index];
+        const Palette& palette = sweep.palettes[job.palette];
+
+        auto start = std::chrono::steady_clock::now();
+        if (palette.custom)
+        {
+            for (int vertex = 0; vertex < 3; ++vertex)
+                renderer.SetVertexColor(vertex, palette.colors[vertex][0], palette.colors[vertex][1], palette.colors[vertex][2]);
+        }
+        renderer.SetUseCustomColor(palette.custom);
+        renderer.SetRotation(job.rotation);
+        renderer.Render();
+        glFinish();
+        stats.renderMs += MsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        target.ReadPixels(rgba);
+        stats.readbackMs += MsSince(start);
+
+        if (sweep.write)
+        {
+            start = std::chrono::steady_clock::now();
+            std::string path = FormatPath(sweep.output, palette, job.rotation, index);
+            if (!WritePng(path, sweep.width, sweep.height, rgba))
+            {
+                wxLogError("Failed to write %s", path);
+                return;
+            }
+            stats.writeMs += MsSince(start);
+        }
+        ++stats.images;
+    }
+    stats.ok = true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Sweep sweep;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--spec") == 0 && hasValue)
+        {
+            if (!LoadSpec(argv[++i], sweep))
+                return 2;
+        }
+        else if (std::strcmp(arg, "--no-write") == 0)
+        {
+            sweep.write = false;
+        }
+        else if (std::strncmp(arg, "--", 2) == 0 && hasValue && ApplySetting(arg + 2, argv[i + 1], sweep))
+        {
+            ++i;
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown or bad argument: %s\n", arg);
+            return 2;
+        }
+    }
+    if (sweep.palettes.empty())
+    {
+        Palette palette;
+        ParsePalette("default", palette);
+        sweep.palettes.push_back(palette);
+    }
+    if (sweep.workers.empty())
+        sweep.workers.push_back((int)std::max(1u, std::thread::hardware_concurrency()));
+
+    std::vector<Job> jobs;
+    for (size_t palette = 0; palette < sweep.palettes.size(); ++palette)
+    {
+        for (double rotation = sweep.rotationStart; rotation < sweep.rotationEnd; rotation += sweep.rotationStep)
+            jobs.push_back(Job{ (float)rotation, palette });
+    }
+
+    wxInitializer initializer;
+    if (!initializer.IsOk())
+    {
+        std::fprintf(stderr, "Failed to initialize wxWidgets\n");
+        return 1;
+    }
+    // Handler registration is not thread-safe, do it before the workers start
+    TextureLoader::InitImageHandlers();
+
+    if (sweep.write)
+    {
+        // Every directory the pattern can expand to
+        for (const Palette& palette : sweep.palettes)
+        {
+            std::filesystem::path directory = std::filesystem::path(FormatPath(sweep.output, palette, 0.0f, 0)).parent_path();
+            std::error_code error;
+            if (!directory.empty())
+                std::filesystem::create_directories(directory, error);
+        }
+    }
+
+    std::printf("{\n  \"images\": %zu,\n  \"width\": %d,\n  \"height\": %d,\n  \"write\": %s,\n",
+                jobs.size(), sweep.width, sweep.height, sweep.write ? "true" : "false");
+    std::printf("  \"hardware_threads\": %u,\n  \"runs\": [\n", std::thread::hardware_concurrency());
+    for (size_t run = 0; run < sweep.workers.size(); ++run)
+    {
+        int workerCount = sweep.workers[run];
+        std::vector<WorkerStats> stats((size_t)workerCount);
+        std::atomic<size_t> nextJob(0);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int worker = 0; worker < workerCount; ++worker)
+            threads.emplace_back(RunWorker, std::cref(sweep), std::cref(jobs), std::ref(nextJob), std::ref(stats[worker]));
+        for (std::thread& thread : threads)
+            thread.join();
+        double totalMs = MsSince(start);
+
+        WorkerStats sum;
+        sum.ok = true;
+        double setupMaxMs = 0.0;
+        for (const WorkerStats& worker : stats)
+        {
+            sum.ok = sum.ok && worker.ok;
+            sum.images += worker.images;
+            sum.renderMs += worker.renderMs;
+            sum.readbackMs += worker.readbackMs;
+            sum.writeMs += worker.writeMs;
+            setupMaxMs = std::max(setupMaxMs, worker.setupMs);
+        }
+        if (!sum.ok)
+        {
+            std::fprintf(stderr, "A worker failed with %d workers\n", workerCount);
+            return 1;
+        }
+
+        // Per-image stage times are averaged over all workers; with more workers
+        // than cores they include time spent waiting for a core
+        double images = (double)std::max<size_t>(1, sum.images);
+        std::printf("    { \"workers\": %d, \"seconds\": %.3f, \"images_per_s\": %.1f, \"setup_ms\": %.1f, "
+                    "\"render_ms\": %.3f, \"readback_ms\": %.3f, \"write_ms\": %.3f }%s\n",
+                    workerCount, totalMs / 1000.0, sum.images * 1000.0 / totalMs, setupMaxMs,
+                    sum.renderMs / images, sum.readbackMs / images, sum.writeMs / images,
+                    run + 1 < sweep.workers.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <GL/glew.h>
+#include <wx/init.h>
+#include <wx/image.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "HeadlessContext.h"
+#include "OffscreenTarget.h"
+#include "Renderer.h"
+#include "SoftwareRenderer.h"
+#include "Trace.h"
+
+// Renders one frame without a window and writes it as PNG.
+// Usage: renderer_headless [--width N] [--height N] [--rotation DEG] [--hide-triangle] [--output FILE]
+//                          [--trace FILE] (spans are only recorded with ENABLE_TRACING)
+//                          [--software [--threads N]] [--compare] [--mesh FILE [--no-optimize]]
+// --software draws on the CPU rasterizer and needs no EGL. --compare draws
+// with both, writes the --software choice and prints how far they differ; it
+// fails if more than 1% of the pixels are off by more than one step.
+// --mesh draws an .obj, .ply or .rmesh file instead of the triangle (GL only)
+// and prints its load and upload times; --no-optimize uploads a parsed mesh
+// in file order.
+
+namespace
+{
+const int kCompareTolerance = 1;
+const double kCompareMaxFraction = 0.01;
+
+bool RenderGL(int width, int height, float rotation, bool triangleVisible, const std::string& meshPath,
+              bool optimizeMesh, std::vector<unsigned char>& rgba)
+{
+    HeadlessContext context;
+    if (!context.Create())
+        return false;
+
+    OffscreenTarget target;
+    if (!target.Create(width, height))
+        return false;
+    target.Bind();
+
+    Renderer renderer;
+    if (!renderer.Initialize())
+        return false;
+    renderer.GetTextureLoader().Flush(); // One frame only, it must not show placeholders
+    if (!meshPath.empty())
+    {
+        renderer.SetMeshOptimization(optimizeMesh);
+        if (!renderer.LoadMesh(meshPath))
+            return false;
+        const MeshStats& mesh = renderer.GetMeshStats();
+        std::printf("{ \"vertices\": %zu, \"triangles\": %zu, \"file_bytes\": %zu, \"load_ms\": %.3f, \"optimize_ms\": %.3f, "
+                    "\"upload_ms\": %.3f, \"mapped\": %s }\n",
+                    mesh.vertices, mesh.triangles, mesh.fileBytes, mesh.loadMs, mesh.optimizeMs, mesh.uploadMs,
+                    mesh.mapped ? "true" : "false");
+    }
+    renderer.SetViewport(width, height);
+    renderer.SetRotation(rotation);
+    renderer.SetTriangleVisible(triangleVisible);
+    renderer.Render();
+
+    target.ReadPixels(rgba);
+    return true;
+}
+
+void RenderSoftware(int width, int height, float rotation, bool triangleVisible, int threads, std::vector<unsigned char>& rgba)
+{
+    SoftwareRenderer renderer(threads);
+    renderer.LoadIconAtlas();
+    renderer.SetViewport(width, height);
+    renderer.SetRotation(rotation);
+    renderer.SetTriangleVisible(triangleVisible);
+    renderer.Render();
+    rgba = renderer.GetPixels();
+}
+}
+
+int main(int argc, char** argv)
+{
+    int width = 800;
+    int height = 600;
+    float rotation = 0.0f;
+    bool triangleVisible = true;
+    std::string output = "frame.png";
+    std::string tracePath;
+    std::string meshPath;
+    bool optimizeMesh = true;
+    bool software = false;
+    bool compare = false;
+    int threads = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--width") == 0 && hasValue) width = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--height") == 0 && hasValue) height = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--rotation") == 0 && hasValue) rotation = (float)std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--output") == 0 && hasValue) output = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) threads = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--mesh") == 0 && hasValue) meshPath = argv[++i];
+        else if (std::strcmp(argv[i], "--no-optimize") == 0) optimizeMesh = false;
+        else if (std::strcmp(argv[i], "--hide-triangle") == 0) triangleVisible = false;
+        else if (std::strcmp(argv[i], "--software") == 0) software = true;
+        else if (std::strcmp(argv[i], "--compare") == 0) compare = true;
+        else
+        {
+            std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (!meshPath.empty() && (software || compare))
+    {
+        std::fprintf(stderr, "--mesh needs the GL renderer, the software one draws no meshes\n");
+        return 2;
+    }
+
+    wxInitializer initializer;
+    if (!initializer.IsOk())
+    {
+        std::fprintf(stderr, "Failed to initialize wxWidgets\n");
+        return 1;
+    }
+
+    std::vector<unsigned char> rgba;
+    if (!software || compare)
+    {
+        if (!RenderGL(width, height, rotation, triangleVisible, meshPath, optimizeMesh, rgba))
+            return 1;
+    }
+
+    bool mismatch = false;
+    if (software || compare)
+    {
+        std::vector<unsigned char> cpu;
+        RenderSoftware(width, height, rotation, triangleVisible, threads, cpu);
+        if (compare)
+        {
+            PixelDiff diff = SoftwareRenderer::Compare(rgba, cpu, kCompareTolerance);
+            double fraction = (double)diff.differing / std::max<size_t>(1, diff.pixels);
+            std::printf("{ \"pixels\": %zu, \"differing\": %zu, \"fraction\": %.6f, \"max_diff\": %d }\n",
+                        diff.pixels, diff.differing, fraction, diff.maxDiff);
+            mismatch = fraction > kCompareMaxFraction;
+        }
+        if (software)
+            rgba.swap(cpu);
+    }
+
+    wxImage image(width, height, false);
+    unsigned char* rgb = image.GetData();
+    for (size_t i = 0; i < (size_t)width * height; ++i)
+    {
+        rgb[i * 3 + 0] = rgba[i * 4 + 0];
+        rgb[i * 3 + 1] = rgba[i * 4 + 1];
+        rgb[i * 3 + 2] = rgba[i * 4 + 2];
+    }
+
+    wxInitAllImageHandlers();
+    if (!image.SaveFile(output, wxBITMAP_TYPE_PNG))
+    {
+        wxLogError("Failed to write %s", output);
+        return 1;
+    }
+
+    if (!tracePath.empty() && !Trace::WriteJson(tracePath))
+        return 1;
+
+    return mismatch ? 1 : 0;
+}
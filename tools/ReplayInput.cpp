@@ -0,0 +1,222 @@
+#include <GL/glew.h>
+#include <wx/init.h>
+#include <wx/image.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HeadlessContext.h"
+#include "InputRecording.h"
+#include "OffscreenTarget.h"
+#include "Renderer.h"
+
+// Replays an input recording (MyOpenGLApp --record FILE) on the headless
+// renderer and prints per-frame render times as JSON. Events are grouped into
+// frames the way the app's render thread coalesces them; frames without input
+// are not rendered, as in the app. --output writes the last frame as PNG, so
+// two replays of one recording can be compared; --capture keeps every frame,
+// e.g. as a demo video.
+// Usage: renderer_replay --input FILE [--realtime] [--fps N] [--width N] [--height N] [--output FILE]
+//                        [--capture FILE.y4m|FILE.png]
+//        renderer_replay --synthesize FILE [--seconds N] [--width N] [--height N]
+
+namespace
+{
+double Percentile(const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t index = std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+// Scripted session for runs without a recorded one: a mouse sweep over the
+// toolbar and the triangle at 120 Hz, the slider turning, and the toggles
+void Synthesize(InputRecording& recording, int width, int height, int seconds)
+{
+    auto add = [&recording](uint64_t timeUs, InputEvent::Type type, int target, int x, int y)
+    {
+        InputEvent event;
+        event.timeUs = timeUs;
+        event.type = type;
+        event.target = (uint8_t)target;
+        event.x = x;
+        event.y = y;
+        recording.Add(event);
+    };
+
+    add(0, InputEvent::Resize, 0, width, height);
+    add(0, InputEvent::Checkbox, InputEvent::ShowTriangle, 1, 0);
+    const uint64_t stepUs = 1000000 / 120;
+    const uint64_t endUs = (uint64_t)seconds * 1000000;
+    for (uint64_t t = stepUs; t < endUs; t += stepUs)
+    {
+        double phase = (double)t / endUs;
+        int x = (int)(width * (0.5 + 0.45 * std::sin(phase * 12.0)));
+        int y = (int)(height * (0.5 + 0.45 * std::cos(phase * 7.0)));
+        add(t, InputEvent::MouseMove, 0, x, y);
+        if ((t / stepUs) % 4 == 0)
+            add(t, InputEvent::Slider, 0, (int)(phase * 360.0) % 360, 0);
+        if ((t / stepUs) % 240 == 120)
+            add(t, InputEvent::Checkbox, InputEvent::CustomColors, (int)((t / stepUs / 240) % 2), 0);
+        if ((t / stepUs) % 360 == 180)
+            add(t, InputEvent::Color, (int)((t / stepUs / 360) % 3), (int)((t * 2654435761u) & 0xFFFFFF), 0);
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    int width = 800;
+    int height = 600;
+    int fps = 60;
+    int seconds = 10;
+    bool realtime = false;
+    std::string input, synthesizePath, output, capturePath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--input") == 0 && hasValue) input = argv[++i];
+        else if (std::strcmp(argv[i], "--synthesize") == 0 && hasValue) synthesizePath = argv[++i];
+        else if (std::strcmp(argv[i], "--seconds") == 0 && hasValue) seconds = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--width") == 0 && hasValue) width = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--height") == 0 && hasValue) height = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--output") == 0 && hasValue) output = argv[++i];
+        else if (std::strcmp(argv[i], "--capture") == 0 && hasValue) capturePath = argv[++i];
+        else if (std::strcmp(argv[i], "--fps") == 0 && hasValue) fps = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--realtime") == 0) realtime = true;
+        else
+        {
+            std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    wxInitializer initializer;
+    if (!initializer.IsOk())
+    {
+        std::fprintf(stderr, "Failed to initialize wxWidgets\n");
+        return 1;
+    }
+
+    InputRecording recording;
+    if (!synthesizePath.empty())
+    {
+        Synthesize(recording, width, height, std::max(1, seconds));
+        return recording.Save(synthesizePath) ? 0 : 1;
+    }
+    if (input.empty())
+    {
+        std::fprintf(stderr, "Need --input FILE or --synthesize FILE\n");
+        return 2;
+    }
+    if (!recording.Load(input))
+        return 1;
+    const std::vector<InputEvent>& events = recording.GetEvents();
+
+    // The recording starts with the canvas size when it has one
+    if (!events.empty() && events.front().type == InputEvent::Resize)
+    {
+        width = events.front().x;
+        height = events.front().y;
+    }
+
+    HeadlessContext context;
+    if (!context.Create())
+        return 1;
+
+    OffscreenTarget target;
+    if (!target.Create(width, height))
+        return 1;
+    target.Bind();
+
+    Renderer renderer;
+    if (!renderer.Initialize())
+        return 1;
+    renderer.GetTextureLoader().Flush(); // Same frames on every run, no placeholders
+    renderer.SetViewport(width, height);
+    if (!capturePath.empty() && !renderer.StartCapture(capturePath, fps, false))
+        return 1;
+
+    InputReplayer replayer;
+    const uint64_t frameUs = 1000000 / (uint64_t)fps;
+    std::vector<double> frameMs;
+    auto start = std::chrono::steady_clock::now();
+
+    size_t index = 0;
+    while (index < events.size())
+    {
+        // Skip ahead to the frame the next event lands in
+        uint64_t frame = events[index].timeUs / frameUs + 1;
+        size_t end = InputReplayer::FrameEnd(events, index, frame * frameUs);
+        if (realtime)
+            std::this_thread::sleep_until(start + std::chrono::microseconds(frame * frameUs));
+
+        for (; index < end; ++index)
+        {
+            const InputEvent& event = events[index];
+            if (event.type == InputEvent::Resize && (event.x != target.GetWidth() || event.y != target.GetHeight()))
+            {
+                if (!target.Create(event.x, event.y))
+                    return 1;
+                target.Bind();
+            }
+            replayer.Apply(event, renderer);
+        }
+
+        auto frameStart = std::chrono::steady_clock::now();
+        renderer.Render();
+        glFinish();
+        frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+    }
+    renderer.StopCapture();
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CaptureStats capture = renderer.GetCaptureStats();
+
+    if (!output.empty())
+    {
+        std::vector<unsigned char> rgba;
+        target.ReadPixels(rgba);
+        wxImage image(target.GetWidth(), target.GetHeight(), false);
+        unsigned char* rgb = image.GetData();
+        for (size_t i = 0; i < (size_t)target.GetWidth() * target.GetHeight(); ++i)
+        {
+            rgb[i * 3 + 0] = rgba[i * 4 + 0];
+            rgb[i * 3 + 1] = rgba[i * 4 + 1];
+            rgb[i * 3 + 2] = rgba[i * 4 + 2];
+        }
+        wxInitAllImageHandlers();
+        if (!image.SaveFile(output, wxBITMAP_TYPE_PNG))
+        {
+            wxLogError("Failed to write %s", output);
+            return 1;
+        }
+    }
+
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double ms : frameMs)
+        sum += ms;
+
+    std::printf("{\n");
+    std::printf("  \"events\": %zu,\n", events.size());
+    std::printf("  \"frames\": %zu,\n", frameMs.size());
+    std::printf("  \"recorded_ms\": %.1f,\n", recording.GetDurationUs() / 1000.0);
+    std::printf("  \"replay_ms\": %.1f,\n", totalMs);
+    std::printf("  \"realtime\": %s,\n", realtime ? "true" : "false");
+    if (!capturePath.empty())
+        std::printf("  \"captured\": %zu,\n", capture.written);
+    std::printf("  \"frame_ms\": { \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"max\": %.3f }\n",
+                frameMs.empty() ? 0.0 : sum / frameMs.size(),
+                Percentile(sorted, 0.50), Percentile(sorted, 0.95), sorted.empty() ? 0.0 : sorted.back());
+    std::printf("}\n");
+    return 0;
+}